@@ -0,0 +1,37 @@
+#ifndef LEXOCRAFT_HASHING_HPP
+#define LEXOCRAFT_HASHING_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace lc {
+    /*
+     Hashes that must give the same value on every platform and in every run, unlike std::hash,
+     because they are persisted in database files.
+    */
+
+    constexpr std::uint64_t mix_hash(std::uint64_t value) {
+        // splitmix64 finalizer
+        value ^= value >> 30U;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27U;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31U;
+
+        return value;
+    }
+
+    constexpr std::uint64_t stable_hash(std::string_view text, std::uint64_t seed = 0) {
+        // FNV-1a followed by a finalizer so that the low bits are usable as a table index
+        std::uint64_t hash = 0xcbf29ce484222325ULL ^ mix_hash(seed);
+
+        for (const char character: text) {
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 0x100000001b3ULL;
+        }
+
+        return mix_hash(hash);
+    }
+} // namespace lc
+
+#endif // LEXOCRAFT_HASHING_HPP
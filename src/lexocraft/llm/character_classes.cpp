@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+ #include <immintrin.h>
+#endif
+
+#include <lexocraft/llm/character_classes.hpp>
+
+namespace lc::grammar {
+    namespace {
+#if defined(__AVX2__)
+        constexpr std::size_t LANE_SIZE {32};
+
+        // Bytes of `lane` in [first, first + range]
+        std::uint32_t in_range(__m256i lane, char first, char range) {
+            const __m256i offset = _mm256_sub_epi8(lane, _mm256_set1_epi8(first));
+            const __m256i is_in_range =
+                _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(range)), offset);
+
+            return static_cast<std::uint32_t>(_mm256_movemask_epi8(is_in_range));
+        }
+
+        BlockClasses classify_lane(const char* data) {
+            const __m256i lane = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            const __m256i lowercase = _mm256_or_si256(lane, _mm256_set1_epi8(0x20));
+            const __m256i spaces = _mm256_cmpeq_epi8(lane, _mm256_set1_epi8(' '));
+
+            return {in_range(lowercase, 'a', 'z' - 'a'), in_range(lane, '0', '9' - '0'),
+                    static_cast<std::uint32_t>(_mm256_movemask_epi8(spaces)), 0};
+        }
+#elif defined(__SSE2__)
+        constexpr std::size_t LANE_SIZE {16};
+
+        std::uint32_t in_range(__m128i lane, char first, char range) {
+            const __m128i offset = _mm_sub_epi8(lane, _mm_set1_epi8(first));
+            const __m128i is_in_range =
+                _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(range)), offset);
+
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(is_in_range));
+        }
+
+        BlockClasses classify_lane(const char* data) {
+            const __m128i lane = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            const __m128i lowercase = _mm_or_si128(lane, _mm_set1_epi8(0x20));
+            const __m128i spaces = _mm_cmpeq_epi8(lane, _mm_set1_epi8(' '));
+
+            return {in_range(lowercase, 'a', 'z' - 'a'), in_range(lane, '0', '9' - '0'),
+                    static_cast<std::uint32_t>(_mm_movemask_epi8(spaces)), 0};
+        }
+#else
+        constexpr std::size_t LANE_SIZE {8};
+
+        BlockClasses classify_lane(const char* data) {
+            BlockClasses classes {0, 0, 0, 0};
+
+            for (std::size_t position {0}; position < LANE_SIZE; ++position) {
+                const std::uint8_t classes_of_byte = character_classes(data [position]);
+                const std::uint64_t bit = std::uint64_t {1} << position;
+
+                classes.letters |= (classes_of_byte & character_class::LETTER) != 0 ? bit : 0;
+                classes.digits |= (classes_of_byte & character_class::DIGIT) != 0 ? bit : 0;
+                classes.spaces |= (classes_of_byte & character_class::SPACE) != 0 ? bit : 0;
+            }
+
+            return classes;
+        }
+#endif
+    } // namespace
+
+    BlockClasses classify_block(std::string_view text, std::size_t index) {
+        const std::size_t size = std::min(BlockClasses::SIZE, text.size() - index);
+        const char* data = std::next(text.data(), static_cast<std::ptrdiff_t>(index));
+
+        // The last block of the text is padded so that no load reads past it
+        std::array<char, BlockClasses::SIZE> padded_block {};
+
+        if (size < BlockClasses::SIZE) {
+            std::memcpy(padded_block.data(), data, size);
+            data = padded_block.data();
+        }
+
+        BlockClasses classes {0, 0, 0, 0};
+
+        for (std::size_t lane {0}; lane < BlockClasses::SIZE; lane += LANE_SIZE) {
+            const BlockClasses lane_classes =
+                classify_lane(std::next(data, static_cast<std::ptrdiff_t>(lane)));
+
+            classes.letters |= lane_classes.letters << lane;
+            classes.digits |= lane_classes.digits << lane;
+            classes.spaces |= lane_classes.spaces << lane;
+        }
+
+        classes.bytes = size == BlockClasses::SIZE ? ~std::uint64_t {0}
+                                                   : (std::uint64_t {1} << size) - 1;
+        classes.letters &= classes.bytes;
+        classes.digits &= classes.bytes;
+        classes.spaces &= classes.bytes;
+
+        return classes;
+    }
+} // namespace lc::grammar
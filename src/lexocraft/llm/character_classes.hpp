@@ -0,0 +1,72 @@
+#ifndef LEXOCRAFT_CHARACTER_CLASSES_HPP
+#define LEXOCRAFT_CHARACTER_CLASSES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lc::grammar {
+    /*
+     Byte classes of the "C" locale, which the lexer has always assumed: bytes from 0x80 up are
+     neither letters nor digits.
+    */
+    namespace character_class {
+        constexpr std::uint8_t LETTER {1U << 0U};
+        constexpr std::uint8_t DIGIT {1U << 1U};
+        constexpr std::uint8_t SPACE {1U << 2U}; // ' ' only, the one the lexer skips
+        constexpr std::uint8_t COMPONENT_SYMBOL {1U << 3U};
+    } // namespace character_class
+
+    constexpr std::array<std::uint8_t, 256> CHARACTER_CLASSES = [] {
+        std::array<std::uint8_t, 256> classes {};
+
+        for (std::size_t letter {'a'}; letter <= 'z'; ++letter) {
+            classes.at(letter) |= character_class::LETTER;
+            classes.at(letter - 'a' + 'A') |= character_class::LETTER;
+        }
+
+        for (std::size_t digit {'0'}; digit <= '9'; ++digit) {
+            classes.at(digit) |= character_class::DIGIT;
+        }
+
+        classes.at(' ') |= character_class::SPACE;
+
+        for (const char symbol: std::string_view {"~_/-'."}) {
+            classes.at(static_cast<unsigned char>(symbol)) |= character_class::COMPONENT_SYMBOL;
+        }
+
+        return classes;
+    }();
+
+    constexpr std::uint8_t character_classes(char letter) {
+        return CHARACTER_CLASSES [static_cast<unsigned char>(letter)];
+    }
+
+    constexpr bool is_letter(char letter) {
+        return (character_classes(letter) & character_class::LETTER) != 0;
+    }
+
+    constexpr bool is_digit(char letter) {
+        return (character_classes(letter) & character_class::DIGIT) != 0;
+    }
+
+    // One bit per byte of a block, bytes past the end of the text are in no mask
+    struct BlockClasses {
+        static constexpr std::size_t SIZE {64};
+
+        std::uint64_t letters;
+        std::uint64_t digits;
+        std::uint64_t spaces;
+        std::uint64_t bytes; // Every byte inside the text
+
+        [[nodiscard]] std::uint64_t symbols() const {
+            return bytes & ~(letters | digits | spaces);
+        }
+    };
+
+    // Classifies text [index, index + 64) with AVX2 or SSE2 when available
+    BlockClasses classify_block(std::string_view text, std::size_t index);
+} // namespace lc::grammar
+
+#endif // LEXOCRAFT_CHARACTER_CLASSES_HPP
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+#include <lexocraft/llm/completion_scheduler.hpp>
+
+namespace lc {
+    CompletionScheduler::CompletionScheduler(std::shared_ptr<const TextCompleter> model,
+                                             Options options) :
+        model {std::move(model)},
+        options {options},
+        worker {[this](const std::stop_token& stop_token) { run(stop_token); }} {
+        assert(options.max_batch_size > 0);
+    }
+
+    CompletionScheduler::CompletionScheduler(std::shared_ptr<const TextCompleter> model) :
+        CompletionScheduler(std::move(model), Options {}) {
+    }
+
+    CompletionScheduler::~CompletionScheduler() {
+        worker.request_stop();
+        worker.join();
+    }
+
+    std::future<CompletionSession::Prediction>
+        CompletionScheduler::submit(CompletionSession& session, const grammar::Token& token) {
+        assert(session.model == model && "Sessions of another model can't share its batches");
+
+        std::future<CompletionSession::Prediction> prediction;
+
+        {
+            const std::lock_guard lock {mutex};
+
+            pending_steps.push_back({&session, token, {}, std::chrono::steady_clock::now()});
+            prediction = pending_steps.back().prediction.get_future();
+        }
+
+        condition.notify_one();
+
+        return prediction;
+    }
+
+    std::size_t CompletionScheduler::batch_count() const {
+        return batches.load();
+    }
+
+    std::size_t CompletionScheduler::step_count() const {
+        return steps.load();
+    }
+
+    std::vector<CompletionScheduler::Step> CompletionScheduler::take_batch() {
+        std::vector<Step> batch;
+
+        for (auto step = pending_steps.begin();
+             step != pending_steps.end() && batch.size() < options.max_batch_size;) {
+            const bool is_session_in_batch =
+                std::any_of(batch.begin(), batch.end(), [&](const Step& batched_step) {
+                    return batched_step.session == step->session;
+                });
+
+            // A later step of a session depends on the memories left by the earlier one
+            if (is_session_in_batch) {
+                ++step;
+                continue;
+            }
+
+            batch.push_back(std::move(*step));
+            step = pending_steps.erase(step);
+        }
+
+        return batch;
+    }
+
+    void CompletionScheduler::run_batch(std::vector<Step>& batch) const {
+        std::vector<TextCompleter::SessionState*> states;
+        std::vector<grammar::Token> tokens;
+        states.reserve(batch.size());
+        tokens.reserve(batch.size());
+
+        for (Step& step: batch) {
+            states.push_back(&step.session->state);
+            tokens.push_back(std::move(step.token));
+        }
+
+        try {
+            model->predict_next_token_values(states, tokens);
+        } catch (...) {
+            for (Step& step: batch) {
+                step.prediction.set_exception(std::current_exception());
+            }
+
+            return;
+        }
+
+        for (Step& step: batch) {
+            step.prediction.set_value(step.session->state.last_prediction);
+        }
+    }
+
+    void CompletionScheduler::run(const std::stop_token& stop_token) {
+        while (true) {
+            std::vector<Step> batch;
+
+            {
+                std::unique_lock lock {mutex};
+
+                condition.wait(lock, stop_token, [this] { return !pending_steps.empty(); });
+
+                // Pending steps still run when stopping, without waiting for more
+                if (pending_steps.empty()) {
+                    return;
+                }
+
+                const auto deadline = pending_steps.front().submission_time + options.max_latency;
+
+                condition.wait_until(lock, stop_token, deadline, [this] {
+                    return pending_steps.size() >= options.max_batch_size;
+                });
+
+                batch = take_batch();
+            }
+
+            // Counted before the predictions are ready, so that waiting for them sees the counts
+            batches.fetch_add(1);
+            steps.fetch_add(batch.size());
+
+            run_batch(batch);
+        }
+    }
+} // namespace lc
@@ -0,0 +1,82 @@
+#ifndef LEXOCRAFT_COMPLETION_SCHEDULER_HPP
+#define LEXOCRAFT_COMPLETION_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <lexocraft/llm/completion_session.hpp>
+#include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/text_completion.hpp>
+
+namespace lc {
+    /*
+     Batches the next-token steps of many sessions over one model, so that the accumulator
+     weights are streamed once per batch instead of once per session. A batch runs when it has
+     max_batch_size steps or when its oldest step has waited max_latency.
+
+     Sessions join by submitting a step and leave by not submitting another one. A session has
+     to outlive its pending steps and must not be used elsewhere while they are pending.
+    */
+    class CompletionScheduler {
+        public:
+
+        struct Options {
+            std::size_t max_batch_size {64};
+            std::chrono::microseconds max_latency {1000};
+        };
+
+        CompletionScheduler(std::shared_ptr<const TextCompleter> model, Options options);
+        explicit CompletionScheduler(std::shared_ptr<const TextCompleter> model);
+
+        CompletionScheduler(const CompletionScheduler&) = delete;
+        CompletionScheduler& operator=(const CompletionScheduler&) = delete;
+
+        // Runs the steps that are still pending
+        ~CompletionScheduler();
+
+        // Same as session.predict_next_token_value(token), as part of a batch. Steps of one
+        // session run in the order they were submitted, in consecutive batches.
+        std::future<CompletionSession::Prediction> submit(CompletionSession& session,
+                                                          const grammar::Token& token);
+
+        [[nodiscard]] std::size_t batch_count() const;
+        [[nodiscard]] std::size_t step_count() const;
+
+        private:
+
+        struct Step {
+            CompletionSession* session;
+            grammar::Token token;
+            std::promise<CompletionSession::Prediction> prediction;
+            std::chrono::steady_clock::time_point submission_time;
+        };
+
+        // Oldest steps first, at most one per session
+        std::vector<Step> take_batch();
+        void run_batch(std::vector<Step>& batch) const;
+        void run(const std::stop_token& stop_token);
+
+        std::shared_ptr<const TextCompleter> model;
+        Options options;
+
+        std::mutex mutex;
+        std::condition_variable_any condition;
+        std::deque<Step> pending_steps;
+
+        std::atomic<std::size_t> batches {0};
+        std::atomic<std::size_t> steps {0};
+
+        std::jthread worker; // Last, so that it stops before the rest is destroyed
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_COMPLETION_SCHEDULER_HPP
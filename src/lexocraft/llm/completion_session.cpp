@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <random>
+#include <utility>
+
+#include <lexocraft/llm/completion_session.hpp>
+#include <lexocraft/llm/vector_database.hpp>
+
+namespace lc {
+    namespace {
+        struct Candidate {
+            grammar::Token token;
+            float similarity;
+        };
+
+        // The `count` words closest to a predicted word vector, closest first
+        std::vector<Candidate> closest_candidates(const TextCompleter& model,
+                                                  const TextCompleter::EphemeralMemoryNNOutput&
+                                                      prediction,
+                                                  std::size_t count,
+                                                  const GenerationOptions& options) {
+            const VectorDatabase& database = *model.vector_database;
+            std::vector<VectorDatabase::SearchResult> results =
+                options.is_type_constrained
+                    ? model.search_closest_predicted_n(prediction, static_cast<int>(count),
+                                                       options.typed_search)
+                    : database.search_closest_vector_value_n(prediction.word_vector_value,
+                                                             static_cast<int>(count));
+
+            std::vector<Candidate> candidates;
+            candidates.reserve(results.size());
+
+            for (VectorDatabase::SearchResult& result: results) {
+                // Only words a lowercase subdatabase respelled are looked up
+                const std::optional<std::size_t> vocabulary_id =
+                    result.word_index < database.words.size() &&
+                            database.words.word(result.word_index) == result.word.word
+                        ? std::optional<std::size_t> {result.word_index}
+                        : database.words.find(result.word.word);
+                const grammar::Token::Type type = grammar::token_type(result.word.word);
+
+                // The model predicts no spacing, generated words are separated by spaces
+                candidates.push_back(
+                    {grammar::Token {std::move(result.word.word), type, true,
+                                     vocabulary_id ? static_cast<std::uint32_t>(*vocabulary_id)
+                                                   : grammar::Token::NO_VOCABULARY_ID},
+                     result.similarity});
+            }
+
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [](const Candidate& first, const Candidate& second) {
+                                 return first.similarity > second.similarity;
+                             });
+
+            return candidates;
+        }
+
+        const Candidate& sample(const std::vector<Candidate>& candidates, float temperature,
+                                std::mt19937& random) {
+            if (candidates.size() == 1 || temperature <= 0.0F) {
+                return candidates.front();
+            }
+
+            // Softmax, shifted by the highest similarity so that no weight overflows
+            std::vector<double> weights;
+            weights.reserve(candidates.size());
+
+            for (const Candidate& candidate: candidates) {
+                weights.push_back(std::exp(
+                    static_cast<double>(candidate.similarity - candidates.front().similarity) /
+                    temperature));
+            }
+
+            std::discrete_distribution<std::size_t> distribution {weights.begin(), weights.end()};
+
+            return candidates [distribution(random)];
+        }
+    } // namespace
+
+    CompletionSession::CompletionSession(std::shared_ptr<const TextCompleter> model) :
+        model {std::move(model)}, state {this->model->new_session_state()} {
+    }
+
+    const CompletionSession::Prediction& CompletionSession::predict_next_token_value(
+        const grammar::Token& token, float sentence_length_mean, float sentence_length_stddev,
+        float flesch_kincaid_grade, float sentence_count) {
+        return model->predict_next_token_value(state, token, sentence_length_mean,
+                                               sentence_length_stddev, flesch_kincaid_grade,
+                                               sentence_count);
+    }
+
+    const CompletionSession::Prediction&
+        CompletionSession::predict_next_token_value(const grammar::Token& token) {
+        return model->predict_next_token_value(state, token);
+    }
+
+    CompletionSession& CompletionSession::start_new_section(float sentence_length_mean,
+                                                            float sentence_length_stddev,
+                                                            float flesch_kincaid_grade) {
+        model->accumulate_context_memory(state, sentence_length_mean, sentence_length_stddev,
+                                         flesch_kincaid_grade);
+        state.live_statistics = {};
+
+        return *this;
+    }
+
+    CompletionSession& CompletionSession::start_new_section() {
+        const TextStatistics& statistics = state.live_statistics;
+
+        return start_new_section(statistics.sentence_length_mean(),
+                                 statistics.sentence_length_stddev(),
+                                 statistics.flesch_kincaid_level());
+    }
+
+    CompletionSession& CompletionSession::reset() {
+        // The buffers keep their storage
+        state.ephemeral_memory.setZero();
+        state.context_memory.setZero();
+        state.live_statistics = {};
+        state.history_hash = model->initial_history_hash();
+
+        return *this;
+    }
+
+    SessionSnapshotPool::Handle CompletionSession::fork(SessionSnapshotPool& pool) const {
+        return pool.fork(state);
+    }
+
+    CompletionSession& CompletionSession::restore(const SessionSnapshot& snapshot) {
+        snapshot.restore(state);
+
+        return *this;
+    }
+
+    std::vector<grammar::Token> CompletionSession::generate(const std::string& prompt,
+                                                            std::size_t max_tokens,
+                                                            const TokenCallback& callback,
+                                                            const GenerationOptions& options) {
+        const std::vector<grammar::Token> prompt_tokens =
+            grammar::tokenize(prompt, *model->vector_database);
+
+        // Nothing to predict from
+        if (prompt_tokens.empty()) {
+            return {};
+        }
+
+        if (prefix_cache) {
+            static_cast<void>(prefix_cache->feed(*model, state, prompt_tokens));
+        } else {
+            for (const grammar::Token& token: prompt_tokens) {
+                static_cast<void>(predict_next_token_value(token));
+            }
+        }
+
+        if (options.beam_width > 1) {
+            return generate_beams(max_tokens, callback, options);
+        }
+
+        std::mt19937 random {options.seed};
+        std::vector<grammar::Token> tokens;
+
+        const std::size_t candidate_count = std::max<std::size_t>(1, options.top_k);
+
+        while (tokens.size() < max_tokens &&
+               state.last_prediction.is_end <= options.end_threshold) {
+            const std::vector<Candidate> candidates =
+                closest_candidates(*model, state.last_prediction, candidate_count, options);
+
+            if (candidates.empty()) {
+                break;
+            }
+
+            tokens.push_back(sample(candidates, options.temperature, random).token);
+
+            // Streamed before it is fed back, which is most of the time of a step
+            const bool is_continued = callback(tokens.back());
+            static_cast<void>(predict_next_token_value(tokens.back()));
+
+            if (!is_continued) {
+                break;
+            }
+        }
+
+        return tokens;
+    }
+
+    std::vector<grammar::Token> CompletionSession::generate_beams(
+        std::size_t max_tokens, const TokenCallback& callback, const GenerationOptions& options) {
+        struct Beam {
+            SessionSnapshotPool::Handle snapshot; // State after the tokens, once they are fed
+            const SessionSnapshot* parent; // State before the last token, until it is fed
+            std::vector<grammar::Token> tokens;
+            float similarity_sum;
+            bool is_ended;
+
+            // Mean similarity, so that longer beams aren't favored
+            [[nodiscard]] float score() const {
+                return tokens.empty() ? 0.0F
+                                      : similarity_sum / static_cast<float>(tokens.size());
+            }
+        };
+
+        // Beams fork snapshots of the recurrent state only, the states with network buffers
+        // are allocated once and restored from the parents of each step's beams
+        SessionSnapshotPool snapshot_pool {*model, 2 * options.beam_width};
+        std::vector<TextCompleter::SessionState> beam_states(options.beam_width,
+                                                             model->new_session_state());
+
+        std::vector<Beam> beams;
+        beams.push_back({snapshot_pool.fork(state), nullptr, {}, 0.0F,
+                         state.last_prediction.is_end > options.end_threshold});
+
+        std::size_t streamed_count {0};
+        bool is_stopped {false};
+
+        for (std::size_t step {0}; step < max_tokens && !is_stopped; ++step) {
+            std::vector<Beam> next_beams;
+
+            for (Beam& beam: beams) {
+                if (beam.is_ended) {
+                    next_beams.push_back(std::move(beam));
+                    continue;
+                }
+
+                std::vector<Candidate> candidates = closest_candidates(
+                    *model, beam.snapshot->last_prediction, options.beam_width, options);
+
+                for (Candidate& candidate: candidates) {
+                    Beam next_beam {nullptr, beam.snapshot.get(), beam.tokens,
+                                    beam.similarity_sum + candidate.similarity, false};
+                    next_beam.tokens.push_back(std::move(candidate.token));
+                    next_beams.push_back(std::move(next_beam));
+                }
+            }
+
+            // No beam had a word left to decode, the beams of the last step are kept
+            if (next_beams.empty()) {
+                break;
+            }
+
+            if (std::all_of(next_beams.begin(), next_beams.end(),
+                            [](const Beam& beam) { return beam.is_ended; })) {
+                beams = std::move(next_beams);
+                break;
+            }
+
+            std::stable_sort(next_beams.begin(), next_beams.end(),
+                             [](const Beam& first, const Beam& second) {
+                                 return first.score() > second.score();
+                             });
+            next_beams.resize(std::min(next_beams.size(), options.beam_width));
+
+            // The new tokens of every beam are fed in one batch
+            std::vector<TextCompleter::SessionState*> states;
+            std::vector<grammar::Token> tokens;
+
+            for (Beam& beam: next_beams) {
+                if (!beam.is_ended) {
+                    TextCompleter::SessionState& beam_state = beam_states [states.size()];
+                    beam.parent->restore(beam_state);
+
+                    states.push_back(&beam_state);
+                    tokens.push_back(beam.tokens.back());
+                }
+            }
+
+            model->predict_next_token_values(states, tokens);
+
+            std::size_t state_index {0};
+
+            for (Beam& beam: next_beams) {
+                if (!beam.is_ended) {
+                    beam.snapshot = snapshot_pool.fork(beam_states [state_index++]);
+                    beam.parent = nullptr;
+                    beam.is_ended = beam.snapshot->last_prediction.is_end > options.end_threshold;
+                }
+            }
+
+            // Releases the snapshots of the previous step
+            beams = std::move(next_beams);
+
+            // Tokens every beam agrees on can't change anymore
+            std::size_t agreed_count = beams.front().tokens.size();
+
+            for (const Beam& beam: beams) {
+                const auto [agreed_end, other_end] = std::mismatch(
+                    beams.front().tokens.begin(),
+                    std::next(beams.front().tokens.begin(),
+                              static_cast<std::ptrdiff_t>(agreed_count)),
+                    beam.tokens.begin(), beam.tokens.end(),
+                    [](const grammar::Token& first, const grammar::Token& second) {
+                        return first.value == second.value;
+                    });
+                agreed_count = static_cast<std::size_t>(
+                    std::distance(beams.front().tokens.begin(), agreed_end));
+            }
+
+            for (; streamed_count < agreed_count && !is_stopped; ++streamed_count) {
+                is_stopped = !callback(beams.front().tokens [streamed_count]);
+            }
+        }
+
+        // Beams are sorted by score, the first one is the best
+        Beam& best_beam = beams.front();
+
+        for (; streamed_count < best_beam.tokens.size() && !is_stopped; ++streamed_count) {
+            is_stopped = !callback(best_beam.tokens [streamed_count]);
+        }
+
+        // As when sampling, a stopped generation ends with the last streamed token. The beams
+        // never changed the session's state, which continues from the streamed tokens.
+        if (streamed_count < best_beam.tokens.size()) {
+            best_beam.tokens.erase(
+                std::next(best_beam.tokens.begin(), static_cast<std::ptrdiff_t>(streamed_count)),
+                best_beam.tokens.end());
+
+            for (const grammar::Token& token: best_beam.tokens) {
+                static_cast<void>(predict_next_token_value(token));
+            }
+
+            return std::move(best_beam.tokens);
+        }
+
+        best_beam.snapshot->restore(state);
+
+        return std::move(best_beam.tokens);
+    }
+} // namespace lc
@@ -0,0 +1,89 @@
+#ifndef LEXOCRAFT_COMPLETION_SESSION_HPP
+#define LEXOCRAFT_COMPLETION_SESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/prefix_cache.hpp>
+#include <lexocraft/llm/session_snapshot.hpp>
+#include <lexocraft/llm/text_completion.hpp>
+
+namespace lc {
+    struct GenerationOptions {
+        std::size_t top_k {1}; // Sampled among the top_k closest words, 1 takes the closest
+        float temperature {0.1F}; // Of the softmax over the similarities of the top_k words
+        std::size_t beam_width {1}; // Beam search over the closest words instead of sampling
+        float end_threshold {0.5F}; // Predictions with a higher is_end end the text
+        std::uint32_t seed {0};
+        // Searches only the words of the predicted type(s)
+        bool is_type_constrained {false};
+        TypedSearchOptions typed_search {};
+    };
+
+    /*
+     One conversation with a shared model. The model is const and only read, so any number of
+     sessions over it can predict in parallel, each one from its own thread.
+    */
+    class CompletionSession {
+        public:
+
+        using Prediction = TextCompleter::EphemeralMemoryNNOutput;
+
+        std::shared_ptr<const TextCompleter> model;
+        TextCompleter::SessionState state;
+
+        // Prompts of generate() are fed through it when set
+        std::shared_ptr<PrefixCache> prefix_cache {};
+
+        explicit CompletionSession(std::shared_ptr<const TextCompleter> model);
+
+        // Valid until the next prediction of this session
+        const Prediction& predict_next_token_value(const grammar::Token& token,
+                                                   float sentence_length_mean,
+                                                   float sentence_length_stddev,
+                                                   float flesch_kincaid_grade,
+                                                   float sentence_count);
+        const Prediction& predict_next_token_value(const grammar::Token& token);
+
+        CompletionSession& start_new_section(float sentence_length_mean,
+                                             float sentence_length_stddev,
+                                             float flesch_kincaid_grade);
+        // Ends the section with its live statistics
+        CompletionSession& start_new_section();
+
+        // Back to zeroed memories, as a new session
+        CompletionSession& reset();
+
+        // Branches the session to explore continuations and roll back, without copying the
+        // network buffers. The pool must be one of this session's model.
+        [[nodiscard]] SessionSnapshotPool::Handle fork(SessionSnapshotPool& pool) const;
+        CompletionSession& restore(const SessionSnapshot& snapshot);
+
+        // Returns false to stop generating
+        using TokenCallback = std::function<bool(const grammar::Token& token)>;
+
+        /*
+         Feeds the prompt, then decodes the word closest to each predicted word vector and feeds
+         it back, until a prediction ends the text or max_tokens were generated. Each token is
+         passed to `callback` as soon as it is decoded, with beams as soon as every beam agrees
+         on it. Returns every generated token, with beams the ones of the best beam, which the
+         session continues from. Once the callback stops it, only the streamed tokens.
+        */
+        std::vector<grammar::Token> generate(const std::string& prompt, std::size_t max_tokens,
+                                             const TokenCallback& callback,
+                                             const GenerationOptions& options = {});
+
+        private:
+
+        std::vector<grammar::Token> generate_beams(std::size_t max_tokens,
+                                                   const TokenCallback& callback,
+                                                   const GenerationOptions& options);
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_COMPLETION_SESSION_HPP
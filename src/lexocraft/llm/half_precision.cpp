@@ -0,0 +1,308 @@
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__F16C__) || defined(__AVX512F__)
+ #include <immintrin.h>
+#endif
+
+#include <lexocraft/llm/half_precision.hpp>
+
+namespace lc {
+    namespace {
+        const std::uint16_t* as_uint16(const void* data) {
+            return static_cast<const std::uint16_t*>(data);
+        }
+
+        std::uint16_t* as_uint16(void* data) {
+            return static_cast<std::uint16_t*>(data);
+        }
+
+#if defined(__AVX2__) && defined(__FMA__)
+        float horizontal_sum(__m256 sum) {
+            const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(sum),
+                                             _mm256_extractf128_ps(sum, 1));
+            const __m128 pairs = _mm_add_ps(halves, _mm_movehl_ps(halves, halves));
+
+            return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+        }
+#endif
+
+#if defined(__AVX2__)
+        __m256 load_bfloat16(const std::uint16_t* source) {
+            const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+
+            return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(packed), 16));
+        }
+#endif
+
+#if defined(__F16C__)
+        __m256 load_half(const std::uint16_t* source) {
+            return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+        }
+#endif
+    } // namespace
+
+    std::size_t precision_bytes(VectorPrecision precision) {
+        return precision == VectorPrecision::Float32 ? sizeof(float) : sizeof(std::uint16_t);
+    }
+
+    std::uint16_t float_to_half(float value) {
+        const auto bits = std::bit_cast<std::uint32_t>(value);
+        const std::uint32_t sign = (bits >> 16U) & 0x8000U;
+        const std::uint32_t exponent = (bits >> 23U) & 0xFFU;
+        std::uint32_t mantissa = bits & 0x7FFFFFU;
+
+        if (exponent == 0xFFU) {
+            // Infinity stays infinity, NaN stays a quiet NaN
+            return sign | 0x7C00U | (mantissa != 0 ? 0x200U : 0U);
+        }
+
+        const int half_exponent = static_cast<int>(exponent) - 127 + 15;
+
+        if (half_exponent >= 0x1F) {
+            return sign | 0x7C00U;
+        }
+
+        if (half_exponent <= 0) {
+            if (half_exponent < -10) {
+                return sign;
+            }
+
+            // Subnormal half, shift in the implicit bit and round away the lost bits
+            mantissa |= 0x800000U;
+
+            const auto shift = static_cast<std::uint32_t>(14 - half_exponent);
+            const std::uint32_t halfway = 1U << (shift - 1);
+            const std::uint32_t remainder = mantissa & ((1U << shift) - 1);
+            std::uint32_t half_mantissa = mantissa >> shift;
+
+            if (remainder > halfway || (remainder == halfway && (half_mantissa & 1U) != 0)) {
+                ++half_mantissa;
+            }
+
+            return sign | half_mantissa;
+        }
+
+        std::uint32_t half =
+            sign | (static_cast<std::uint32_t>(half_exponent) << 10U) | (mantissa >> 13U);
+        const std::uint32_t remainder = mantissa & 0x1FFFU;
+
+        // A carry out of the mantissa correctly rounds up into the exponent (and to infinity)
+        if (remainder > 0x1000U || (remainder == 0x1000U && (half & 1U) != 0)) {
+            ++half;
+        }
+
+        return half;
+    }
+
+    float half_to_float(std::uint16_t half) {
+        const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000U) << 16U;
+        const std::uint32_t exponent = (half >> 10U) & 0x1FU;
+        const std::uint32_t mantissa = half & 0x3FFU;
+
+        if (exponent == 0) {
+            const float magnitude = static_cast<float>(mantissa) * 0x1p-24F;
+
+            return sign != 0 ? -magnitude : magnitude;
+        }
+
+        if (exponent == 0x1F) {
+            return std::bit_cast<float>(sign | 0x7F800000U | (mantissa << 13U));
+        }
+
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23U) | (mantissa << 13U));
+    }
+
+    std::uint16_t float_to_bfloat16(float value) {
+        const auto bits = std::bit_cast<std::uint32_t>(value);
+
+        if ((bits & 0x7FFFFFFFU) > 0x7F800000U) {
+            return static_cast<std::uint16_t>((bits >> 16U) | 0x40U);
+        }
+
+        return static_cast<std::uint16_t>((bits + 0x7FFFU + ((bits >> 16U) & 1U)) >> 16U);
+    }
+
+    float bfloat16_to_float(std::uint16_t bfloat16) {
+        return std::bit_cast<float>(static_cast<std::uint32_t>(bfloat16) << 16U);
+    }
+
+    void narrow_vector(const float* source, void* destination, std::size_t count,
+                       VectorPrecision precision) {
+        std::size_t index {0};
+
+        switch (precision) {
+            case VectorPrecision::Float32: {
+                std::memcpy(destination, source, count * sizeof(float));
+                return;
+            }
+
+            case VectorPrecision::Float16: {
+                std::uint16_t* const output = as_uint16(destination);
+
+#if defined(__AVX512F__)
+                for (; index + 16 <= count; index += 16) {
+                    const __m512 values = _mm512_loadu_ps(source + index);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index),
+                                        _mm512_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+                }
+#endif
+
+#if defined(__F16C__)
+                for (; index + 8 <= count; index += 8) {
+                    const __m256 values = _mm256_loadu_ps(source + index);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index),
+                                     _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+                }
+#endif
+
+                for (; index < count; ++index) {
+                    output [index] = float_to_half(source [index]);
+                }
+
+                return;
+            }
+
+            case VectorPrecision::BFloat16: {
+                std::uint16_t* const output = as_uint16(destination);
+
+                for (; index < count; ++index) {
+                    output [index] = float_to_bfloat16(source [index]);
+                }
+
+                return;
+            }
+        }
+    }
+
+    void widen_vector(const void* source, float* destination, std::size_t count,
+                      VectorPrecision precision) {
+        std::size_t index {0};
+
+        switch (precision) {
+            case VectorPrecision::Float32: {
+                std::memcpy(destination, source, count * sizeof(float));
+                return;
+            }
+
+            case VectorPrecision::Float16: {
+                const std::uint16_t* const input = as_uint16(source);
+
+#if defined(__AVX512F__)
+                for (; index + 16 <= count; index += 16) {
+                    _mm512_storeu_ps(destination + index,
+                                     _mm512_cvtph_ps(_mm256_loadu_si256(
+                                         reinterpret_cast<const __m256i*>(input + index))));
+                }
+#endif
+
+#if defined(__F16C__)
+                for (; index + 8 <= count; index += 8) {
+                    _mm256_storeu_ps(destination + index, load_half(input + index));
+                }
+#endif
+
+                for (; index < count; ++index) {
+                    destination [index] = half_to_float(input [index]);
+                }
+
+                return;
+            }
+
+            case VectorPrecision::BFloat16: {
+                const std::uint16_t* const input = as_uint16(source);
+
+#if defined(__AVX2__)
+                for (; index + 8 <= count; index += 8) {
+                    _mm256_storeu_ps(destination + index, load_bfloat16(input + index));
+                }
+#endif
+
+                for (; index < count; ++index) {
+                    destination [index] = bfloat16_to_float(input [index]);
+                }
+
+                return;
+            }
+        }
+    }
+
+    float squared_distance(const void* vector, const float* query, std::size_t count,
+                           VectorPrecision precision) {
+        std::size_t index {0};
+        float distance {0.0F};
+
+        switch (precision) {
+            case VectorPrecision::Float32: {
+                const auto* const input = static_cast<const float*>(vector);
+
+#if defined(__AVX2__) && defined(__FMA__)
+                __m256 sum = _mm256_setzero_ps();
+
+                for (; index + 8 <= count; index += 8) {
+                    const __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(input + index),
+                                                            _mm256_loadu_ps(query + index));
+                    sum = _mm256_fmadd_ps(difference, difference, sum);
+                }
+
+                distance = horizontal_sum(sum);
+#endif
+
+                for (; index < count; ++index) {
+                    const float difference = input [index] - query [index];
+                    distance += difference * difference;
+                }
+
+                return distance;
+            }
+
+            case VectorPrecision::Float16: {
+                const std::uint16_t* const input = as_uint16(vector);
+
+#if defined(__F16C__) && defined(__AVX2__) && defined(__FMA__)
+                __m256 sum = _mm256_setzero_ps();
+
+                for (; index + 8 <= count; index += 8) {
+                    const __m256 difference =
+                        _mm256_sub_ps(load_half(input + index), _mm256_loadu_ps(query + index));
+                    sum = _mm256_fmadd_ps(difference, difference, sum);
+                }
+
+                distance = horizontal_sum(sum);
+#endif
+
+                for (; index < count; ++index) {
+                    const float difference = half_to_float(input [index]) - query [index];
+                    distance += difference * difference;
+                }
+
+                return distance;
+            }
+
+            case VectorPrecision::BFloat16: {
+                const std::uint16_t* const input = as_uint16(vector);
+
+#if defined(__AVX2__) && defined(__FMA__)
+                __m256 sum = _mm256_setzero_ps();
+
+                for (; index + 8 <= count; index += 8) {
+                    const __m256 difference = _mm256_sub_ps(load_bfloat16(input + index),
+                                                            _mm256_loadu_ps(query + index));
+                    sum = _mm256_fmadd_ps(difference, difference, sum);
+                }
+
+                distance = horizontal_sum(sum);
+#endif
+
+                for (; index < count; ++index) {
+                    const float difference = bfloat16_to_float(input [index]) - query [index];
+                    distance += difference * difference;
+                }
+
+                return distance;
+            }
+        }
+
+        return distance;
+    }
+} // namespace lc
@@ -0,0 +1,36 @@
+#ifndef LEXOCRAFT_HALF_PRECISION_HPP
+#define LEXOCRAFT_HALF_PRECISION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lc {
+    // Element type of stored word vectors, arithmetic is always done in float
+    enum class VectorPrecision : std::uint8_t {
+        Float32,
+        Float16,  // IEEE 754 binary16
+        BFloat16, // Upper half of a float
+    };
+
+    [[nodiscard]] std::size_t precision_bytes(VectorPrecision precision);
+
+    [[nodiscard]] std::uint16_t float_to_half(float value);
+    [[nodiscard]] float half_to_float(std::uint16_t half);
+    [[nodiscard]] std::uint16_t float_to_bfloat16(float value);
+    [[nodiscard]] float bfloat16_to_float(std::uint16_t bfloat16);
+
+    /*
+     Converts `count` elements between float and `precision`, with round to nearest even when
+     narrowing. Uses F16C / AVX-512 conversion instructions when the build enables them.
+    */
+    void narrow_vector(const float* source, void* destination, std::size_t count,
+                       VectorPrecision precision);
+    void widen_vector(const void* source, float* destination, std::size_t count,
+                      VectorPrecision precision);
+
+    // Squared euclidean distance between a stored vector and a float query, widened on the fly
+    [[nodiscard]] float squared_distance(const void* vector, const float* query, std::size_t count,
+                                         VectorPrecision precision);
+} // namespace lc
+
+#endif // LEXOCRAFT_HALF_PRECISION_HPP
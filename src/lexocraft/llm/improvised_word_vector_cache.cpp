@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <lexocraft/cereal_eigen.hpp>
+#include <lexocraft/hashing.hpp>
+#include <lexocraft/llm/improvised_word_vector_cache.hpp>
+
+namespace lc {
+    namespace {
+        struct SavedEntry {
+            std::string word;
+            Eigen::VectorXf vector;
+            grammar::Token::Type type;
+
+            template <class Archive>
+            void serialize(Archive& archive) {
+                archive(word, vector, type);
+            }
+        };
+    } // namespace
+
+    ImprovisedWordVectorCache::ImprovisedWordVectorCache(std::size_t capacity) :
+        shard_capacity {std::max(std::size_t {1}, capacity / SHARD_COUNT)} {
+    }
+
+    ImprovisedWordVectorCache::Shard&
+        ImprovisedWordVectorCache::shard_of(std::string_view word) const {
+        // Mixed so that the shard doesn't take the same bits as the buckets of its map
+        return shards [mix_hash(WordStorage::WordHash {}(word)) % SHARD_COUNT];
+    }
+
+    std::optional<ImprovisedWordVectorCache::Entry>
+        ImprovisedWordVectorCache::find(std::string_view word, std::uint64_t version) const {
+        Entry entry;
+
+        if (const std::optional<grammar::Token::Type> type = find(word, version, entry.vector)) {
+            entry.type = type.value();
+
+            return entry;
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<grammar::Token::Type>
+        ImprovisedWordVectorCache::find(std::string_view word, std::uint64_t version,
+                                        Eigen::VectorXf& vector) const {
+        Shard& shard = shard_of(word);
+        const std::scoped_lock lock {shard.mutex};
+
+        const auto position = shard.entries.find(word);
+
+        if (position == shard.entries.end() || position->second.version != version) {
+            ++misses;
+
+            return std::nullopt;
+        }
+
+        ++hits;
+
+        vector = position->second.entry.vector;
+
+        return position->second.entry.type;
+    }
+
+    void ImprovisedWordVectorCache::insert(const std::string& word, std::uint64_t version,
+                                           const Entry& entry) {
+        Shard& shard = shard_of(word);
+        const std::scoped_lock lock {shard.mutex};
+
+        // A stale entry is replaced in place and keeps its age
+        const bool is_new = shard.entries.find(word) == shard.entries.end();
+
+        if (is_new && shard.entries.size() >= shard_capacity) {
+            shard.entries.erase(shard.insertion_order.front());
+            shard.insertion_order.pop_front();
+        }
+
+        shard.entries.insert_or_assign(word, VersionedEntry {entry, version});
+
+        if (is_new) {
+            shard.insertion_order.push_back(word);
+        }
+    }
+
+    void ImprovisedWordVectorCache::clear() {
+        for (Shard& shard: shards) {
+            const std::scoped_lock lock {shard.mutex};
+
+            shard.entries.clear();
+            shard.insertion_order.clear();
+        }
+    }
+
+    std::size_t ImprovisedWordVectorCache::size() const {
+        std::size_t entry_count {0};
+
+        for (const Shard& shard: shards) {
+            const std::scoped_lock lock {shard.mutex};
+
+            entry_count += shard.entries.size();
+        }
+
+        return entry_count;
+    }
+
+    std::size_t ImprovisedWordVectorCache::capacity() const {
+        return shard_capacity * SHARD_COUNT;
+    }
+
+    std::uint64_t ImprovisedWordVectorCache::hit_count() const {
+        return hits;
+    }
+
+    std::uint64_t ImprovisedWordVectorCache::miss_count() const {
+        return misses;
+    }
+
+    void ImprovisedWordVectorCache::save_file(const std::filesystem::path& filepath,
+                                              std::uint64_t version,
+                                              std::uint64_t improviser_fingerprint,
+                                              std::uint64_t vocabulary_fingerprint) const {
+        std::vector<SavedEntry> saved_entries;
+
+        for (const Shard& shard: shards) {
+            const std::scoped_lock lock {shard.mutex};
+
+            // Oldest first, so that loading evicts in the same order
+            for (const std::string& word: shard.insertion_order) {
+                const VersionedEntry& versioned_entry = shard.entries.at(word);
+
+                if (versioned_entry.version == version) {
+                    saved_entries.push_back(
+                        {word, versioned_entry.entry.vector, versioned_entry.entry.type});
+                }
+            }
+        }
+
+        std::ofstream file {filepath, std::ios::binary};
+
+        cereal::BinaryOutputArchive archive {file};
+
+        archive(improviser_fingerprint, vocabulary_fingerprint, saved_entries);
+    }
+
+    bool ImprovisedWordVectorCache::load_file(const std::filesystem::path& filepath,
+                                              std::uint64_t version,
+                                              std::uint64_t improviser_fingerprint,
+                                              std::uint64_t vocabulary_fingerprint) {
+        std::ifstream file {filepath, std::ios::binary};
+
+        cereal::BinaryInputArchive archive {file};
+
+        std::uint64_t saved_improviser_fingerprint {0};
+        std::uint64_t saved_vocabulary_fingerprint {0};
+        archive(saved_improviser_fingerprint, saved_vocabulary_fingerprint);
+
+        if (saved_improviser_fingerprint != improviser_fingerprint ||
+            saved_vocabulary_fingerprint != vocabulary_fingerprint) {
+            return false;
+        }
+
+        std::vector<SavedEntry> saved_entries;
+        archive(saved_entries);
+
+        for (SavedEntry& saved_entry: saved_entries) {
+            insert(saved_entry.word, version,
+                   {std::move(saved_entry.vector), saved_entry.type});
+        }
+
+        return true;
+    }
+} // namespace lc
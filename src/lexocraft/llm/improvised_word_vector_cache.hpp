@@ -0,0 +1,95 @@
+#ifndef LEXOCRAFT_IMPROVISED_WORD_VECTOR_CACHE_HPP
+#define LEXOCRAFT_IMPROVISED_WORD_VECTOR_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <Eigen/Eigen>
+#include <tsl/robin_map.h>
+
+#include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/vector_database.hpp>
+
+namespace lc {
+    /*
+     Word vectors improvised for out-of-vocabulary words, keyed by word and by the version of
+     what computed them, the improviser network and the words it improvised from. Entries of
+     another version are misses, so a changed network or vocabulary invalidates the cache
+     without clearing it.
+
+     Words are spread over shards with a lock each, so that concurrent sessions rarely wait on
+     each other. A full shard evicts its oldest entry.
+    */
+    class ImprovisedWordVectorCache {
+        public:
+
+        struct Entry {
+            Eigen::VectorXf vector;
+            grammar::Token::Type type;
+        };
+
+        constexpr static std::size_t SHARD_COUNT {16};
+        constexpr static std::size_t DEFAULT_CAPACITY {std::size_t {1} << 16U};
+
+        explicit ImprovisedWordVectorCache(std::size_t capacity = DEFAULT_CAPACITY);
+
+        ImprovisedWordVectorCache(const ImprovisedWordVectorCache&) = delete;
+        ImprovisedWordVectorCache& operator=(const ImprovisedWordVectorCache&) = delete;
+
+        [[nodiscard]] std::optional<Entry> find(std::string_view word,
+                                                std::uint64_t version) const;
+        // Same as find(), the vector is copied into `vector`, which keeps its storage
+        [[nodiscard]] std::optional<grammar::Token::Type>
+            find(std::string_view word, std::uint64_t version, Eigen::VectorXf& vector) const;
+        void insert(const std::string& word, std::uint64_t version, const Entry& entry);
+
+        void clear();
+
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] std::size_t capacity() const;
+        [[nodiscard]] std::uint64_t hit_count() const;
+        [[nodiscard]] std::uint64_t miss_count() const;
+
+        // Versions only hold within one run, files are matched with NeuralNetwork::fingerprint()
+        // and WordStorage::fingerprint(). Only entries of `version` are saved, loaded entries
+        // take `version`. Returns false when the file belongs to another network or vocabulary,
+        // which leaves the cache unchanged.
+        void save_file(const std::filesystem::path& filepath, std::uint64_t version,
+                       std::uint64_t improviser_fingerprint,
+                       std::uint64_t vocabulary_fingerprint) const;
+        bool load_file(const std::filesystem::path& filepath, std::uint64_t version,
+                       std::uint64_t improviser_fingerprint, std::uint64_t vocabulary_fingerprint);
+
+        private:
+
+        struct VersionedEntry {
+            Entry entry;
+            std::uint64_t version;
+        };
+
+        struct Shard {
+            mutable std::mutex mutex;
+            tsl::robin_map<std::string, VersionedEntry, WordStorage::WordHash, std::equal_to<>>
+                entries;
+            std::deque<std::string> insertion_order;
+        };
+
+        [[nodiscard]] Shard& shard_of(std::string_view word) const;
+
+        std::size_t shard_capacity;
+        mutable std::array<Shard, SHARD_COUNT> shards;
+
+        mutable std::atomic<std::uint64_t> hits {0};
+        mutable std::atomic<std::uint64_t> misses {0};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_IMPROVISED_WORD_VECTOR_CACHE_HPP
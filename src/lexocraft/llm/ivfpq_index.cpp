@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include <lexocraft/llm/ivfpq_index.hpp>
+
+namespace lc {
+    // Columns processed per distance GEMM, keeps the (centroids x block) scratch matrix small
+    constexpr Eigen::Index ASSIGNMENT_BLOCK_SIZE {4096};
+
+    std::vector<int> nearest_centroids(const Eigen::Ref<const Eigen::MatrixXf>& centroids,
+                                       const Eigen::Ref<const Eigen::VectorXf>& squared_norms,
+                                       const Eigen::Ref<const Eigen::MatrixXf>& data) {
+        std::vector<int> nearest(data.cols());
+        Eigen::MatrixXf distances;
+
+        for (Eigen::Index start {0}; start < data.cols(); start += ASSIGNMENT_BLOCK_SIZE) {
+            const Eigen::Index block_size = std::min(ASSIGNMENT_BLOCK_SIZE, data.cols() - start);
+
+            // |x - c|^2 = |x|^2 - 2 c.x + |c|^2, the |x|^2 term does not change the argmin
+            distances.noalias() =
+                -2.0F * centroids.transpose() * data.middleCols(start, block_size);
+            distances.colwise() += squared_norms;
+
+            for (Eigen::Index column {0}; column < block_size; ++column) {
+                Eigen::Index nearest_index {};
+                distances.col(column).minCoeff(&nearest_index);
+                nearest [start + column] = static_cast<int>(nearest_index);
+            }
+        }
+
+        return nearest;
+    }
+
+    Eigen::MatrixXf kmeans(const Eigen::Ref<const Eigen::MatrixXf>& data, std::size_t clusters,
+                           std::size_t iterations, std::uint64_t seed) {
+        const Eigen::Index count = data.cols();
+        const Eigen::Index cluster_count =
+            std::min(static_cast<Eigen::Index>(clusters), count);
+
+        std::mt19937_64 generator {seed};
+        std::uniform_int_distribution<Eigen::Index> random_column {
+            0, std::max<Eigen::Index>(count - 1, 0)};
+
+        std::vector<Eigen::Index> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), generator);
+
+        Eigen::MatrixXf centroids(data.rows(), cluster_count);
+
+        for (Eigen::Index cluster {0}; cluster < cluster_count; ++cluster) {
+            centroids.col(cluster) = data.col(order [cluster]);
+        }
+
+        Eigen::MatrixXf sums(data.rows(), cluster_count);
+        std::vector<Eigen::Index> members(cluster_count);
+
+        for (std::size_t iteration {0}; iteration < iterations; ++iteration) {
+            const Eigen::VectorXf squared_norms = centroids.colwise().squaredNorm().transpose();
+            const std::vector<int> assignments = nearest_centroids(centroids, squared_norms, data);
+
+            sums.setZero();
+            std::fill(members.begin(), members.end(), 0);
+
+            for (Eigen::Index column {0}; column < count; ++column) {
+                sums.col(assignments [column]) += data.col(column);
+                ++members [assignments [column]];
+            }
+
+            for (Eigen::Index cluster {0}; cluster < cluster_count; ++cluster) {
+                if (members [cluster] == 0) {
+                    // Reseed empty clusters instead of letting them die
+                    centroids.col(cluster) = data.col(random_column(generator));
+                    continue;
+                }
+
+                centroids.col(cluster) = sums.col(cluster) / static_cast<float>(members [cluster]);
+            }
+        }
+
+        return centroids;
+    }
+
+    IVFPQIndex::IVFPQIndex(std::size_t dimensions) : dimensions(dimensions) {
+    }
+
+    IVFPQIndex& IVFPQIndex::train(const Eigen::Ref<const Eigen::MatrixXf>& vectors,
+                                  const Parameters& parameters) {
+        assert(static_cast<std::size_t>(vectors.rows()) == dimensions);
+        assert(parameters.subquantizers > 0 && dimensions % parameters.subquantizers == 0);
+        assert(vectors.cols() > 0 && "Cannot train an IVF-PQ index without vectors");
+
+        this->parameters = parameters;
+        subvector_dimensions = dimensions / parameters.subquantizers;
+
+        const Eigen::Index sample_size = std::min(
+            static_cast<Eigen::Index>(parameters.training_sample_size), vectors.cols());
+
+        std::mt19937_64 generator {parameters.seed};
+        std::vector<Eigen::Index> order(vectors.cols());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), generator);
+
+        Eigen::MatrixXf sample(dimensions, sample_size);
+
+        for (Eigen::Index column {0}; column < sample_size; ++column) {
+            sample.col(column) = vectors.col(order [column]);
+        }
+
+        coarse_centroids = kmeans(sample, parameters.coarse_cells, parameters.kmeans_iterations,
+                                  parameters.seed);
+        coarse_centroid_squared_norms = coarse_centroids.colwise().squaredNorm().transpose();
+
+        const std::vector<int> assignments =
+            nearest_centroids(coarse_centroids, coarse_centroid_squared_norms, sample);
+
+        for (Eigen::Index column {0}; column < sample_size; ++column) {
+            sample.col(column) -= coarse_centroids.col(assignments [column]);
+        }
+
+        subquantizer_codebooks.clear();
+
+        for (std::size_t subquantizer {0}; subquantizer < parameters.subquantizers;
+             ++subquantizer) {
+            subquantizer_codebooks.push_back(
+                kmeans(sample.middleRows(subquantizer * subvector_dimensions, subvector_dimensions),
+                       SUBQUANTIZER_CENTROIDS, parameters.kmeans_iterations,
+                       parameters.seed + subquantizer + 1));
+        }
+
+        cell_items.assign(coarse_centroids.cols(), {});
+        cell_codes.assign(coarse_centroids.cols(), {});
+
+        return *this;
+    }
+
+    void IVFPQIndex::encode(const Eigen::Ref<const Eigen::MatrixXf>& vectors,
+                            const std::vector<int>& assigned_cells, std::uint8_t* codes) const {
+        const std::size_t subquantizers = parameters.subquantizers;
+
+        Eigen::MatrixXf residuals = vectors;
+
+        for (Eigen::Index column {0}; column < residuals.cols(); ++column) {
+            residuals.col(column) -= coarse_centroids.col(assigned_cells [column]);
+        }
+
+        for (std::size_t subquantizer {0}; subquantizer < subquantizers; ++subquantizer) {
+            const Eigen::MatrixXf& codebook = subquantizer_codebooks [subquantizer];
+
+            const std::vector<int> nearest = nearest_centroids(
+                codebook, codebook.colwise().squaredNorm().transpose(),
+                residuals.middleRows(subquantizer * subvector_dimensions, subvector_dimensions));
+
+            for (std::size_t column {0}; column < nearest.size(); ++column) {
+                codes [column * subquantizers + subquantizer] =
+                    static_cast<std::uint8_t>(nearest [column]);
+            }
+        }
+    }
+
+    IVFPQIndex& IVFPQIndex::add_items(const Eigen::Ref<const Eigen::MatrixXf>& vectors,
+                                      int first_item) {
+        assert(is_trained() && "IVF-PQ index must be trained before adding items");
+        assert(static_cast<std::size_t>(vectors.rows()) == dimensions);
+
+        const std::size_t subquantizers = parameters.subquantizers;
+        std::vector<std::uint8_t> codes;
+
+        for (Eigen::Index start {0}; start < vectors.cols(); start += ASSIGNMENT_BLOCK_SIZE) {
+            const Eigen::Index block_size = std::min(ASSIGNMENT_BLOCK_SIZE, vectors.cols() - start);
+            const auto block = vectors.middleCols(start, block_size);
+
+            const std::vector<int> assigned_cells =
+                nearest_centroids(coarse_centroids, coarse_centroid_squared_norms, block);
+
+            codes.resize(block_size * subquantizers);
+            encode(block, assigned_cells, codes.data());
+
+            for (Eigen::Index column {0}; column < block_size; ++column) {
+                const int cell = assigned_cells [column];
+                const auto code_begin = std::next(codes.begin(), column * subquantizers);
+
+                cell_items [cell].push_back(first_item + static_cast<int>(start + column));
+                cell_codes [cell].insert(cell_codes [cell].end(), code_begin,
+                                         std::next(code_begin, subquantizers));
+            }
+        }
+
+        return *this;
+    }
+
+    IVFPQIndex& IVFPQIndex::add_item(int item, const float* vector) {
+        return add_items(Eigen::Map<const Eigen::VectorXf>(vector, dimensions), item);
+    }
+
+    IVFPQIndex& IVFPQIndex::remove_item(int item) {
+        const std::size_t subquantizers = parameters.subquantizers;
+
+        for (std::size_t cell {0}; cell < cell_items.size(); ++cell) {
+            std::vector<int>& items = cell_items [cell];
+            const auto found = std::find(items.begin(), items.end(), item);
+
+            if (found != items.end()) {
+                const std::ptrdiff_t position = std::distance(items.begin(), found);
+                const auto code_begin = std::next(
+                    cell_codes [cell].begin(),
+                    position * static_cast<std::ptrdiff_t>(subquantizers));
+
+                items.erase(found);
+                cell_codes [cell].erase(code_begin,
+                                        std::next(code_begin,
+                                                  static_cast<std::ptrdiff_t>(subquantizers)));
+
+                break;
+            }
+        }
+
+        return *this;
+    }
+
+    IVFPQIndex& IVFPQIndex::clear_items() {
+        for (std::size_t cell {0}; cell < cell_items.size(); ++cell) {
+            cell_items [cell].clear();
+            cell_codes [cell].clear();
+        }
+
+        return *this;
+    }
+
+    std::vector<IVFPQIndex::Neighbor> IVFPQIndex::search(const float* query, std::size_t top_n,
+                                                         std::size_t probed_cells) const {
+        std::vector<Neighbor> neighbors;
+
+        if (!is_trained() || top_n == 0) {
+            return neighbors;
+        }
+
+        const Eigen::Map<const Eigen::VectorXf> query_vector(query, dimensions);
+        const std::size_t subquantizers = parameters.subquantizers;
+        const std::size_t cell_count = coarse_centroids.cols();
+
+        probed_cells = std::clamp(probed_cells, std::size_t {1}, cell_count);
+
+        const Eigen::VectorXf coarse_distances =
+            coarse_centroid_squared_norms - 2.0F * coarse_centroids.transpose() * query_vector;
+
+        std::vector<int> cells(cell_count);
+        std::iota(cells.begin(), cells.end(), 0);
+        std::partial_sort(cells.begin(), std::next(cells.begin(), probed_cells), cells.end(),
+                          [&coarse_distances](int first_cell, int second_cell) {
+                              return coarse_distances(first_cell) < coarse_distances(second_cell);
+                          });
+
+        // Max-heap on distance, the front is the worst neighbor kept so far
+        const auto closer = [](const Neighbor& first, const Neighbor& second) {
+            return first.squared_distance < second.squared_distance;
+        };
+
+        neighbors.reserve(top_n);
+
+        // One column of 256 partial distances per subquantizer
+        Eigen::MatrixXf lookup_table(subquantizer_codebooks.front().cols(), subquantizers);
+        Eigen::VectorXf residual(dimensions);
+
+        for (std::size_t probe {0}; probe < probed_cells; ++probe) {
+            const int cell = cells [probe];
+            const std::vector<int>& items = cell_items [cell];
+
+            if (items.empty()) {
+                continue;
+            }
+
+            residual = query_vector - coarse_centroids.col(cell);
+
+            for (std::size_t subquantizer {0}; subquantizer < subquantizers; ++subquantizer) {
+                lookup_table.col(subquantizer) =
+                    (subquantizer_codebooks [subquantizer].colwise() -
+                     residual.segment(subquantizer * subvector_dimensions, subvector_dimensions))
+                        .colwise()
+                        .squaredNorm()
+                        .transpose();
+            }
+
+            const std::uint8_t* code = cell_codes [cell].data();
+
+            for (const int item: items) {
+                float squared_distance {};
+
+                for (std::size_t subquantizer {0}; subquantizer < subquantizers; ++subquantizer) {
+                    squared_distance += lookup_table(code [subquantizer], subquantizer);
+                }
+
+                code += subquantizers;
+
+                if (neighbors.size() < top_n) {
+                    neighbors.push_back({item, squared_distance});
+                    std::push_heap(neighbors.begin(), neighbors.end(), closer);
+                }
+
+                else if (squared_distance < neighbors.front().squared_distance) {
+                    std::pop_heap(neighbors.begin(), neighbors.end(), closer);
+                    neighbors.back() = {item, squared_distance};
+                    std::push_heap(neighbors.begin(), neighbors.end(), closer);
+                }
+            }
+        }
+
+        std::sort_heap(neighbors.begin(), neighbors.end(), closer);
+
+        return neighbors;
+    }
+
+    bool IVFPQIndex::is_trained() const {
+        return coarse_centroids.cols() > 0;
+    }
+
+    bool IVFPQIndex::is_consistent(std::size_t item_count) const {
+        const std::size_t subquantizers = parameters.subquantizers;
+        const auto cell_count = static_cast<std::size_t>(coarse_centroids.cols());
+
+        if (subquantizers == 0 || subvector_dimensions * subquantizers != dimensions ||
+            static_cast<std::size_t>(coarse_centroids.rows()) != dimensions ||
+            subquantizer_codebooks.size() != subquantizers || cell_items.size() != cell_count ||
+            cell_codes.size() != cell_count) {
+            return false;
+        }
+
+        // Codebooks of small training sets have fewer centroids, the codes index them
+        const Eigen::Index centroid_count =
+            subquantizer_codebooks.empty() ? 0 : subquantizer_codebooks.front().cols();
+
+        for (const Eigen::MatrixXf& codebook: subquantizer_codebooks) {
+            if (static_cast<std::size_t>(codebook.rows()) != subvector_dimensions ||
+                codebook.cols() != centroid_count || centroid_count == 0 ||
+                static_cast<std::size_t>(centroid_count) > SUBQUANTIZER_CENTROIDS) {
+                return false;
+            }
+        }
+
+        for (std::size_t cell {0}; cell < cell_count; ++cell) {
+            const std::vector<int>& items = cell_items [cell];
+            const std::vector<std::uint8_t>& codes = cell_codes [cell];
+
+            if (codes.size() != items.size() * subquantizers ||
+                std::any_of(items.begin(), items.end(),
+                            [&](int item) {
+                                return item < 0 || static_cast<std::size_t>(item) >= item_count;
+                            }) ||
+                std::any_of(codes.begin(), codes.end(),
+                            [&](std::uint8_t code) { return code >= centroid_count; })) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::size_t IVFPQIndex::size() const {
+        return std::accumulate(cell_items.begin(), cell_items.end(), std::size_t {0},
+                               [](std::size_t total, const std::vector<int>& items) {
+                                   return total + items.size();
+                               });
+    }
+
+    std::size_t IVFPQIndex::memory_usage() const {
+        std::size_t bytes = coarse_centroids.size() * sizeof(float) +
+                            coarse_centroid_squared_norms.size() * sizeof(float);
+
+        for (const Eigen::MatrixXf& codebook: subquantizer_codebooks) {
+            bytes += codebook.size() * sizeof(float);
+        }
+
+        for (std::size_t cell {0}; cell < cell_items.size(); ++cell) {
+            bytes += cell_items [cell].capacity() * sizeof(int) + cell_codes [cell].capacity() +
+                     sizeof(cell_items [cell]) + sizeof(cell_codes [cell]);
+        }
+
+        return bytes;
+    }
+} // namespace lc
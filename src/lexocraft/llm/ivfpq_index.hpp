@@ -0,0 +1,120 @@
+#ifndef LEXOCRAFT_IVFPQ_INDEX_HPP
+#define LEXOCRAFT_IVFPQ_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <cereal/types/vector.hpp>
+#include <Eigen/Eigen>
+
+#include <lexocraft/cereal_eigen.hpp>
+
+namespace lc {
+    struct IVFPQParameters {
+        std::size_t coarse_cells {1024};
+        std::size_t subquantizers {8}; // Bytes per code, must divide the dimension count
+        std::size_t kmeans_iterations {20};
+        std::size_t training_sample_size {1 << 16};
+        std::uint64_t seed {0};
+
+        template <class Archive>
+        void serialize(Archive& archive) {
+            archive(coarse_cells, subquantizers, kmeans_iterations, training_sample_size, seed);
+        }
+    };
+
+    /*
+     Inverted file index with product quantization (IVFADC).
+
+     Vectors are assigned to the nearest of `coarse_cells` k-means centroids and the residual to
+     that centroid is split into `subquantizers` subvectors, each encoded as one byte (the index of
+     the nearest of 256 subspace centroids). A vector therefore costs `subquantizers` bytes plus its
+     item id instead of `dimensions` floats.
+
+     Searching probes the `probed_cells` closest coarse cells and scores every code in them with
+     asymmetric distance lookup tables (the query is never quantized).
+    */
+    class IVFPQIndex {
+        public:
+
+        static constexpr std::size_t SUBQUANTIZER_CENTROIDS = 256;
+
+        using Parameters = IVFPQParameters;
+
+        struct Neighbor {
+            int item;
+            float squared_distance;
+        };
+
+        IVFPQIndex() = default;
+        IVFPQIndex(const IVFPQIndex&) = default;
+        IVFPQIndex(IVFPQIndex&&) = default;
+        IVFPQIndex& operator=(const IVFPQIndex&) = default;
+        IVFPQIndex& operator=(IVFPQIndex&&) = default;
+
+        explicit IVFPQIndex(std::size_t dimensions);
+
+        /* `vectors` is a (dimensions x count) column-major matrix */
+        IVFPQIndex& train(const Eigen::Ref<const Eigen::MatrixXf>& vectors,
+                          const Parameters& parameters = {});
+
+        IVFPQIndex& add_item(int item, const float* vector);
+        IVFPQIndex& add_items(const Eigen::Ref<const Eigen::MatrixXf>& vectors,
+                              int first_item = 0);
+
+        // Scans every cell, the item is found by its id
+        IVFPQIndex& remove_item(int item);
+        IVFPQIndex& clear_items();
+
+        [[nodiscard]] std::vector<Neighbor> search(const float* query, std::size_t top_n,
+                                                   std::size_t probed_cells = 16) const;
+
+        [[nodiscard]] bool is_trained() const;
+        // Whether the shapes of a loaded index agree and every item is below item_count
+        [[nodiscard]] bool is_consistent(std::size_t item_count) const;
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] std::size_t memory_usage() const; /* Bytes */
+
+        std::size_t dimensions {};
+        std::size_t subvector_dimensions {};
+        Parameters parameters {};
+
+        Eigen::MatrixXf coarse_centroids;                   // dimensions x coarse_cells
+        Eigen::VectorXf coarse_centroid_squared_norms;      // coarse_cells
+        std::vector<Eigen::MatrixXf> subquantizer_codebooks; // subvector_dimensions x 256 each
+
+        std::vector<std::vector<int>> cell_items;
+        std::vector<std::vector<std::uint8_t>> cell_codes; // subquantizers bytes per item
+
+        template <class Archive>
+        void save(Archive& archive) const {
+            archive(dimensions, subvector_dimensions, parameters, coarse_centroids,
+                    subquantizer_codebooks, cell_items, cell_codes);
+        }
+
+        template <class Archive>
+        void load(Archive& archive) {
+            archive(dimensions, subvector_dimensions, parameters, coarse_centroids,
+                    subquantizer_codebooks, cell_items, cell_codes);
+
+            coarse_centroid_squared_norms = coarse_centroids.colwise().squaredNorm().transpose();
+        }
+
+        private:
+
+        void encode(const Eigen::Ref<const Eigen::MatrixXf>& vectors,
+                    const std::vector<int>& assigned_cells, std::uint8_t* codes) const;
+    };
+
+    /* Lloyd's k-means over the columns of `data`, returns a (rows x clusters) centroid matrix */
+    Eigen::MatrixXf kmeans(const Eigen::Ref<const Eigen::MatrixXf>& data, std::size_t clusters,
+                           std::size_t iterations, std::uint64_t seed);
+
+    /* Index of the nearest column of `centroids` for every column of `data` */
+    std::vector<int> nearest_centroids(const Eigen::Ref<const Eigen::MatrixXf>& centroids,
+                                       const Eigen::Ref<const Eigen::VectorXf>& squared_norms,
+                                       const Eigen::Ref<const Eigen::MatrixXf>& data);
+} // namespace lc
+
+#endif // LEXOCRAFT_IVFPQ_INDEX_HPP
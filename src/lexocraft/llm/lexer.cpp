@@ -1,42 +1,73 @@
 #include <algorithm>
-#include <cctype>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
-#include <span>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include <BS_thread_pool.hpp>
+
+#include <lexocraft/llm/character_classes.hpp>
 #include <lexocraft/llm/lexer.hpp>
 
 namespace lc::grammar {
-    Token::Token(std::string&& value, Token::Type type, bool next_is_space) :
-        value {value}, type {type}, next_is_space {next_is_space} {
+    Token::Token(std::string&& value, Token::Type type, bool next_is_space,
+                 std::uint32_t vocabulary_id) :
+        value {std::move(value)}, type {type}, next_is_space {next_is_space},
+        vocabulary_id {vocabulary_id} {
+    }
+
+    bool Token::has_vocabulary_id() const {
+        return vocabulary_id != NO_VOCABULARY_ID;
+    }
+
+    std::string_view CompactToken::value(std::string_view text) const {
+        return text.substr(offset, length);
+    }
+
+    Token CompactToken::to_token(std::string_view text) const {
+        return Token {std::string {value(text)}, type, next_is_space, vocabulary_id};
+    }
+
+    bool CompactToken::has_vocabulary_id() const {
+        return vocabulary_id != Token::NO_VOCABULARY_ID;
     }
 
     bool is_component_symbol(char letter) {
-        return std::string {"~_/-'."}.find(letter) != std::string::npos;
+        return (character_classes(letter) & character_class::COMPONENT_SYMBOL) != 0;
     }
 
     bool is_terminating_symbol(const std::optional<const char>& letter) {
-        if (!letter.has_value()) {
-            return true;
-        }
-
-        return std::isalpha(letter.value()) == 0;
+        return !letter.has_value() || !is_letter(letter.value());
     }
 
-    Token::Type token_type(const std::string& value) {
+    Token::Type token_type(std::string_view value) {
+        const std::uint8_t alphanumeric = character_class::LETTER | character_class::DIGIT;
+
         // Check for acronyms first, as they have a stricter pattern
-        if (value.size() == 1 && (std::isalnum(value.at(0)) == 0)) {
+        if (value.size() == 1 && (character_classes(value.front()) & alphanumeric) == 0) {
             return Token::Type::Symbol;
         }
 
-        if (std::all_of(value.begin(), value.end(), ::isalpha)) {
+        std::uint8_t shared_classes = alphanumeric;
+
+        for (const char letter: value) {
+            shared_classes &= character_classes(letter);
+        }
+
+        if ((shared_classes & character_class::LETTER) != 0) {
             return Token::Type::Alphanumeric;
         }
 
-        // Check for digits
-        if (std::all_of(value.begin(), value.end(), ::isdigit)) {
+        if ((shared_classes & character_class::DIGIT) != 0) {
             return Token::Type::Digit;
         }
 
@@ -44,101 +75,300 @@ namespace lc::grammar {
         return Token::Type::Homogeneous;
     }
 
-    std::vector<Token> tokenize(const std::string& text, const VectorDatabase& vector_database) {
-        const std::size_t longest_element_size = vector_database.longest_element();
-        const std::size_t text_length = text.size();
-        const std::span<const char> text_span {text};
-        std::vector<Token> tokens;
+    namespace {
+        constexpr std::size_t TOKENIZE_CHUNK_SIZE = std::size_t {1} << 18U;
 
-        for (std::size_t index {}; index < text_length;) {
-            const bool is_space = text.at(index) == ' ';
+        struct TokenSpan {
+            std::size_t offset;
+            std::size_t length;
+            std::uint32_t vocabulary_id;
+            Token::Type type;
+            bool next_is_space;
 
-            std::optional<Token> longest_possible_token_for_this_index_from_database {};
+            [[nodiscard]] Token to_token(std::string_view text) const {
+                return Token {std::string {text.substr(offset, length)}, type, next_is_space,
+                              vocabulary_id};
+            }
+        };
 
-            for (std::size_t span_index {1};
-                 (span_index <= longest_element_size) && (index + span_index <= text_length);
-                 span_index++) {
-                const std::span<const char> sub_span = text_span.subspan(index, span_index);
-                const std::size_t right_span_index = index + span_index;
-                const std::optional<char> char_after_span =
-                    (right_span_index < text_length) ? std::optional {text.at(right_span_index)}
-                                                     : std::nullopt;
+        // token_type() of the first `length` bytes of a block
+        Token::Type block_token_type(const BlockClasses& block, std::size_t length) {
+            const std::uint64_t span = length == BlockClasses::SIZE
+                                           ? ~std::uint64_t {0}
+                                           : (std::uint64_t {1} << length) - 1;
 
-                // Can be sectioned off as a token
-                const bool this_can_be_token =
-                    !char_after_span.has_value() || (std::isalpha(char_after_span.value()) == 0);
+            if (length == 1 && ((block.letters | block.digits) & 1U) == 0) {
+                return Token::Type::Symbol;
+            }
 
-                if (!this_can_be_token) {
-                    continue;
-                }
+            if ((block.letters & span) == span) {
+                return Token::Type::Alphanumeric;
+            }
 
-                if (const std::optional<WordVector> token = vector_database.search_from_map(
-                        std::string {sub_span.begin(), sub_span.end()})) {
-                    std::string token_value = token.value().word;
-                    const bool next_is_space =
-                        char_after_span.has_value() && char_after_span.value() == ' ';
+            if ((block.digits & span) == span) {
+                return Token::Type::Digit;
+            }
 
-                    longest_possible_token_for_this_index_from_database = Token {
-                        std::move(token_value), token_type(token.value().word), next_is_space};
-                }
+            return Token::Type::Homogeneous;
+        }
+
+        // Reads the token at `index`, or skips a space, and moves `index` past it. The end of
+        // `text` is taken as the end of the input.
+        std::optional<TokenSpan> read_token(std::string_view text, std::size_t& index,
+                                            const VocabularyTrie& vocabulary) {
+            const std::size_t text_length = text.size();
+            const std::size_t token_start = index;
+            const BlockClasses block = classify_block(text, index);
+
+            // A word can be sectioned off as a token when no letter follows it
+            const VocabularyTrie::Match longest_word =
+                vocabulary.longest_match(text.substr(index), [&](std::size_t span_size) {
+                    const std::size_t right_span_index = index + span_size;
+
+                    return right_span_index >= text_length || !is_letter(text [right_span_index]);
+                });
+
+            if (longest_word.length > 0) {
+                const std::size_t right_span_index = index + longest_word.length;
+                const bool next_is_space =
+                    right_span_index < text_length && text [right_span_index] == ' ';
+                const Token::Type type =
+                    longest_word.length <= BlockClasses::SIZE
+                        ? block_token_type(block, longest_word.length)
+                        : token_type(text.substr(token_start, longest_word.length));
+
+                index = right_span_index;
+
+                return TokenSpan {token_start, longest_word.length, longest_word.word, type,
+                                  next_is_space};
             }
 
-            if (longest_possible_token_for_this_index_from_database.has_value()) {
-                tokens.push_back(longest_possible_token_for_this_index_from_database.value());
-                index += longest_possible_token_for_this_index_from_database.value().value.size();
+            if ((block.spaces & 1U) != 0) {
+                index++;
 
-                continue;
+                return std::nullopt;
             }
 
-            if (is_space) {
+            // Anything but a letter, digits included, is a symbol of its own
+            if ((block.letters & 1U) == 0) {
                 index++;
 
-                continue;
+                return TokenSpan {token_start, 1, Token::NO_VOCABULARY_ID, Token::Type::Symbol,
+                                  index < text_length && text [index] == ' '};
             }
 
-            for (std::size_t span_index {1};; span_index++) {
-                const std::size_t right_span_index = index + span_index;
-                const std::optional<char> char_after_span =
-                    (right_span_index < text_length) ? std::optional {text.at(right_span_index)}
-                                                     : std::nullopt;
-                const bool space_after_span =
-                    char_after_span.has_value() && char_after_span.value() == ' ';
+            // Otherwise the token is the whole run of letters
+            std::size_t run_length = std::countr_one(block.letters);
 
-                if (span_index == 1 && is_terminating_symbol(text.at(index))) {
-                    tokens.push_back(Token {std::string {text.at(index)}, Token::Type::Symbol,
-                                            space_after_span});
+            while (run_length % BlockClasses::SIZE == 0 && index + run_length < text_length) {
+                const std::size_t block_run_length =
+                    std::countr_one(classify_block(text, index + run_length).letters);
 
-                    index++;
+                run_length += block_run_length;
 
+                if (block_run_length < BlockClasses::SIZE) {
                     break;
                 }
+            }
 
-                if (span_index == 1 && (std::isdigit(text.at(index)) != 0)) {
-                    tokens.push_back(
-                        Token {std::string {text.at(index)}, Token::Type::Digit, space_after_span});
+            index += run_length;
 
-                    index++;
+            return TokenSpan {token_start, run_length, Token::NO_VOCABULARY_ID,
+                              Token::Type::Alphanumeric,
+                              index < text_length && text [index] == ' '};
+        }
 
-                    break;
+        // Tokens starting in [begin, end), the lookahead can read past `end`
+        std::vector<Token> tokenize_range(std::string_view text, std::size_t begin,
+                                          std::size_t end, const VocabularyTrie& vocabulary) {
+            std::vector<Token> tokens;
+
+            for (std::size_t index {begin}; index < end;) {
+                if (const std::optional<TokenSpan> token = read_token(text, index, vocabulary)) {
+                    tokens.push_back(token->to_token(text));
                 }
+            }
+
+            return tokens;
+        }
 
-                const std::span<const char> sub_span = text_span.subspan(index, span_index);
+        // Whitespace that is in no word can only be skipped or be a token of its own, so the
+        // serial tokenizer always resumes right after it
+        bool is_chunk_separator(char letter, const VocabularyTrie& vocabulary) {
+            return (letter == ' ' || letter == '\n' || letter == '\t' || letter == '\r') &&
+                   !vocabulary.contains_byte(letter);
+        }
+    } // namespace
 
-                if (space_after_span || is_terminating_symbol(char_after_span)) {
-                    std::string token_value {sub_span.begin(), sub_span.end()};
-                    tokens.emplace_back(std::move(token_value), token_type(token_value),
-                                        space_after_span);
+    std::vector<Token> tokenize(const std::string& text, const VectorDatabase& vector_database) {
+        const std::shared_ptr<const VocabularyTrie> vocabulary = vector_database.vocabulary_trie();
 
-                    index += token_value.size();
+        return tokenize_range(text, 0, text.size(), *vocabulary);
+    }
 
-                    break;
-                }
+    std::vector<CompactToken> tokenize_compact(std::string_view text,
+                                               const VectorDatabase& vector_database) {
+        if (text.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("tokenize_compact text of " + std::to_string(text.size()) +
+                                    " bytes is too long for the 32 bit offsets of compact tokens");
+        }
+
+        const std::shared_ptr<const VocabularyTrie> vocabulary = vector_database.vocabulary_trie();
+        std::vector<CompactToken> tokens;
+
+        for (std::size_t index {}; index < text.size();) {
+            if (const std::optional<TokenSpan> token = read_token(text, index, *vocabulary)) {
+                tokens.push_back({static_cast<std::uint32_t>(token->offset),
+                                  static_cast<std::uint32_t>(token->length), token->vocabulary_id,
+                                  token->type, token->next_is_space});
             }
         }
 
         return tokens;
     }
 
+    std::vector<Token> tokenize_parallel(const std::string& text,
+                                         const VectorDatabase& vector_database,
+                                         std::size_t threads_count) {
+        const std::shared_ptr<const VocabularyTrie> vocabulary = vector_database.vocabulary_trie();
+
+        // Chunks end after a separator, or at the end of the text when there is none
+        std::vector<std::size_t> chunk_starts {0};
+
+        while (chunk_starts.back() < text.size()) {
+            std::size_t end = std::min(chunk_starts.back() + TOKENIZE_CHUNK_SIZE, text.size());
+
+            while (end < text.size() && !is_chunk_separator(text [end - 1], *vocabulary)) {
+                ++end;
+            }
+
+            chunk_starts.push_back(end);
+        }
+
+        std::vector<std::vector<Token>> chunk_tokens(chunk_starts.size() - 1);
+
+        if (chunk_tokens.size() <= 1) {
+            return tokenize(text, vector_database);
+        }
+
+        {
+            BS::thread_pool thread_pool(threads_count);
+
+            for (std::size_t index {0}; index < chunk_tokens.size(); ++index) {
+                static_cast<void>(thread_pool.submit_task([&, index] {
+                    chunk_tokens [index] = tokenize_range(text, chunk_starts [index],
+                                                          chunk_starts [index + 1], *vocabulary);
+                }));
+            }
+
+            thread_pool.wait();
+        }
+
+        std::size_t token_count {0};
+
+        for (const std::vector<Token>& tokens: chunk_tokens) {
+            token_count += tokens.size();
+        }
+
+        std::vector<Token> tokens;
+        tokens.reserve(token_count);
+
+        for (std::vector<Token>& chunk: chunk_tokens) {
+            std::move(chunk.begin(), chunk.end(), std::back_inserter(tokens));
+        }
+
+        return tokens;
+    }
+
+    TokenStream::TokenStream(std::istream& input, const VectorDatabase& vector_database,
+                             std::size_t chunk_size) :
+        input {&input}, vocabulary {vector_database.vocabulary_trie()},
+        lookahead {vector_database.longest_element() + 1},
+        chunk_size {std::max<std::size_t>(chunk_size, 1)} {
+    }
+
+    TokenStream::TokenStream(std::string_view text, const VectorDatabase& vector_database) :
+        vocabulary {vector_database.vocabulary_trie()},
+        lookahead {vector_database.longest_element() + 1}, text {text},
+        input_is_exhausted {true} {
+    }
+
+    std::optional<Token> TokenStream::next() {
+        fill(lookahead);
+
+        while (position < text.size()) {
+            std::size_t index = position;
+            const std::optional<TokenSpan> token = read_token(text, index, *vocabulary);
+
+            // Unread input may extend a token that reaches the end of the buffer, or tell
+            // whether a space follows it
+            if (index == text.size() && !input_is_exhausted) {
+                fill(text.size() - position + chunk_size);
+
+                continue;
+            }
+
+            position = index;
+
+            if (token.has_value()) {
+                return token->to_token(text);
+            }
+
+            fill(lookahead);
+        }
+
+        return std::nullopt;
+    }
+
+    void TokenStream::fill(std::size_t size) {
+        while (!input_is_exhausted && buffer.size() - position < size) {
+            buffer.erase(0, position);
+            position = 0;
+
+            const std::size_t buffered_size = buffer.size();
+            buffer.resize(buffered_size + chunk_size);
+            input->read(std::next(buffer.data(), static_cast<std::ptrdiff_t>(buffered_size)),
+                        static_cast<std::streamsize>(chunk_size));
+            buffer.resize(buffered_size + static_cast<std::size_t>(input->gcount()));
+
+            input_is_exhausted = !input->good();
+            text = buffer;
+        }
+    }
+
+    TokenStream::Iterator TokenStream::begin() {
+        return Iterator {this};
+    }
+
+    std::default_sentinel_t TokenStream::end() const {
+        return std::default_sentinel;
+    }
+
+    TokenStream::Iterator::Iterator(TokenStream* stream) : stream {stream}, token {stream->next()} {
+    }
+
+    const Token& TokenStream::Iterator::operator*() const {
+        return token.value();
+    }
+
+    const Token* TokenStream::Iterator::operator->() const {
+        return &token.value();
+    }
+
+    TokenStream::Iterator& TokenStream::Iterator::operator++() {
+        token = stream->next();
+
+        return *this;
+    }
+
+    void TokenStream::Iterator::operator++(int) {
+        ++*this;
+    }
+
+    bool TokenStream::Iterator::operator==(std::default_sentinel_t /*unused*/) const {
+        return !token.has_value();
+    }
+
     std::string tokens_to_string(const std::vector<Token>& tokens) {
         return std::accumulate(tokens.begin(), tokens.end(), std::string {},
                                [](const std::string& accumulator, const Token& token) {
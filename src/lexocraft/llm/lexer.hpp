@@ -1,8 +1,15 @@
 #ifndef LEXOCRAFT_LEXER_HPP
 #define LEXOCRAFT_LEXER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <mapbox/eternal.hpp>
@@ -28,27 +35,119 @@ namespace lc::grammar {
                 {Type::Symbol,       "Symbol"      },
         });
 
+        static constexpr std::uint32_t NO_VOCABULARY_ID {VocabularyTrie::NO_WORD};
+
         std::string value;
         Type type {};
         bool next_is_space {};
 
+        // Index of the word in the database the text was tokenized with, when it is one
+        std::uint32_t vocabulary_id {NO_VOCABULARY_ID};
+
         Token() = default;
         Token(const Token&) = default;
         Token(Token&&) = default;
         Token& operator=(const Token&) = default;
         Token& operator=(Token&&) = default;
 
-        Token(std::string&& value, Type type, bool next_is_space);
+        Token(std::string&& value, Type type, bool next_is_space,
+              std::uint32_t vocabulary_id = NO_VOCABULARY_ID);
+
+        [[nodiscard]] bool has_vocabulary_id() const;
     };
 
-    bool is_component_symbol(const std::optional<const char>& letter);
+    // Token as a slice of the text it was read from, without a string of its own
+    struct CompactToken {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t vocabulary_id;
+        Token::Type type;
+        bool next_is_space;
+
+        [[nodiscard]] std::string_view value(std::string_view text) const;
+        [[nodiscard]] Token to_token(std::string_view text) const;
+        [[nodiscard]] bool has_vocabulary_id() const;
+    };
+
+    bool is_component_symbol(char letter);
     bool is_terminating_symbol(const std::optional<const char>& letter);
     // bool is_potentially_terminating_symbol(const std::optional<const char>& letter);
 
-    Token::Type token_type(const std::string& value);
+    Token::Type token_type(std::string_view value);
 
     std::vector<Token> tokenize(const std::string& text, const VectorDatabase& vector_database);
 
+    // Same tokens as tokenize(), the text has to outlive them. Throws std::length_error for texts
+    // of 4 GiB or more, whose offsets don't fit the compact tokens.
+    std::vector<CompactToken> tokenize_compact(std::string_view text,
+                                               const VectorDatabase& vector_database);
+
+    // Same tokens as tokenize(), the text is split after whitespace that no word contains and
+    // the chunks are tokenized on a thread pool (0 threads uses every core)
+    std::vector<Token> tokenize_parallel(const std::string& text,
+                                         const VectorDatabase& vector_database,
+                                         std::size_t threads_count = 0);
+
+    /*
+     Yields the tokens tokenize() would return for the whole input while reading it in chunks.
+     Only the unread part of the current chunk is buffered, plus whatever lookahead the current
+     token needs, so a word straddling two chunks is still matched.
+    */
+    class TokenStream {
+        public:
+
+        static constexpr std::size_t DEFAULT_CHUNK_SIZE {std::size_t {1} << 16U};
+
+        class Iterator {
+            public:
+
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Token;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+            explicit Iterator(TokenStream* stream);
+
+            const Token& operator*() const;
+            const Token* operator->() const;
+            Iterator& operator++();
+            void operator++(int);
+
+            bool operator==(std::default_sentinel_t /*unused*/) const;
+
+            private:
+
+            TokenStream* stream {};
+            std::optional<Token> token {};
+        };
+
+        TokenStream(std::istream& input, const VectorDatabase& vector_database,
+                    std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+        // Borrows the text, e.g. MappedFile::view(), which has to outlive the stream
+        TokenStream(std::string_view text, const VectorDatabase& vector_database);
+
+        std::optional<Token> next();
+
+        Iterator begin();
+        [[nodiscard]] std::default_sentinel_t end() const;
+
+        private:
+
+        // Reads until `size` characters past the position are buffered or the input ends
+        void fill(std::size_t size);
+
+        std::istream* input {};
+        std::shared_ptr<const VocabularyTrie> vocabulary;
+        std::size_t lookahead {}; // Longest word and the character after it
+        std::size_t chunk_size {DEFAULT_CHUNK_SIZE};
+
+        std::string buffer {};
+        std::string_view text {}; // The buffer or the borrowed text
+        std::size_t position {};
+        bool input_is_exhausted {false};
+    };
+
     std::string tokens_to_string(const std::vector<Token>& tokens);
 
     std::ostream& operator<<(std::ostream& output_stream, const Token& token);
@@ -0,0 +1,176 @@
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+#include <lexocraft/llm/mapped_file.hpp>
+
+namespace lc {
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::filesystem::path& filepath) {
+        file_handle = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file_handle == INVALID_HANDLE_VALUE) {
+            file_handle = nullptr;
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(),
+                                    "Failed to open " + filepath.string());
+        }
+
+        LARGE_INTEGER file_size {};
+        GetFileSizeEx(file_handle, &file_size);
+        mapped_size = static_cast<std::size_t>(file_size.QuadPart);
+
+        if (mapped_size == 0) {
+            return;
+        }
+
+        mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (mapping_handle == nullptr) {
+            const auto error = static_cast<int>(GetLastError());
+            close();
+            throw std::system_error(error, std::system_category(),
+                                    "Failed to map " + filepath.string());
+        }
+
+        mapped_data = static_cast<const std::byte*>(
+            MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+
+        if (mapped_data == nullptr) {
+            const auto error = static_cast<int>(GetLastError());
+            close();
+            throw std::system_error(error, std::system_category(),
+                                    "Failed to map " + filepath.string());
+        }
+    }
+
+    void MappedFile::close() {
+        if (mapped_data != nullptr) {
+            UnmapViewOfFile(mapped_data);
+        }
+
+        if (mapping_handle != nullptr) {
+            CloseHandle(mapping_handle);
+        }
+
+        if (file_handle != nullptr) {
+            CloseHandle(file_handle);
+        }
+
+        mapped_data = nullptr;
+        mapped_size = 0;
+        mapping_handle = nullptr;
+        file_handle = nullptr;
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path& filepath) {
+        const int file_descriptor = ::open(filepath.c_str(), O_RDONLY);
+
+        if (file_descriptor < 0) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Failed to open " + filepath.string());
+        }
+
+        struct stat file_status {};
+
+        if (::fstat(file_descriptor, &file_status) != 0) {
+            const int error = errno;
+            ::close(file_descriptor);
+            throw std::system_error(error, std::generic_category(),
+                                    "Failed to stat " + filepath.string());
+        }
+
+        mapped_size = static_cast<std::size_t>(file_status.st_size);
+
+        if (mapped_size > 0) {
+            void* const address =
+                ::mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+
+            if (address == MAP_FAILED) {
+                const int error = errno;
+                ::close(file_descriptor);
+                mapped_size = 0;
+                throw std::system_error(error, std::generic_category(),
+                                        "Failed to map " + filepath.string());
+            }
+
+            mapped_data = static_cast<const std::byte*>(address);
+        }
+
+        // The mapping keeps its own reference to the file
+        ::close(file_descriptor);
+    }
+
+    void MappedFile::close() {
+        if (mapped_data != nullptr) {
+            ::munmap(const_cast<std::byte*>(mapped_data), mapped_size);
+        }
+
+        mapped_data = nullptr;
+        mapped_size = 0;
+    }
+#endif
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept :
+        mapped_data {std::exchange(other.mapped_data, nullptr)},
+        mapped_size {std::exchange(other.mapped_size, 0)}
+#ifdef _WIN32
+        ,
+        file_handle {std::exchange(other.file_handle, nullptr)},
+        mapping_handle {std::exchange(other.mapping_handle, nullptr)}
+#endif
+    {
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+
+            mapped_data = std::exchange(other.mapped_data, nullptr);
+            mapped_size = std::exchange(other.mapped_size, 0);
+#ifdef _WIN32
+            file_handle = std::exchange(other.file_handle, nullptr);
+            mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+        }
+
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    const std::byte* MappedFile::data() const {
+        return mapped_data;
+    }
+
+    std::size_t MappedFile::size() const {
+        return mapped_size;
+    }
+
+    bool MappedFile::is_open() const {
+        return mapped_data != nullptr;
+    }
+
+    std::span<const std::byte> MappedFile::bytes() const {
+        return {mapped_data, mapped_size};
+    }
+
+    std::string_view MappedFile::view() const {
+        return {reinterpret_cast<const char*>(mapped_data), mapped_size};
+    }
+} // namespace lc
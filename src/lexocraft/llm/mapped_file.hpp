@@ -0,0 +1,47 @@
+#ifndef LEXOCRAFT_MAPPED_FILE_HPP
+#define LEXOCRAFT_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace lc {
+    /*
+     Read-only memory mapping of a whole file. Pages are shared with every other process mapping
+     the same file and are only read from disk when touched.
+    */
+    class MappedFile {
+        public:
+
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        explicit MappedFile(const std::filesystem::path& filepath);
+
+        [[nodiscard]] const std::byte* data() const;
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] bool is_open() const;
+
+        [[nodiscard]] std::span<const std::byte> bytes() const;
+        [[nodiscard]] std::string_view view() const;
+
+        void close();
+
+        private:
+
+        const std::byte* mapped_data {};
+        std::size_t mapped_size {};
+
+#ifdef _WIN32
+        void* file_handle {};
+        void* mapping_handle {};
+#endif
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_MAPPED_FILE_HPP
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include <lexocraft/hashing.hpp>
+#include <lexocraft/llm/perfect_hash.hpp>
+
+namespace lc {
+    namespace {
+        constexpr std::uint64_t INITIAL_SEED {0x7065726665637400ULL};
+        constexpr std::size_t SEED_ATTEMPTS {16};
+        constexpr std::uint32_t MAX_PILOT {1U << 24U};
+        constexpr std::size_t AVERAGE_BUCKET_SIZE {3};
+        constexpr std::uint32_t EMPTY_KEY {0xFFFFFFFF};
+
+        // Maps a 32 bit hash onto [0, range) without a division
+        std::uint32_t reduce(std::uint32_t hash, std::uint64_t range) {
+            return static_cast<std::uint32_t>((static_cast<std::uint64_t>(hash) * range) >> 32U);
+        }
+
+        std::uint32_t bucket_of(std::uint64_t hash, std::uint64_t bucket_count) {
+            return reduce(static_cast<std::uint32_t>(hash), bucket_count);
+        }
+
+        std::uint32_t slot_of(std::uint64_t hash, std::uint32_t pilot, std::uint64_t table_size) {
+            return reduce(static_cast<std::uint32_t>(mix_hash(hash ^ mix_hash(pilot)) >> 32U),
+                          table_size);
+        }
+
+        std::uint32_t fingerprint_of(std::uint64_t hash) {
+            return static_cast<std::uint32_t>(hash >> 32U);
+        }
+    } // namespace
+
+    PerfectHash::PerfectHash(const std::vector<std::uint32_t>& word_indices,
+                             const WordAccessor_t& word) {
+        std::vector<std::uint64_t> hashes(word_indices.size());
+
+        for (std::size_t attempt {0}; attempt < SEED_ATTEMPTS; ++attempt) {
+            parameters.seed = INITIAL_SEED + attempt;
+
+            for (std::size_t index {0}; index < word_indices.size(); ++index) {
+                hashes [index] = stable_hash(word(word_indices [index]), parameters.seed);
+            }
+
+            if (try_build(word_indices, hashes)) {
+                refresh_views();
+
+                return;
+            }
+        }
+
+        throw std::runtime_error("Failed to build a perfect hash, the words may not be distinct");
+    }
+
+    bool PerfectHash::try_build(const std::vector<std::uint32_t>& word_indices,
+                                const std::vector<std::uint64_t>& hashes) {
+        const std::size_t key_count = word_indices.size();
+
+        parameters.key_count = key_count;
+        parameters.bucket_count = std::max<std::size_t>(1, key_count / AVERAGE_BUCKET_SIZE);
+        parameters.table_size = key_count + (key_count + 98) / 99;
+
+        // Keys grouped by bucket, counting sort
+        std::vector<std::uint32_t> bucket_starts(parameters.bucket_count + 1, 0);
+
+        for (const std::uint64_t hash: hashes) {
+            ++bucket_starts [bucket_of(hash, parameters.bucket_count) + 1];
+        }
+
+        std::partial_sum(bucket_starts.begin(), bucket_starts.end(), bucket_starts.begin());
+
+        std::vector<std::uint32_t> bucket_keys(key_count);
+        std::vector<std::uint32_t> bucket_fill(bucket_starts.begin(),
+                                               std::prev(bucket_starts.end()));
+
+        for (std::uint32_t key {0}; key < key_count; ++key) {
+            bucket_keys [bucket_fill [bucket_of(hashes [key], parameters.bucket_count)]++] = key;
+        }
+
+        // Largest buckets first, while the table is still empty
+        std::vector<std::uint32_t> bucket_order(parameters.bucket_count);
+        std::iota(bucket_order.begin(), bucket_order.end(), 0);
+        std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                         [&bucket_starts](std::uint32_t first, std::uint32_t second) {
+                             return bucket_starts [first + 1] - bucket_starts [first] >
+                                    bucket_starts [second + 1] - bucket_starts [second];
+                         });
+
+        owned_pilots.assign(parameters.bucket_count, 0);
+        std::vector<std::uint32_t> slot_keys(parameters.table_size, EMPTY_KEY);
+        std::vector<std::uint32_t> bucket_slots;
+
+        for (const std::uint32_t bucket: bucket_order) {
+            const std::span<const std::uint32_t> keys {
+                std::next(bucket_keys.begin(), bucket_starts [bucket]),
+                std::next(bucket_keys.begin(), bucket_starts [bucket + 1])};
+
+            if (keys.empty()) {
+                break;
+            }
+
+            // Equal hashes can't be displaced apart by any pilot, only by another seed
+            for (std::size_t first {0}; first < keys.size(); ++first) {
+                for (std::size_t second {first + 1}; second < keys.size(); ++second) {
+                    if (hashes [keys [first]] == hashes [keys [second]]) {
+                        return false;
+                    }
+                }
+            }
+
+            std::uint32_t pilot {0};
+
+            for (;; ++pilot) {
+                if (pilot == MAX_PILOT) {
+                    return false;
+                }
+
+                bucket_slots.clear();
+
+                for (const std::uint32_t key: keys) {
+                    const std::uint32_t slot = slot_of(hashes [key], pilot, parameters.table_size);
+
+                    if (slot_keys [slot] != EMPTY_KEY ||
+                        std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                            bucket_slots.end()) {
+                        break;
+                    }
+
+                    bucket_slots.push_back(slot);
+                }
+
+                if (bucket_slots.size() == keys.size()) {
+                    break;
+                }
+            }
+
+            owned_pilots [bucket] = pilot;
+
+            for (std::size_t index {0}; index < keys.size(); ++index) {
+                slot_keys [bucket_slots [index]] = keys [index];
+            }
+        }
+
+        // Slots past key_count move into the holes below it, which are exactly as many
+        owned_remap.assign(parameters.table_size - key_count, 0);
+        owned_entries.assign(key_count, {0, 0});
+
+        std::size_t hole {0};
+
+        for (std::size_t slot {0}; slot < parameters.table_size; ++slot) {
+            const std::uint32_t key = slot_keys [slot];
+
+            if (key == EMPTY_KEY) {
+                continue;
+            }
+
+            std::size_t entry = slot;
+
+            if (slot >= key_count) {
+                while (slot_keys [hole] != EMPTY_KEY) {
+                    ++hole;
+                }
+
+                entry = hole++;
+                owned_remap [slot - key_count] = static_cast<std::uint32_t>(entry);
+            }
+
+            owned_entries [entry] = {word_indices [key], fingerprint_of(hashes [key])};
+        }
+
+        return true;
+    }
+
+    PerfectHash PerfectHash::from_bytes(std::span<const std::byte> bytes) {
+        PerfectHash hash;
+
+        if (bytes.size() < sizeof(Parameters)) {
+            throw std::runtime_error("Perfect hash section is truncated");
+        }
+
+        std::memcpy(&hash.parameters, bytes.data(), sizeof(Parameters));
+
+        const Parameters& stored = hash.parameters;
+
+        // Bounds the sizes below
+        if (stored.bucket_count > bytes.size() || stored.table_size > bytes.size()) {
+            throw std::runtime_error("Perfect hash section has an invalid size");
+        }
+
+        const std::size_t pilots_size = stored.bucket_count * sizeof(std::uint32_t);
+        const std::size_t remap_size =
+            (stored.table_size - stored.key_count) * sizeof(std::uint32_t);
+        const std::size_t entries_size = stored.key_count * sizeof(Entry);
+
+        if (stored.table_size < stored.key_count || stored.bucket_count == 0 ||
+            bytes.size() != sizeof(Parameters) + pilots_size + remap_size + entries_size) {
+            throw std::runtime_error("Perfect hash section has an invalid size");
+        }
+
+        const std::byte* data = std::next(bytes.data(), sizeof(Parameters));
+
+        hash.pilots = {reinterpret_cast<const std::uint32_t*>(data), stored.bucket_count};
+        data = std::next(data, static_cast<std::ptrdiff_t>(pilots_size));
+        hash.remap = {reinterpret_cast<const std::uint32_t*>(data),
+                      stored.table_size - stored.key_count};
+        data = std::next(data, static_cast<std::ptrdiff_t>(remap_size));
+        hash.entries = {reinterpret_cast<const Entry*>(data), stored.key_count};
+
+        if (stored.key_count > 0 &&
+            std::any_of(hash.remap.begin(), hash.remap.end(),
+                        [&stored](std::uint32_t slot) { return slot >= stored.key_count; })) {
+            throw std::runtime_error("Perfect hash section remaps slots out of its table");
+        }
+
+        return hash;
+    }
+
+    std::vector<std::byte> PerfectHash::to_bytes() const {
+        std::vector<std::byte> bytes;
+
+        const auto append = [&bytes](const auto& values) {
+            const std::span<const std::byte> value_bytes = std::as_bytes(values);
+            bytes.insert(bytes.end(), value_bytes.begin(), value_bytes.end());
+        };
+
+        append(std::span<const Parameters> {&parameters, 1});
+        append(pilots);
+        append(remap);
+        append(entries);
+
+        return bytes;
+    }
+
+    std::size_t PerfectHash::size() const {
+        return parameters.key_count;
+    }
+
+    bool PerfectHash::has_words_below(std::size_t word_count) const {
+        return std::all_of(entries.begin(), entries.end(),
+                           [word_count](const Entry& entry) { return entry.word < word_count; });
+    }
+
+    std::optional<std::uint32_t> PerfectHash::candidate(std::string_view word) const {
+        if (parameters.key_count == 0) {
+            return std::nullopt;
+        }
+
+        const std::uint64_t hash = stable_hash(word, parameters.seed);
+        const std::uint32_t pilot = pilots [bucket_of(hash, parameters.bucket_count)];
+        std::uint32_t slot = slot_of(hash, pilot, parameters.table_size);
+
+        if (slot >= parameters.key_count) {
+            slot = remap [slot - parameters.key_count];
+        }
+
+        const Entry& entry = entries [slot];
+
+        if (entry.fingerprint != fingerprint_of(hash)) {
+            return std::nullopt;
+        }
+
+        return entry.word;
+    }
+
+    void PerfectHash::refresh_views() {
+        pilots = owned_pilots;
+        remap = owned_remap;
+        entries = owned_entries;
+    }
+} // namespace lc
@@ -0,0 +1,81 @@
+#ifndef LEXOCRAFT_PERFECT_HASH_HPP
+#define LEXOCRAFT_PERFECT_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace lc {
+    /*
+     Minimal perfect hash over a fixed set of words (hash and displace, as in PTHash). Every word
+     hashes to a bucket whose pilot displaces it to its own slot in a table of about 1.01 slots
+     per word, the few slots past the word count are remapped into the holes below it.
+
+     A slot stores the word index and a 32 bit fingerprint of the hash, so a lookup costs a pilot
+     read, one entry read and, when the fingerprint matches, one string compare by the caller.
+
+     The hash only uses stable_hash and 32 bit arithmetic, so a persisted hash gives the same
+     slots on every platform.
+    */
+    class PerfectHash {
+        public:
+
+        struct Parameters {
+            std::uint64_t seed;
+            std::uint64_t key_count;
+            std::uint64_t bucket_count;
+            std::uint64_t table_size; // key_count + remapped slots
+        };
+
+        struct Entry {
+            std::uint32_t word;
+            std::uint32_t fingerprint;
+        };
+
+        using WordAccessor_t = std::function<std::string_view(std::uint32_t)>;
+
+        PerfectHash() = default;
+        PerfectHash(const PerfectHash&) = delete;
+        PerfectHash(PerfectHash&&) = default;
+        PerfectHash& operator=(const PerfectHash&) = delete;
+        PerfectHash& operator=(PerfectHash&&) = default;
+
+        // The words at `word_indices` have to be distinct
+        PerfectHash(const std::vector<std::uint32_t>& word_indices, const WordAccessor_t& word);
+
+        // Borrows a hash written by to_bytes(), the bytes have to outlive it
+        static PerfectHash from_bytes(std::span<const std::byte> bytes);
+        [[nodiscard]] std::vector<std::byte> to_bytes() const;
+
+        [[nodiscard]] std::size_t size() const;
+
+        // Whether every word index of a loaded hash is below word_count
+        [[nodiscard]] bool has_words_below(std::size_t word_count) const;
+
+        // Index of the only word that can be equal to `word`, the caller compares the strings
+        [[nodiscard]] std::optional<std::uint32_t> candidate(std::string_view word) const;
+
+        private:
+
+        bool try_build(const std::vector<std::uint32_t>& word_indices,
+                       const std::vector<std::uint64_t>& hashes);
+        void refresh_views();
+
+        Parameters parameters {};
+
+        std::vector<std::uint32_t> owned_pilots {};
+        std::vector<std::uint32_t> owned_remap {};
+        std::vector<Entry> owned_entries {};
+
+        // Views of either the owned or the borrowed arrays
+        std::span<const std::uint32_t> pilots {};
+        std::span<const std::uint32_t> remap {};
+        std::span<const Entry> entries {};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_PERFECT_HASH_HPP
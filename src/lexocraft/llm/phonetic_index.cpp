@@ -0,0 +1,168 @@
+#include <array>
+#include <cctype>
+#include <utility>
+
+#include <lexocraft/llm/phonetic_index.hpp>
+
+namespace lc {
+    namespace {
+        // Soundex digit of every letter, '-' for h and w, which don't separate equal digits
+        constexpr std::array<char, 26> SOUNDEX_DIGITS {'0', '1', '2', '3', '0', '1', '2', '-', '0',
+                                                       '2', '2', '4', '5', '5', '0', '1', '2', '6',
+                                                       '2', '3', '0', '1', '-', '2', '0', '2'};
+
+        // Characters that can follow the first letter, vowels only ever appear as padding
+        constexpr std::array<char, 7> CODE_DIGITS {'0', '1', '2', '3', '4', '5', '6'};
+
+        constexpr std::array<char, 26> CODE_LETTERS = [] {
+            std::array<char, 26> letters {};
+
+            for (std::size_t index {0}; index < letters.size(); ++index) {
+                letters.at(index) = static_cast<char>('A' + index);
+            }
+
+            return letters;
+        }();
+
+        char soundex_digit(char letter) {
+            const auto lowercase = static_cast<unsigned char>(std::tolower(letter));
+
+            return SOUNDEX_DIGITS.at(lowercase - 'a');
+        }
+
+        bool is_letter(char letter) {
+            const auto character = static_cast<unsigned char>(letter);
+
+            return std::isalpha(character) != 0 && character < 0x80;
+        }
+
+        char code_character(PhoneticIndex::Code_t code, std::size_t position) {
+            const std::size_t shift = (PhoneticIndex::CODE_LENGTH - 1 - position) * 8;
+
+            return static_cast<char>((code >> shift) & 0xFFU);
+        }
+
+        PhoneticIndex::Code_t with_character(PhoneticIndex::Code_t code, std::size_t position,
+                                             char character) {
+            const std::size_t shift = (PhoneticIndex::CODE_LENGTH - 1 - position) * 8;
+            const PhoneticIndex::Code_t mask = ~(PhoneticIndex::Code_t {0xFF} << shift);
+
+            return (code & mask) |
+                   (static_cast<PhoneticIndex::Code_t>(static_cast<unsigned char>(character))
+                    << shift);
+        }
+    } // namespace
+
+    std::optional<PhoneticIndex::Code_t> PhoneticIndex::soundex(std::string_view word) {
+        std::size_t position {0};
+
+        while (position < word.size() && !is_letter(word [position])) {
+            ++position;
+        }
+
+        if (position == word.size()) {
+            return std::nullopt;
+        }
+
+        std::array<char, CODE_LENGTH> code {
+            static_cast<char>(std::toupper(static_cast<unsigned char>(word [position]))), '0', '0',
+            '0'};
+        std::size_t code_size {1};
+        char previous_digit = soundex_digit(word [position]);
+
+        for (++position; position < word.size() && code_size < CODE_LENGTH; ++position) {
+            if (!is_letter(word [position])) {
+                continue;
+            }
+
+            const char digit = soundex_digit(word [position]);
+
+            if (digit == '-') {
+                continue;
+            }
+
+            if (digit != '0' && digit != previous_digit) {
+                code.at(code_size++) = digit;
+            }
+
+            previous_digit = digit;
+        }
+
+        Code_t packed {0};
+
+        for (std::size_t index {0}; index < CODE_LENGTH; ++index) {
+            packed = with_character(packed, index, code.at(index));
+        }
+
+        return packed;
+    }
+
+    std::vector<PhoneticIndex::Code_t>
+        PhoneticIndex::codes_sharing_prefix(Code_t code, std::size_t prefix_length) {
+        if (prefix_length >= CODE_LENGTH) {
+            return {code};
+        }
+
+        // The character right after the prefix differs, the ones after that are free
+        const std::span<const char> differing_characters =
+            prefix_length == 0 ? std::span<const char> {CODE_LETTERS}
+                               : std::span<const char> {CODE_DIGITS};
+        std::vector<Code_t> codes;
+
+        for (const char character: differing_characters) {
+            if (character != code_character(code, prefix_length)) {
+                codes.push_back(with_character(code, prefix_length, character));
+            }
+        }
+
+        for (std::size_t position {prefix_length + 1}; position < CODE_LENGTH; ++position) {
+            std::vector<Code_t> expanded_codes;
+            expanded_codes.reserve(codes.size() * CODE_DIGITS.size());
+
+            for (const Code_t expanded_code: codes) {
+                for (const char digit: CODE_DIGITS) {
+                    expanded_codes.push_back(with_character(expanded_code, position, digit));
+                }
+            }
+
+            codes = std::move(expanded_codes);
+        }
+
+        return codes;
+    }
+
+    void PhoneticIndex::add_word(std::uint32_t index, std::string_view word) {
+        if (const std::optional<Code_t> code = soundex(word)) {
+            buckets [code.value()].push_back(index);
+            ++word_count;
+        }
+
+        else {
+            uncoded_words.push_back(index);
+        }
+    }
+
+    void PhoneticIndex::clear() {
+        buckets = {};
+        uncoded_words = {};
+        word_count = 0;
+    }
+
+    std::span<const std::uint32_t> PhoneticIndex::words_with_code(Code_t code) const {
+        const auto bucket = buckets.find(code);
+
+        if (bucket == buckets.end()) {
+            return {};
+        }
+
+        return bucket->second;
+    }
+
+    std::span<const std::uint32_t> PhoneticIndex::words_without_code() const {
+        return uncoded_words;
+    }
+
+    std::size_t PhoneticIndex::size() const {
+        return word_count;
+    }
+} // namespace lc
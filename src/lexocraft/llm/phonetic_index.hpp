@@ -0,0 +1,50 @@
+#ifndef LEXOCRAFT_PHONETIC_INDEX_HPP
+#define LEXOCRAFT_PHONETIC_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+namespace lc {
+    /*
+     Words grouped by their American Soundex code ("Robert" and "Rupert" are both R163). Codes
+     are packed big-endian into an integer, one character per byte.
+
+     Words without a letter have no code and are kept apart.
+    */
+    class PhoneticIndex {
+        public:
+
+        using Code_t = std::uint32_t;
+
+        static constexpr std::size_t CODE_LENGTH {4};
+
+        [[nodiscard]] static std::optional<Code_t> soundex(std::string_view word);
+
+        // Every code that shares exactly `prefix_length` leading characters with `code`, 0 gives
+        // the codes of every other first letter
+        [[nodiscard]] static std::vector<Code_t> codes_sharing_prefix(Code_t code,
+                                                                      std::size_t prefix_length);
+
+        void add_word(std::uint32_t index, std::string_view word);
+        void clear();
+
+        [[nodiscard]] std::span<const std::uint32_t> words_with_code(Code_t code) const;
+        [[nodiscard]] std::span<const std::uint32_t> words_without_code() const;
+        // Words with a code
+        [[nodiscard]] std::size_t size() const;
+
+        private:
+
+        tsl::robin_map<Code_t, std::vector<std::uint32_t>> buckets {};
+        std::vector<std::uint32_t> uncoded_words {};
+        std::size_t word_count {};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_PHONETIC_INDEX_HPP
@@ -0,0 +1,135 @@
+#include <cassert>
+#include <vector>
+
+#include <lexocraft/llm/prefix_cache.hpp>
+
+namespace lc {
+    PrefixCache::PrefixCache(Options options) : options {options} {
+        assert(options.checkpoint_interval > 0);
+    }
+
+    PrefixCache::PrefixCache() : PrefixCache(Options {}) {
+    }
+
+    const TextCompleter::EphemeralMemoryNNOutput&
+        PrefixCache::feed(const TextCompleter& model, TextCompleter::SessionState& state,
+                          std::span<const grammar::Token> tokens) {
+        // History hashes after every prefix, with the statistics the predictions will use
+        std::vector<std::uint64_t> prefix_hashes;
+        prefix_hashes.reserve(tokens.size());
+
+        TextStatistics statistics = state.live_statistics;
+        std::uint64_t history_hash = state.history_hash;
+
+        for (const grammar::Token& token: tokens) {
+            statistics.add(token);
+            history_hash = TextCompleter::history_hash_after_token(
+                history_hash, token, statistics.sentence_length_mean(),
+                statistics.sentence_length_stddev(), statistics.flesch_kincaid_level(),
+                statistics.sentence_count());
+
+            prefix_hashes.push_back(history_hash);
+        }
+
+        std::size_t fed_count {0};
+
+        {
+            const std::scoped_lock lock {mutex};
+
+            for (std::size_t prefix_size {tokens.size()}; prefix_size > 0; --prefix_size) {
+                const auto position = snapshot_index.find(prefix_hashes [prefix_size - 1]);
+
+                if (position == snapshot_index.end()) {
+                    continue;
+                }
+
+                // Copied while locked, another feed might evict it
+                position->second->restore(state);
+                snapshots.splice(snapshots.begin(), snapshots, position->second);
+                fed_count = prefix_size;
+
+                break;
+            }
+
+            ++(fed_count > 0 ? hits : misses);
+            skipped_tokens += fed_count;
+        }
+
+        for (std::size_t index {fed_count}; index < tokens.size(); ++index) {
+            static_cast<void>(model.predict_next_token_value(state, tokens [index]));
+            assert(state.history_hash == prefix_hashes [index]);
+
+            const std::size_t prefix_size = index + 1;
+
+            if (prefix_size % options.checkpoint_interval == 0 || prefix_size == tokens.size()) {
+                store(state);
+            }
+        }
+
+        return state.last_prediction;
+    }
+
+    void PrefixCache::store(const TextCompleter::SessionState& state) {
+        SessionSnapshot snapshot;
+        snapshot.capture(state);
+        const std::size_t snapshot_memory_usage = snapshot.memory_usage();
+
+        const std::scoped_lock lock {mutex};
+
+        if (const auto position = snapshot_index.find(state.history_hash);
+            position != snapshot_index.end()) {
+            snapshots.splice(snapshots.begin(), snapshots, position->second);
+
+            return;
+        }
+
+        snapshots.push_front(std::move(snapshot));
+        snapshot_index.emplace(state.history_hash, snapshots.begin());
+        used_memory += snapshot_memory_usage;
+
+        // A snapshot larger than the whole budget evicts itself
+        while (used_memory > options.memory_budget && !snapshots.empty()) {
+            used_memory -= snapshots.back().memory_usage();
+            snapshot_index.erase(snapshots.back().history_hash);
+            snapshots.pop_back();
+        }
+    }
+
+    void PrefixCache::clear() {
+        const std::scoped_lock lock {mutex};
+
+        snapshots.clear();
+        snapshot_index.clear();
+        used_memory = 0;
+    }
+
+    std::size_t PrefixCache::size() const {
+        const std::scoped_lock lock {mutex};
+
+        return snapshots.size();
+    }
+
+    std::size_t PrefixCache::memory_usage() const {
+        const std::scoped_lock lock {mutex};
+
+        return used_memory;
+    }
+
+    std::uint64_t PrefixCache::hit_count() const {
+        const std::scoped_lock lock {mutex};
+
+        return hits;
+    }
+
+    std::uint64_t PrefixCache::miss_count() const {
+        const std::scoped_lock lock {mutex};
+
+        return misses;
+    }
+
+    std::uint64_t PrefixCache::skipped_token_count() const {
+        const std::scoped_lock lock {mutex};
+
+        return skipped_tokens;
+    }
+} // namespace lc
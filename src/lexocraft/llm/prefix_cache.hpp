@@ -0,0 +1,70 @@
+#ifndef LEXOCRAFT_PREFIX_CACHE_HPP
+#define LEXOCRAFT_PREFIX_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <span>
+
+#include <tsl/robin_map.h>
+
+#include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/session_snapshot.hpp>
+#include <lexocraft/llm/text_completion.hpp>
+
+namespace lc {
+    /*
+     Session states after prefixes of the texts fed through it, keyed by the history_hash of the
+     state, so that texts starting alike skip the tokens they share. A state is cached every
+     checkpoint_interval tokens and after the last token of every text.
+
+     The least recently used states are evicted to stay within memory_budget bytes. One cache
+     may be shared by the sessions of any number of threads and models, a history hash covers
+     the network versions.
+    */
+    class PrefixCache {
+        public:
+
+        struct Options {
+            std::size_t memory_budget {std::size_t {64} << 20U};
+            std::size_t checkpoint_interval {16};
+        };
+
+        explicit PrefixCache(Options options);
+        PrefixCache();
+
+        // Same as predicting the tokens one by one, but starting from the cached state after the
+        // longest prefix of them that is cached. Returns the prediction after the last token.
+        const TextCompleter::EphemeralMemoryNNOutput&
+            feed(const TextCompleter& model, TextCompleter::SessionState& state,
+                 std::span<const grammar::Token> tokens);
+
+        void clear();
+
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] std::size_t memory_usage() const;
+
+        // Feeds that resumed from a cached state, and those that found none
+        [[nodiscard]] std::uint64_t hit_count() const;
+        [[nodiscard]] std::uint64_t miss_count() const;
+        [[nodiscard]] std::uint64_t skipped_token_count() const;
+
+        private:
+
+        void store(const TextCompleter::SessionState& state);
+
+        Options options;
+
+        mutable std::mutex mutex;
+        std::list<SessionSnapshot> snapshots; // Most recently used first
+        tsl::robin_map<std::uint64_t, std::list<SessionSnapshot>::iterator> snapshot_index;
+        std::size_t used_memory {0};
+
+        std::uint64_t hits {0};
+        std::uint64_t misses {0};
+        std::uint64_t skipped_tokens {0};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_PREFIX_CACHE_HPP
@@ -0,0 +1,88 @@
+#include <lexocraft/llm/session_snapshot.hpp>
+
+namespace lc {
+    SessionSnapshot::SessionSnapshot(const TextCompleter& model) :
+        ephemeral_memory {Eigen::VectorXf::Zero(model.ephemeral_memory_size)},
+        context_memory {Eigen::VectorXf::Zero(model.context_memory_size)},
+        history_hash {model.initial_history_hash()},
+        last_prediction {model.ephemeral_memory_output_sizes} {
+        last_prediction.word_vector_value =
+            Eigen::VectorXf::Zero(model.ephemeral_memory_output_sizes.word_vector_value);
+    }
+
+    SessionSnapshot& SessionSnapshot::capture(const TextCompleter::SessionState& state) {
+        // Assignments between vectors of the same size copy without allocating
+        ephemeral_memory = state.ephemeral_memory;
+        context_memory = state.context_memory;
+        live_statistics = state.live_statistics;
+        history_hash = state.history_hash;
+        last_prediction = state.last_prediction;
+
+        return *this;
+    }
+
+    void SessionSnapshot::restore(TextCompleter::SessionState& state) const {
+        state.ephemeral_memory = ephemeral_memory;
+        state.context_memory = context_memory;
+        state.live_statistics = live_statistics;
+        state.history_hash = history_hash;
+        state.last_prediction = last_prediction;
+    }
+
+    std::size_t SessionSnapshot::memory_usage() const {
+        const Eigen::Index float_count =
+            ephemeral_memory.size() + context_memory.size() +
+            last_prediction.ephemeral_memory.size() + last_prediction.word_vector_value.size();
+
+        return sizeof(SessionSnapshot) + static_cast<std::size_t>(float_count) * sizeof(float);
+    }
+
+    void SessionSnapshotPool::Releaser::operator()(SessionSnapshot* snapshot) const {
+        const std::scoped_lock lock {pool->mutex};
+
+        pool->free_snapshots.push_back(snapshot);
+    }
+
+    SessionSnapshotPool::SessionSnapshotPool(const TextCompleter& model,
+                                             std::size_t preallocated_count) :
+        prototype {model} {
+        free_snapshots.reserve(preallocated_count);
+
+        for (std::size_t index {0}; index < preallocated_count; ++index) {
+            free_snapshots.push_back(&snapshots.emplace_back(prototype));
+        }
+    }
+
+    SessionSnapshotPool::Handle SessionSnapshotPool::acquire() {
+        const std::scoped_lock lock {mutex};
+
+        if (free_snapshots.empty()) {
+            return Handle {&snapshots.emplace_back(prototype), Releaser {this}};
+        }
+
+        SessionSnapshot* snapshot = free_snapshots.back();
+        free_snapshots.pop_back();
+
+        return Handle {snapshot, Releaser {this}};
+    }
+
+    SessionSnapshotPool::Handle
+        SessionSnapshotPool::fork(const TextCompleter::SessionState& state) {
+        Handle snapshot = acquire();
+        snapshot->capture(state);
+
+        return snapshot;
+    }
+
+    std::size_t SessionSnapshotPool::size() const {
+        const std::scoped_lock lock {mutex};
+
+        return snapshots.size();
+    }
+
+    std::size_t SessionSnapshotPool::free_count() const {
+        const std::scoped_lock lock {mutex};
+
+        return free_snapshots.size();
+    }
+} // namespace lc
@@ -0,0 +1,78 @@
+#ifndef LEXOCRAFT_SESSION_SNAPSHOT_HPP
+#define LEXOCRAFT_SESSION_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include <lexocraft/llm/text_completion.hpp>
+#include <lexocraft/llm/text_statistics.hpp>
+
+namespace lc {
+    /*
+     Recurrent part of a TextCompleter::SessionState: its memories, live statistics, history
+     hash and last prediction, without the network buffers. Between states of one model,
+     capturing and restoring only copy into storage of the right size, so forking and rolling
+     back a session doesn't allocate.
+    */
+    struct SessionSnapshot {
+        Eigen::VectorXf ephemeral_memory;
+        Eigen::VectorXf context_memory;
+        TextStatistics live_statistics;
+        std::uint64_t history_hash {};
+        TextCompleter::EphemeralMemoryNNOutput last_prediction {
+            TextCompleter::ephemeral_memory_output_sizes_t {}};
+
+        SessionSnapshot() = default;
+        // Storage of the sizes of the model's states
+        explicit SessionSnapshot(const TextCompleter& model);
+
+        SessionSnapshot& capture(const TextCompleter::SessionState& state);
+        void restore(TextCompleter::SessionState& state) const;
+
+        [[nodiscard]] std::size_t memory_usage() const;
+    };
+
+    /*
+     Preallocated snapshots of one model's states. A released snapshot goes back to the pool
+     and keeps its storage for the next fork. Handles must not outlive their pool.
+    */
+    class SessionSnapshotPool {
+        public:
+
+        struct Releaser {
+            SessionSnapshotPool* pool;
+
+            void operator()(SessionSnapshot* snapshot) const;
+        };
+
+        using Handle = std::unique_ptr<SessionSnapshot, Releaser>;
+
+        SessionSnapshotPool(const TextCompleter& model, std::size_t preallocated_count);
+
+        SessionSnapshotPool(const SessionSnapshotPool&) = delete;
+        SessionSnapshotPool& operator=(const SessionSnapshotPool&) = delete;
+
+        // A free snapshot, the pool grows when none is left
+        [[nodiscard]] Handle acquire();
+        // A free snapshot of the state
+        [[nodiscard]] Handle fork(const TextCompleter::SessionState& state);
+
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] std::size_t free_count() const;
+
+        private:
+
+        mutable std::mutex mutex;
+        SessionSnapshot prototype; // Copied for new snapshots
+        std::deque<SessionSnapshot> snapshots; // Addresses stay valid as it grows
+        std::vector<SessionSnapshot*> free_snapshots;
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_SESSION_SNAPSHOT_HPP
@@ -1,9 +1,15 @@
+#include <array>
 #include <algorithm>
-#include <cctype>
+#include <bit>
+#include <cassert>
 #include <cstddef>
 #include <cstdlib>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -12,11 +18,34 @@
 #include <icecream.hpp>
 
 #include <lexocraft/cereal_eigen.hpp>
+#include <lexocraft/hashing.hpp>
 #include <lexocraft/llm/lexer.hpp>
 #include <lexocraft/llm/text_completion.hpp>
+#include <lexocraft/llm/text_statistics.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
 namespace lc {
+    namespace {
+        // In place when the words are stored as floats, otherwise widened into the buffer
+        Eigen::Map<const Eigen::VectorXf> vocabulary_word_vector(const WordStorage& words,
+                                                                 std::size_t index,
+                                                                 Eigen::VectorXf& buffer) {
+            constexpr auto dimensions =
+                static_cast<Eigen::Index>(WordVector::WORD_VECTOR_DIMENSIONS);
+
+            if (words.precision() == VectorPrecision::Float32) {
+                return Eigen::Map<const Eigen::VectorXf> {
+                    static_cast<const float*>(words.vector_data(index)), dimensions};
+            }
+
+            buffer.resize(dimensions);
+            widen_vector(words.vector_data(index), buffer.data(),
+                         WordVector::WORD_VECTOR_DIMENSIONS, words.precision());
+
+            return Eigen::Map<const Eigen::VectorXf> {buffer.data(), dimensions};
+        }
+    } // namespace
+
     TextCompleter::TextCompleter(
         VectorDatabase&& vector_database,
         const ephemeral_memory_fields_sizes_t& ephemeral_memory_fields_sizes,
@@ -59,10 +88,9 @@ namespace lc {
         }));
 
         ephemeral_memory_size = ephemeral_memory_fields_sizes.ephemeral_memory;
-        ephemeral_memory = Eigen::VectorXf::Zero(ephemeral_memory_size);
-
         context_memory_size = context_builder_fields_sizes.context_memory;
-        context_memory = Eigen::VectorXf::Zero(context_memory_size);
+
+        session = new_session_state();
     }
 
     TextCompleter::TextCompleter(VectorDatabase&& vector_database,
@@ -104,10 +132,9 @@ namespace lc {
             .word_vector_value = WordVector::WORD_VECTOR_DIMENSIONS,
         }} {
         ephemeral_memory_size = ephemeral_memory_fields_sizes.ephemeral_memory;
-        ephemeral_memory = Eigen::VectorXf::Zero(ephemeral_memory_size);
-
         context_memory_size = context_builder_fields_sizes.context_memory;
-        context_memory = Eigen::VectorXf::Zero(context_memory_size);
+
+        session = new_session_state();
     }
 
     TextCompleter::VectorDatabasePointerCollection_t
@@ -162,54 +189,66 @@ namespace lc {
     }
 
     float TextCompleter::flesch_kincaid_level(const std::string& text) {
-        std::vector<std::string> words;
-        std::vector<std::string> sentences;
+        return TextStatistics {}.add_characters(text).flesch_kincaid_level();
+    }
 
-        // Split text into words and sentences
-        size_t start = 0;
+    TextCompleter::SessionState TextCompleter::new_session_state() const {
+        SessionState state;
+        state.ephemeral_memory = Eigen::VectorXf::Zero(ephemeral_memory_size);
+        state.context_memory = Eigen::VectorXf::Zero(context_memory_size);
+        state.last_prediction.size_info = ephemeral_memory_output_sizes;
+        state.history_hash = initial_history_hash();
 
-        while (true) {
-            size_t end = text.find_first_of(".!?", start);
+        return state;
+    }
 
-            if (end == std::string::npos) {
-                sentences.push_back(text.substr(start));
-                break;
-            }
+    std::uint64_t TextCompleter::initial_history_hash() const {
+        // The tokens are read as the word vectors of the vocabulary
+        const std::uint64_t vocabulary_hash =
+            vector_database ? mix_hash(vector_database->words.generation()) : 0;
+        const std::uint64_t improviser_hash =
+            mix_hash(word_vector_improviser.version ^ vocabulary_hash);
 
-            sentences.push_back(text.substr(start, end - start + 1));
-            start = end + 1;
-        }
+        return mix_hash(ephemeral_memory_accmulator.version ^
+                        mix_hash(context_builder.version ^ improviser_hash));
+    }
 
-        for (const std::string& sentence: sentences) {
-            words.emplace_back("");
-            for (char letter: sentence) {
-                if (std::isalnum(letter) != 0) {
-                    words.back() += letter;
-                }
-                else {
-                    if (!words.back().empty()) {
-                        words.emplace_back("");
-                    }
-                }
-            }
+    std::uint64_t TextCompleter::history_hash_after_token(
+        std::uint64_t history_hash, const grammar::Token& token, float sentence_length_mean,
+        float sentence_length_stddev, float flesch_kincaid_grade, float sentence_count) {
+        // The value rather than the vocabulary ID, which tokens of other databases don't have
+        std::uint64_t hash = stable_hash(token.value, history_hash);
+
+        for (const float value: {sentence_length_mean, sentence_length_stddev,
+                                 flesch_kincaid_grade, sentence_count}) {
+            hash = mix_hash(hash ^ std::bit_cast<std::uint32_t>(value));
         }
 
-        // Count syllables
-        int syllables = 0;
-        for (const std::string& word: words) {
-            for (char letter: word) {
-                if (std::string("aeiouyAEIOUY").find(letter) != std::string::npos &&
-                    !word.ends_with("e")) {
-                    syllables++;
-                }
-            }
+        return hash;
+    }
+
+    std::uint64_t TextCompleter::history_hash_after_section(std::uint64_t history_hash,
+                                                            float sentence_length_mean,
+                                                            float sentence_length_stddev,
+                                                            float flesch_kincaid_grade) {
+        // Marks the section, so that it doesn't hash like a token
+        std::uint64_t hash = mix_hash(history_hash ^ 0x5ec7104ULL);
+
+        for (const float value:
+             {sentence_length_mean, sentence_length_stddev, flesch_kincaid_grade}) {
+            hash = mix_hash(hash ^ std::bit_cast<std::uint32_t>(value));
         }
 
-        // Calculate grade level
-        float average_sentence_length = static_cast<float>(words.size()) / (sentences.size() - 1);
-        float average_syllables_per_word = syllables / static_cast<float>(words.size());
+        return hash;
+    }
+
+    /********************** NNFieldsInput ********************/
+
+    Eigen::VectorXf TextCompleter::NNFieldsInput::to_vector() const {
+        Eigen::VectorXf vector(size());
+        write_to(vector);
 
-        return 0.39 * average_sentence_length + 11.8 * average_syllables_per_word - 15.59;
+        return vector;
     }
 
     /********************** EphemeralMemoryNNFields ********************/
@@ -220,22 +259,25 @@ namespace lc {
 
     TextCompleter::EphemeralMemoryNNFields::EphemeralMemoryNNFields(
         float sentence_length_mean, float sentence_length_stddev, float flesch_kincaid_grade,
-        float sentence_count, const SearchedWordVector& word,
-        const Eigen::VectorXf& ephemeral_memory, const Eigen::VectorXf& context_memory,
+        float sentence_count, const WordVectorView& word, const Eigen::VectorXf& ephemeral_memory,
+        const Eigen::VectorXf& context_memory,
         const ephemeral_memory_fields_sizes_t& size_info) :
         sentence_length_mean(sentence_length_mean),
         sentence_length_stddev(sentence_length_stddev), flesch_kincaid_grade(flesch_kincaid_grade),
         sentence_count(sentence_count), word(word), ephemeral_memory(ephemeral_memory),
         context_memory(context_memory), size_info(size_info) {
-        assert(static_cast<std::size_t>(word.word_vector.vector.size()) == size_info.word_vector);
+        assert(static_cast<std::size_t>(word.vector.size()) == size_info.word_vector);
         assert(static_cast<std::size_t>(ephemeral_memory.size()) == size_info.ephemeral_memory);
         assert(static_cast<std::size_t>(context_memory.size()) == size_info.context_memory);
     }
 
-    Eigen::VectorXf TextCompleter::EphemeralMemoryNNFields::to_vector() const {
-        const std::size_t vector_length = size_info.total();
+    std::size_t TextCompleter::EphemeralMemoryNNFields::size() const {
+        return size_info.total();
+    }
 
-        Eigen::VectorXf vector(vector_length);
+    void TextCompleter::EphemeralMemoryNNFields::write_to(
+        Eigen::Ref<Eigen::VectorXf> vector) const {
+        assert(static_cast<std::size_t>(vector.size()) == size_info.total());
 
         /* Vector layout encoding:
          * sentence_length_mean
@@ -257,7 +299,7 @@ namespace lc {
         vector(index++) = sentence_count;
         vector(index++) = static_cast<float>(word.improvised);
 
-        vector.segment(index, size_info.word_vector) = word.word_vector.vector;
+        vector.segment(index, size_info.word_vector) = word.vector;
         index += size_info.word_vector;
 
         vector.segment(index, size_info.ephemeral_memory) = ephemeral_memory;
@@ -265,8 +307,6 @@ namespace lc {
 
         vector.segment(index, size_info.context_memory) = context_memory;
         index += size_info.context_memory;
-
-        return vector;
     }
 
     /********************** EphemeralMemoryNNOutput ********************/
@@ -280,7 +320,13 @@ namespace lc {
         size_info(size_info) {
     }
 
-    bool TextCompleter::EphemeralMemoryNNOutput::from_output(const Eigen::VectorXf& output) {
+    bool TextCompleter::EphemeralMemoryNNOutput::from_output(
+        const Eigen::Ref<const Eigen::VectorXf>& output) {
+        return from_output(output, ephemeral_memory);
+    }
+
+    bool TextCompleter::EphemeralMemoryNNOutput::from_output(
+        const Eigen::Ref<const Eigen::VectorXf>& output, Eigen::VectorXf& ephemeral_memory_) {
         const std::size_t expected_size = size_info.total();
 
         if (static_cast<std::size_t>(output.size()) != expected_size) {
@@ -305,7 +351,7 @@ namespace lc {
         token_is_symbol = output(index++);
         is_end = output(index++);
 
-        ephemeral_memory = output.segment(index, size_info.ephemeral_memory);
+        ephemeral_memory_ = output.segment(index, size_info.ephemeral_memory);
         index += size_info.ephemeral_memory;
 
         word_vector_value = output.segment(index, size_info.word_vector_value);
@@ -331,10 +377,13 @@ namespace lc {
         assert(static_cast<std::size_t>(context_memory.size()) == size_info.context_memory);
     }
 
-    Eigen::VectorXf TextCompleter::ContextBuilderNNFields::to_vector() const {
-        const std::size_t vector_length = size_info.total();
+    std::size_t TextCompleter::ContextBuilderNNFields::size() const {
+        return size_info.total();
+    }
 
-        Eigen::VectorXf vector(vector_length);
+    void TextCompleter::ContextBuilderNNFields::write_to(
+        Eigen::Ref<Eigen::VectorXf> vector) const {
+        assert(static_cast<std::size_t>(vector.size()) == size_info.total());
 
         /* Vector layout encoding:
          * sentence_length_mean
@@ -356,8 +405,6 @@ namespace lc {
 
         vector.segment(index, size_info.context_memory) = context_memory;
         index += size_info.context_memory;
-
-        return vector;
     }
 
     /********************** ContextBuilderNNOutput ********************/
@@ -371,7 +418,8 @@ namespace lc {
         size_info(size_info) {
     }
 
-    bool TextCompleter::ContextBuilderNNOutput::from_output(const Eigen::VectorXf& output) {
+    bool TextCompleter::ContextBuilderNNOutput::from_output(
+        const Eigen::Ref<const Eigen::VectorXf>& output) {
         if (static_cast<std::size_t>(output.size()) != size_info.total()) {
             return false;
         }
@@ -398,10 +446,13 @@ namespace lc {
         assert(static_cast<std::size_t>(word_vector_value.size()) == size_info.word_vector_value);
     }
 
-    Eigen::VectorXf TextCompleter::WordVectorImproviserNNFields::to_vector() const {
-        const std::size_t vector_length = size_info.total();
+    std::size_t TextCompleter::WordVectorImproviserNNFields::size() const {
+        return size_info.total();
+    }
 
-        Eigen::VectorXf vector(vector_length);
+    void TextCompleter::WordVectorImproviserNNFields::write_to(
+        Eigen::Ref<Eigen::VectorXf> vector) const {
+        assert(static_cast<std::size_t>(vector.size()) == size_info.total());
 
         /* Vector layout encoding:
          * word_vectors_search_result.similarity
@@ -423,8 +474,6 @@ namespace lc {
 
         vector.segment(index, size_info.word_vector_value) = word_vector_value;
         index += size_info.word_vector_value;
-
-        return vector;
     }
 
     /********************** WordVectorImproviserNNOutput ********************/
@@ -438,7 +487,8 @@ namespace lc {
         size_info(size_info) {
     }
 
-    bool TextCompleter::WordVectorImproviserNNOutput::from_output(const Eigen::VectorXf& output) {
+    bool TextCompleter::WordVectorImproviserNNOutput::from_output(
+        const Eigen::Ref<const Eigen::VectorXf>& output) {
         const std::size_t expected_output_vector_size = size_info.total();
 
         if (static_cast<std::size_t>(output.size()) != expected_output_vector_size) {
@@ -453,71 +503,19 @@ namespace lc {
     /********************** End ********************/
 
     float sentence_count(const std::vector<grammar::Token>& tokens) {
-        std::size_t sentence_count = 0;
-
-        for (const grammar::Token& token: tokens) {
-            if (token.value == "." || token.value == "!" || token.value == "?") {
-                sentence_count++;
-            }
-        }
-
-        return sentence_count;
+        return TextStatistics {}.add(tokens).sentence_count();
     }
 
     float sentence_length_mean(const std::vector<grammar::Token>& tokens) {
-        std::size_t token_count = 0;
-        std::size_t sentence_count = 0;
-
-        for (const grammar::Token& token: tokens) {
-            token_count++;
-
-            if (token.value == "." || token.value == "!" || token.value == "?") {
-                sentence_count++;
-            }
-        }
-
-        return static_cast<float>(token_count) / std::max(std::size_t {1}, sentence_count);
+        return TextStatistics {}.add(tokens).sentence_length_mean();
     }
 
     float sentence_length_stddev(const std::vector<grammar::Token>& tokens) {
-        std::vector<int> sentence_lengths;
-        int current_sentence_length = 0;
-
-        for (const grammar::Token& token: tokens) {
-            if (token.value == ".") {
-                sentence_lengths.push_back(current_sentence_length);
-                current_sentence_length = 0;
-            }
-            else {
-                current_sentence_length++;
-            }
-        }
-
-        if (current_sentence_length > 0) {
-            sentence_lengths.push_back(current_sentence_length);
-        }
-
-        if (sentence_lengths.empty()) {
-            return 0.0F; // No sentences
-        }
-
-        float mean_length = sentence_length_mean(tokens);
-
-        std::vector<float> squared_deviations;
-        for (int length: sentence_lengths) {
-            float deviation = length - mean_length;
-            squared_deviations.push_back(deviation * deviation);
-        }
-
-        float variance =
-            std::accumulate(squared_deviations.begin(), squared_deviations.end(), 0.0F) /
-            sentence_lengths.size();
-
-        return std::sqrt(variance);
+        return TextStatistics {}.add(tokens).sentence_length_stddev();
     }
 
     std::tuple<TextCompleter::SearchedWordVector, grammar::Token::Type>
-        TextCompleter::find_word_vector(const std::string& word) {
+        TextCompleter::find_word_vector(const std::string& word) const {
         for (const auto& [database, type]: get_database_type_pairs()) {
             if (const std::optional<WordVector> word_vector = database->search_from_map(word)) {
                 return {
@@ -536,24 +534,237 @@ namespace lc {
             }
         }
 
+        // Improvising runs the improviser once per fuzzy match, repeated words are looked up
+        const std::uint64_t improviser_version = improvised_word_vector_version();
+
+        if (const std::optional<ImprovisedWordVectorCache::Entry> entry =
+                improvised_word_vector_cache->find(word, improviser_version)) {
+            return {
+                {WordVector {word, entry->vector}, false, true},
+                entry->type
+            };
+        }
+
+        const auto [searched_word_vector, type] = improvise_word_vector(word);
+
+        improvised_word_vector_cache->insert(
+            word, improviser_version, {searched_word_vector.word_vector.vector, type});
+
+        return {searched_word_vector, type};
+    }
+
+    std::uint64_t TextCompleter::improvised_word_vector_version() const {
+        // The fuzzy matches and their vectors come from the words
+        return mix_hash(word_vector_improviser.version ^
+                        mix_hash(vector_database->words.generation()));
+    }
+
+    std::tuple<TextCompleter::SearchedWordVector, grammar::Token::Type>
+        TextCompleter::improvise_word_vector(const std::string& word) const {
+        ImproviserBuffers buffers;
+        const grammar::Token::Type type = improvise_word_vector(word, buffers);
+
+        return {
+            {WordVector {word, buffers.word_vector_value}, false, true},
+            type
+        };
+    }
+
+    grammar::Token::Type TextCompleter::improvise_word_vector(const std::string& word,
+                                                              ImproviserBuffers& buffers) const {
+        const std::array<DatabaseTypePairElement_t, 4> database_type_pairs =
+            get_database_type_pairs();
+
+        // Words of a subdatabase are scored when the cascade of thresholds first reaches it, and
+        // lower thresholds select among the same scores: a match at the first subdatabase scans
+        // only it, and no subdatabase is scanned twice
+        std::array<std::vector<float>, 4> similarities;
+        std::array<std::optional<float>, 4> highest_similarities {};
+
+        const auto highest_similarity = [&](std::size_t index) {
+            if (!highest_similarities [index].has_value()) {
+                similarities [index] =
+                    std::get<0>(database_type_pairs [index])->rapidfuzz_similarities(word);
+
+                highest_similarities [index] =
+                    similarities [index].empty()
+                        ? -std::numeric_limits<float>::infinity()
+                        : *std::max_element(similarities [index].begin(),
+                                            similarities [index].end());
+            }
+
+            return highest_similarities [index].value();
+        };
+
         for (float threshold = 0.9F; threshold >= -0.1F; threshold -= 0.1F) {
-            for (const auto& [database, type]: get_database_type_pairs()) {
+            for (std::size_t index {0}; index < database_type_pairs.size(); ++index) {
+                // A search finds a word as soon as any word reaches the threshold
+                if (highest_similarity(index) < threshold) {
+                    continue;
+                }
+
+                const auto& [database, type] = database_type_pairs [index];
                 const std::vector<VectorDatabase::SearchResult> word_vectors =
-                    database->rapidfuzz_search_closest_n(word, 10, threshold);
+                    database->rapidfuzz_search_closest_n(similarities [index], 10, threshold);
 
                 if (!word_vectors.empty()) {
-                    return {
-                        {improvised_word_vector(word, word_vectors), false, true},
-                        type
-                    };
+                    static_cast<void>(improvised_word_vector(word_vectors, buffers));
+
+                    return type;
                 }
             }
         }
 
+        static_cast<void>(improvised_word_vector({}, buffers));
+
+        return grammar::Token::Type::Alphanumeric;
+    }
+
+    std::tuple<TextCompleter::SearchedWordVector, grammar::Token::Type>
+        TextCompleter::find_word_vector(std::uint32_t vocabulary_id) const {
+        assert(vocabulary_id < vector_database->words.size());
+
+        WordVector word_vector = vector_database->words [vocabulary_id];
+        const grammar::Token::Type type = grammar::token_type(word_vector.word);
+
         return {
-            {improvised_word_vector(word, {}), false, true},
-            grammar::Token::Type::Alphanumeric
+            {std::move(word_vector), false, false},
+            type
+        };
+    }
+
+    std::tuple<TextCompleter::SearchedWordVector, grammar::Token::Type>
+        TextCompleter::find_word_vector(const grammar::Token& token) const {
+        const WordStorage& words = vector_database->words;
+
+        if (token.has_vocabulary_id() && token.vocabulary_id < words.size() &&
+            words.word(token.vocabulary_id) == token.value) {
+            return find_word_vector(token.vocabulary_id);
+        }
+
+        return find_word_vector(token.value);
+    }
+
+    TextCompleter::WordVectorView
+        TextCompleter::find_word_vector(SessionState& state, const grammar::Token& token) const {
+        const WordStorage& words = vector_database->words;
+
+        if (token.has_vocabulary_id() && token.vocabulary_id < words.size() &&
+            words.word(token.vocabulary_id) == token.value) {
+            return {vocabulary_word_vector(words, token.vocabulary_id, state.word_vector_buffer),
+                    false};
+        }
+
+        // Same order as find_word_vector(word), the subdatabases read the vectors of the master
+        for (const auto& [database, type]: get_database_type_pairs()) {
+            if (const std::optional<std::size_t> index = database->find_master_index(token.value)) {
+                return {vocabulary_word_vector(database->master->words, index.value(),
+                                               state.word_vector_buffer),
+                        false};
+            }
+        }
+
+        for (const auto& [database, type]: get_lowercase_database_type_pairs()) {
+            if (const std::optional<std::size_t> index = database->find_master_index(token.value)) {
+                return {vocabulary_word_vector(database->master->words, index.value(),
+                                               state.word_vector_buffer),
+                        false};
+            }
+        }
+
+        const std::uint64_t improviser_version = improvised_word_vector_version();
+
+        if (!improvised_word_vector_cache->find(token.value, improviser_version,
+                                                state.word_vector_buffer)) {
+            ImproviserBuffers& buffers = state.word_vector_improviser_buffers;
+            const grammar::Token::Type type = improvise_word_vector(token.value, buffers);
+
+            improvised_word_vector_cache->insert(token.value, improviser_version,
+                                                 {buffers.word_vector_value, type});
+            state.word_vector_buffer = buffers.word_vector_value;
+        }
+
+        return {Eigen::Map<const Eigen::VectorXf> {state.word_vector_buffer.data(),
+                                                   state.word_vector_buffer.size()},
+                true};
+    }
+
+    std::vector<TextCompleter::DatabaseTypePairElement_t>
+        TextCompleter::typed_search_subdatabases(const EphemeralMemoryNNOutput& prediction,
+                                                 const TypedSearchOptions& options) const {
+        const std::array<DatabaseTypePairElement_t, 4> database_type_pairs =
+            get_database_type_pairs();
+
+        // Same order as get_database_type_pairs(), negative scores count as none
+        const std::array<float, 4> scores {
+            std::max(0.0F, prediction.token_is_alphanumeric),
+            std::max(0.0F, prediction.token_is_digit),
+            std::max(0.0F, prediction.token_is_homogeneous),
+            std::max(0.0F, prediction.token_is_symbol),
         };
+
+        const float score_sum = std::accumulate(scores.begin(), scores.end(), 0.0F);
+        const float highest_score = *std::max_element(scores.begin(), scores.end());
+
+        if (score_sum <= 0.0F || highest_score < options.min_confidence * score_sum) {
+            return {};
+        }
+
+        std::vector<DatabaseTypePairElement_t> subdatabases;
+
+        for (std::size_t index {0}; index < scores.size(); ++index) {
+            const std::shared_ptr<VectorSubdatabase>& subdatabase =
+                std::get<0>(database_type_pairs [index]);
+
+            if (scores [index] >= options.merge_ratio * highest_score && subdatabase &&
+                !subdatabase->empty()) {
+                subdatabases.push_back(database_type_pairs [index]);
+            }
+        }
+
+        return subdatabases;
+    }
+
+    std::vector<VectorDatabase::SearchResult>
+        TextCompleter::search_closest_predicted_n(const EphemeralMemoryNNOutput& prediction,
+                                                  int top_n,
+                                                  const TypedSearchOptions& options) const {
+        const std::vector<DatabaseTypePairElement_t> subdatabases =
+            typed_search_subdatabases(prediction, options);
+
+        if (subdatabases.empty()) {
+            return vector_database->search_closest_vector_value_n(prediction.word_vector_value,
+                                                                  top_n);
+        }
+
+        if (subdatabases.size() == 1) {
+            return std::get<0>(subdatabases.front())
+                ->search_closest_vector_value_n(prediction.word_vector_value, top_n);
+        }
+
+        // Each subdatabase's top_n holds every word of the merged top_n it contains
+        std::vector<VectorDatabase::SearchResult> results;
+
+        for (const auto& [subdatabase, type]: subdatabases) {
+            std::vector<VectorDatabase::SearchResult> subdatabase_results =
+                subdatabase->search_closest_vector_value_n(prediction.word_vector_value, top_n);
+
+            std::move(subdatabase_results.begin(), subdatabase_results.end(),
+                      std::back_inserter(results));
+        }
+
+        const std::size_t kept_count =
+            std::min(static_cast<std::size_t>(std::max(top_n, 0)), results.size());
+
+        std::partial_sort(results.begin(), std::next(results.begin(), kept_count), results.end(),
+                          [](const VectorDatabase::SearchResult& first,
+                             const VectorDatabase::SearchResult& second) {
+                              return first.similarity > second.similarity;
+                          });
+
+        results.resize(kept_count);
+
+        return results;
     }
 
     /********************** Ephemeral Memory Accmulator ********************/
@@ -646,48 +857,98 @@ namespace lc {
     }
 
     TextCompleter& TextCompleter::create_vector_subdatabases() {
-        alphanumeric_vector_subdatabase = std::make_shared<VectorDatabase>();
-        digit_vector_subdatabase = std::make_shared<VectorDatabase>();
-        homogeneous_vector_subdatabase = std::make_shared<VectorDatabase>();
-        symbol_vector_subdatabase = std::make_shared<VectorDatabase>();
-        lowercase_alphanumeric_vector_subdatabase = std::make_shared<VectorDatabase>();
-        lowercase_homogeneous_vector_subdatabase = std::make_shared<VectorDatabase>();
+        alphanumeric_vector_subdatabase = std::make_shared<VectorSubdatabase>(vector_database);
+        digit_vector_subdatabase = std::make_shared<VectorSubdatabase>(vector_database);
+        homogeneous_vector_subdatabase = std::make_shared<VectorSubdatabase>(vector_database);
+        symbol_vector_subdatabase = std::make_shared<VectorSubdatabase>(vector_database);
+        lowercase_alphanumeric_vector_subdatabase =
+            std::make_shared<VectorSubdatabase>(vector_database, true);
+        lowercase_homogeneous_vector_subdatabase =
+            std::make_shared<VectorSubdatabase>(vector_database, true);
+
+        if (!vector_database) {
+            return *this;
+        }
 
-        for (const WordVector& word_vector: vector_database->words) {
-            const grammar::Token::Type token_type = grammar::token_type(word_vector.word);
-            std::string lowercase_word;
+        std::vector<std::size_t> master_indices(vector_database->words.size());
+        std::iota(master_indices.begin(), master_indices.end(), 0);
 
-            std::transform(word_vector.word.begin(), word_vector.word.end(),
-                           std::back_inserter(lowercase_word),
-                           [](char letter) { return std::tolower(letter); });
+        return add_to_vector_subdatabases(master_indices);
+    }
+
+    TextCompleter&
+        TextCompleter::add_to_vector_subdatabases(const std::vector<std::size_t>& master_indices) {
+        std::vector<std::size_t> alphanumeric_indices;
+        std::vector<std::size_t> digit_indices;
+        std::vector<std::size_t> homogeneous_indices;
+        std::vector<std::size_t> symbol_indices;
+
+        for (const std::size_t index: master_indices) {
+            const grammar::Token::Type token_type =
+                grammar::token_type(vector_database->words.word(index));
 
             switch (token_type) {
                 case grammar::Token::Type::Alphanumeric: {
-                    alphanumeric_vector_subdatabase->add_word(word_vector);
-                    lowercase_alphanumeric_vector_subdatabase->add_word(
-                        {lowercase_word, word_vector.vector});
+                    alphanumeric_indices.push_back(index);
                     break;
                 }
 
                 case grammar::Token::Type::Digit: {
-                    digit_vector_subdatabase->add_word(word_vector);
+                    digit_indices.push_back(index);
                     break;
                 }
 
                 case grammar::Token::Type::Homogeneous: {
-                    homogeneous_vector_subdatabase->add_word(word_vector);
-                    lowercase_homogeneous_vector_subdatabase->add_word(
-                        {lowercase_word, word_vector.vector});
+                    homogeneous_indices.push_back(index);
                     break;
                 }
 
                 case grammar::Token::Type::Symbol: {
-                    symbol_vector_subdatabase->add_word(word_vector);
+                    symbol_indices.push_back(index);
                     break;
                 }
             }
         }
 
+        alphanumeric_vector_subdatabase->add_master_words(alphanumeric_indices);
+        lowercase_alphanumeric_vector_subdatabase->add_master_words(alphanumeric_indices);
+        digit_vector_subdatabase->add_master_words(digit_indices);
+        homogeneous_vector_subdatabase->add_master_words(homogeneous_indices);
+        lowercase_homogeneous_vector_subdatabase->add_master_words(homogeneous_indices);
+        symbol_vector_subdatabase->add_master_words(symbol_indices);
+
+        return *this;
+    }
+
+    TextCompleter& TextCompleter::rebuild_dirty_vector_subdatabase_indexes() {
+        for (const std::shared_ptr<VectorSubdatabase>& subdatabase: get_vector_subdatabases()) {
+            if (subdatabase) {
+                subdatabase->rebuild_dirty_annoy_index();
+            }
+        }
+
+        return *this;
+    }
+
+    std::array<std::shared_ptr<VectorSubdatabase>, 6>
+        TextCompleter::get_vector_subdatabases() const {
+        return {
+            alphanumeric_vector_subdatabase,
+            digit_vector_subdatabase,
+            homogeneous_vector_subdatabase,
+            symbol_vector_subdatabase,
+            lowercase_alphanumeric_vector_subdatabase,
+            lowercase_homogeneous_vector_subdatabase,
+        };
+    }
+
+    TextCompleter& TextCompleter::attach_vector_subdatabases() {
+        for (const std::shared_ptr<VectorSubdatabase>& subdatabase: get_vector_subdatabases()) {
+            if (subdatabase) {
+                subdatabase->attach(vector_database);
+            }
+        }
+
         return *this;
     }
 } // namespace lc
@@ -2,8 +2,10 @@
 #define TEXT_COMPLETION_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <span>
 #include <vector>
 
 #include <cereal/types/memory.hpp>
@@ -11,19 +13,31 @@
 #include <Eigen/Eigen>
 
 #include <lexocraft/cereal_eigen.hpp>
+#include <lexocraft/llm/improvised_word_vector_cache.hpp>
 #include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/text_statistics.hpp>
 #include <lexocraft/llm/vector_database.hpp>
+#include <lexocraft/llm/vector_subdatabase.hpp>
 #include <lexocraft/neural_network/neural_network.hpp>
 
 namespace lc {
     using UnaryLayerSizeVectorGenerator_t = std::function<std::size_t(std::size_t)>;
     using BinaryLayerSizeVectorGenerator_t = std::function<std::size_t(std::size_t, std::size_t)>;
 
+    // Of TextCompleter::search_closest_predicted_n()
+    struct TypedSearchOptions {
+        // Share of the (non-negative) type scores the likeliest type needs, below it the
+        // prediction is not trusted and the whole vector_database is searched
+        float min_confidence {0.5F};
+        // Types scoring at least this ratio of the likeliest one are searched too
+        float merge_ratio {0.8F};
+    };
+
     class TextCompleter {
         public:
 
         using DatabaseTypePairElement_t =
-            std::tuple<std::shared_ptr<VectorDatabase>, grammar::Token::Type>;
+            std::tuple<std::shared_ptr<VectorSubdatabase>, grammar::Token::Type>;
 
         struct SearchedWordVector {
             WordVector word_vector;
@@ -31,10 +45,17 @@ namespace lc {
             bool improvised;
         };
 
+        // The vector of a word read in place, from the vocabulary or from a buffer of a session
+        struct WordVectorView {
+            Eigen::Map<const Eigen::VectorXf> vector;
+            bool improvised;
+        };
+
         template <class Archive>
         void serialize(Archive& archive) {
             // clang-format off
-            archive(ephemeral_memory, ephemeral_memory_size, context_memory, context_memory_size, 
+            archive(session.ephemeral_memory, ephemeral_memory_size,
+                    session.context_memory, context_memory_size,
 
                     ephemeral_memory_accmulator, context_builder, word_vector_improviser,
 
@@ -57,37 +78,44 @@ namespace lc {
                     word_vector_improviser_output_sizes
                     );
             // clang-format on
+
+            if constexpr (Archive::is_loading::value) {
+                attach_vector_subdatabases();
+            }
         }
 
-        Eigen::VectorXf ephemeral_memory;
         std::size_t ephemeral_memory_size;
-
-        Eigen::VectorXf context_memory;
         std::size_t context_memory_size;
 
         NeuralNetwork ephemeral_memory_accmulator;
         NeuralNetwork context_builder;
         NeuralNetwork word_vector_improviser;
 
+        // Improvised word vectors of improvised_word_vector_version(), shared by copies and not
+        // serialized with the completer. Copies with other words or improvisers miss each
+        // other's entries.
+        std::shared_ptr<ImprovisedWordVectorCache> improvised_word_vector_cache {
+            std::make_shared<ImprovisedWordVectorCache>()};
+
         std::shared_ptr<VectorDatabase> vector_database;
 
-        std::shared_ptr<VectorDatabase> alphanumeric_vector_subdatabase;
-        std::shared_ptr<VectorDatabase> digit_vector_subdatabase;
-        std::shared_ptr<VectorDatabase> homogeneous_vector_subdatabase;
-        std::shared_ptr<VectorDatabase> symbol_vector_subdatabase;
+        std::shared_ptr<VectorSubdatabase> alphanumeric_vector_subdatabase;
+        std::shared_ptr<VectorSubdatabase> digit_vector_subdatabase;
+        std::shared_ptr<VectorSubdatabase> homogeneous_vector_subdatabase;
+        std::shared_ptr<VectorSubdatabase> symbol_vector_subdatabase;
 
-        std::shared_ptr<VectorDatabase> lowercase_alphanumeric_vector_subdatabase;
-        std::shared_ptr<VectorDatabase> lowercase_homogeneous_vector_subdatabase;
+        std::shared_ptr<VectorSubdatabase> lowercase_alphanumeric_vector_subdatabase;
+        std::shared_ptr<VectorSubdatabase> lowercase_homogeneous_vector_subdatabase;
 
         struct VectorDatabasePointerCollection_t {
             std::shared_ptr<VectorDatabase> vector_database;
-            std::shared_ptr<VectorDatabase> alphanumeric_vector_subdatabase;
-            std::shared_ptr<VectorDatabase> digit_vector_subdatabase;
-            std::shared_ptr<VectorDatabase> homogeneous_vector_subdatabase;
-            std::shared_ptr<VectorDatabase> symbol_vector_subdatabase;
+            std::shared_ptr<VectorSubdatabase> alphanumeric_vector_subdatabase;
+            std::shared_ptr<VectorSubdatabase> digit_vector_subdatabase;
+            std::shared_ptr<VectorSubdatabase> homogeneous_vector_subdatabase;
+            std::shared_ptr<VectorSubdatabase> symbol_vector_subdatabase;
 
-            std::shared_ptr<VectorDatabase> lowercase_alphanumeric_vector_subdatabase;
-            std::shared_ptr<VectorDatabase> lowercase_homogeneous_vector_subdatabase;
+            std::shared_ptr<VectorSubdatabase> lowercase_alphanumeric_vector_subdatabase;
+            std::shared_ptr<VectorSubdatabase> lowercase_homogeneous_vector_subdatabase;
         };
 
         [[nodiscard]] VectorDatabasePointerCollection_t get_vector_database_pointers() const;
@@ -99,15 +127,20 @@ namespace lc {
         [[nodiscard]] std::array<DatabaseTypePairElement_t, 2>
             get_lowercase_database_type_pairs() const;
 
+        // Fields reference their values, which are only copied into the network input
         struct NNFieldsInput {
             virtual ~NNFieldsInput() = default; // Abstract
-            [[nodiscard]] virtual Eigen::VectorXf to_vector() const = 0;
+            [[nodiscard]] virtual std::size_t size() const = 0;
+            // `vector` has size() elements
+            virtual void write_to(Eigen::Ref<Eigen::VectorXf> vector) const = 0;
+            [[nodiscard]] Eigen::VectorXf to_vector() const;
         };
 
         template <typename Output>
         struct NNOutput { // Abstract
             virtual ~NNOutput() = default;
-            virtual bool from_output(const Eigen::VectorXf& output) = 0;
+            // Vectors keep their storage when read again, so reading doesn't allocate
+            virtual bool from_output(const Eigen::Ref<const Eigen::VectorXf>& output) = 0;
         };
 
         /******************** EphemeralMemoryNNFields ********************/
@@ -130,7 +163,7 @@ namespace lc {
 
             EphemeralMemoryNNFields(float sentence_length_mean, float sentence_length_stddev,
                                     float flesch_kincaid_grade, float sentence_count,
-                                    const SearchedWordVector& word,
+                                    const WordVectorView& word,
                                     const Eigen::VectorXf& ephemeral_memory,
                                     const Eigen::VectorXf& context_memory,
                                     const ephemeral_memory_fields_sizes_t& size_info);
@@ -140,13 +173,14 @@ namespace lc {
             // float word_sophistication;  // Interval: [0, 1] - 0 = Uncommon, 1 = Most common
             float flesch_kincaid_grade; // Interval: [0, 20] - 0 = Most difficult, 20 = Easiest
             float sentence_count;
-            SearchedWordVector word;
-            Eigen::VectorXf ephemeral_memory;
-            Eigen::VectorXf context_memory;
+            WordVectorView word;
+            const Eigen::VectorXf& ephemeral_memory;
+            const Eigen::VectorXf& context_memory;
 
             ephemeral_memory_fields_sizes_t size_info;
 
-            [[nodiscard]] Eigen::VectorXf to_vector() const final;
+            [[nodiscard]] std::size_t size() const final;
+            void write_to(Eigen::Ref<Eigen::VectorXf> vector) const final;
         };
 
         /******************** EphemeralMemoryNNOutput ********************/
@@ -178,7 +212,10 @@ namespace lc {
 
             ephemeral_memory_output_sizes_t size_info;
 
-            bool from_output(const Eigen::VectorXf& output) final;
+            bool from_output(const Eigen::Ref<const Eigen::VectorXf>& output) final;
+            // Reads the ephemeral memory into `ephemeral_memory_` instead of the member
+            bool from_output(const Eigen::Ref<const Eigen::VectorXf>& output,
+                             Eigen::VectorXf& ephemeral_memory_);
         };
 
         /******************** ContextBuilderNNFields ********************/
@@ -208,12 +245,13 @@ namespace lc {
             float sentence_length_stddev;
             // float word_sophistication;  // Interval: [0, 1] - 0 = Uncommon, 1 = Most common
             float flesch_kincaid_grade; // Interval: [0, 20] - 0 = Most difficult, 20 = Easiest
-            Eigen::VectorXf ephemeral_memory;
-            Eigen::VectorXf context_memory;
+            const Eigen::VectorXf& ephemeral_memory;
+            const Eigen::VectorXf& context_memory;
 
             context_builder_fields_sizes_t size_info;
 
-            [[nodiscard]] Eigen::VectorXf to_vector() const final;
+            [[nodiscard]] std::size_t size() const final;
+            void write_to(Eigen::Ref<Eigen::VectorXf> vector) const final;
         };
 
         /******************** ContextBuilderNNOutput ********************/
@@ -238,7 +276,7 @@ namespace lc {
 
             context_builder_output_sizes_t size_info;
 
-            bool from_output(const Eigen::VectorXf& output) final;
+            bool from_output(const Eigen::Ref<const Eigen::VectorXf>& output) final;
         };
 
         /******************** WordVectorImproviserNNFields ********************/
@@ -264,13 +302,14 @@ namespace lc {
                                          const Eigen::VectorXf& word_vector_value,
                                          const word_vector_improviser_fields_sizes_t& size_info);
 
-            VectorDatabase::SearchResult word_vectors_search_result;
-            Eigen::VectorXf ephemeral_memory;
-            Eigen::VectorXf word_vector_value;
+            const VectorDatabase::SearchResult& word_vectors_search_result;
+            const Eigen::VectorXf& ephemeral_memory;
+            const Eigen::VectorXf& word_vector_value;
 
             word_vector_improviser_fields_sizes_t size_info;
 
-            [[nodiscard]] Eigen::VectorXf to_vector() const final;
+            [[nodiscard]] std::size_t size() const final;
+            void write_to(Eigen::Ref<Eigen::VectorXf> vector) const final;
         };
 
         /******************** WordVectorImproviserNNOutput ********************/
@@ -295,19 +334,104 @@ namespace lc {
 
             word_vector_improviser_output_sizes_t size_info;
 
-            bool from_output(const Eigen::VectorXf& output) final;
+            bool from_output(const Eigen::Ref<const Eigen::VectorXf>& output) final;
         };
 
+        /******************** SessionState ********************/
+
+        // Input and layers of a network, reused between steps so that a step doesn't allocate
+        struct NNBuffers {
+            Eigen::VectorXf input;
+            NeuralNetwork::ComputeBuffers layers;
+        };
+
+        // Everything word_vector_improviser computes into, reused between improvised words
+        struct ImproviserBuffers {
+            NNBuffers network;
+            Eigen::VectorXf ephemeral_memory; // Zeroed, the improviser starts from no session's
+            Eigen::VectorXf word_vector_value;
+            WordVectorImproviserNNOutput output {word_vector_improviser_output_sizes_t {}};
+        };
+
+        // Everything predicting changes, so that sessions can share one const TextCompleter.
+        // Only the memories of the completer's own session are saved with the model.
+        struct SessionState {
+            Eigen::VectorXf ephemeral_memory;
+            Eigen::VectorXf context_memory;
+
+            TextStatistics live_statistics; // Statistics of the section predicted so far
+
+            NNBuffers ephemeral_memory_accmulator_buffers;
+            NNBuffers context_builder_buffers;
+
+            // Widened or improvised vector of the token being read
+            Eigen::VectorXf word_vector_buffer;
+            ImproviserBuffers word_vector_improviser_buffers;
+
+            EphemeralMemoryNNOutput last_prediction {ephemeral_memory_output_sizes_t {}};
+
+            // Rolling hash of everything the memories were computed from, equal for states that
+            // took the same tokens and sections from a new state of the same networks
+            std::uint64_t history_hash {};
+        };
+
+        SessionState session;
+
+        // Zeroed memories of this completer's sizes
+        [[nodiscard]] SessionState new_session_state() const;
+
+        // history_hash of a new state, which depends on the versions of the networks and the
+        // generation of the vocabulary
+        [[nodiscard]] std::uint64_t initial_history_hash() const;
+        [[nodiscard]] static std::uint64_t
+            history_hash_after_token(std::uint64_t history_hash, const grammar::Token& token,
+                                     float sentence_length_mean, float sentence_length_stddev,
+                                     float flesch_kincaid_grade, float sentence_count);
+        [[nodiscard]] static std::uint64_t
+            history_hash_after_section(std::uint64_t history_hash, float sentence_length_mean,
+                                       float sentence_length_stddev, float flesch_kincaid_grade);
+
         /******************** End ********************/
 
         static float flesch_kincaid_level(const std::string& text);
 
-        std::tuple<SearchedWordVector, grammar::Token::Type>
-            find_word_vector(const std::string& word);
-
-        WordVector improvised_word_vector(
+        // Out-of-vocabulary words are improvised once per version of word_vector_improviser and
+        // generation of the vocabulary
+        [[nodiscard]] std::tuple<SearchedWordVector, grammar::Token::Type>
+            find_word_vector(const std::string& word) const;
+        // Version of the improvised_word_vector_cache entries this completer reads and writes
+        [[nodiscard]] std::uint64_t improvised_word_vector_version() const;
+
+        // Word of the master database, which is in the subdatabase of its type, so no lookup is
+        // needed. Token::vocabulary_id is such an index when tokenized with vector_database.
+        [[nodiscard]] std::tuple<SearchedWordVector, grammar::Token::Type>
+            find_word_vector(std::uint32_t vocabulary_id) const;
+
+        // By the token's vocabulary_id when it is the index of the token's word in
+        // vector_database, otherwise by its value: the token may come from another database or
+        // from before the vocabulary changed
+        [[nodiscard]] std::tuple<SearchedWordVector, grammar::Token::Type>
+            find_word_vector(const grammar::Token& token) const;
+        // The same vector without copying the word: a view into float vocabulary storage,
+        // otherwise into state.word_vector_buffer. Valid until the state reads the next token or
+        // the vocabulary changes.
+        [[nodiscard]] WordVectorView find_word_vector(SessionState& state,
+                                                      const grammar::Token& token) const;
+
+        [[nodiscard]] WordVector improvised_word_vector(
             const std::string& word,
-            const std::vector<VectorDatabase::SearchResult>& word_vectors_search_result);
+            const std::vector<VectorDatabase::SearchResult>& word_vectors_search_result) const;
+        // Into buffers.word_vector_value, which the next improvisation with the buffers overwrites
+        const Eigen::VectorXf& improvised_word_vector(
+            const std::vector<VectorDatabase::SearchResult>& word_vectors_search_result,
+            ImproviserBuffers& buffers) const;
+
+        // Improvises from the closest fuzzy matches of the word, bypassing the cache
+        [[nodiscard]] std::tuple<SearchedWordVector, grammar::Token::Type>
+            improvise_word_vector(const std::string& word) const;
+        // Same, the vector is left in buffers.word_vector_value
+        grammar::Token::Type improvise_word_vector(const std::string& word,
+                                                   ImproviserBuffers& buffers) const;
 
         TextCompleter& reset_ephemeral_memory();
         TextCompleter& reset_context_memory();
@@ -315,12 +439,45 @@ namespace lc {
         Eigen::VectorXf accumulate_context_memory(float sentence_length_mean,
                                                   float sentence_length_stddev,
                                                   float flesch_kincaid_grade);
-
-        EphemeralMemoryNNOutput predict_next_token_value(const grammar::Token& token,
-                                                         float sentence_length_mean_,
-                                                         float sentence_length_stddev_,
-                                                         float flesch_kincaid_grade_,
-                                                         float sentence_count_);
+        Eigen::VectorXf accumulate_context_memory(SessionState& state, float sentence_length_mean,
+                                                  float sentence_length_stddev,
+                                                  float flesch_kincaid_grade) const;
+
+        // The prediction is the last_prediction of the session, which the next one overwrites.
+        // Its ephemeral memory is read straight into the session's, the member stays empty.
+        const EphemeralMemoryNNOutput& predict_next_token_value(const grammar::Token& token,
+                                                                float sentence_length_mean_,
+                                                                float sentence_length_stddev_,
+                                                                float flesch_kincaid_grade_,
+                                                                float sentence_count_);
+        const EphemeralMemoryNNOutput& predict_next_token_value(SessionState& state,
+                                                                const grammar::Token& token,
+                                                                float sentence_length_mean_,
+                                                                float sentence_length_stddev_,
+                                                                float flesch_kincaid_grade_,
+                                                                float sentence_count_) const;
+
+        // Appends the token to live_statistics and predicts with the statistics of the section
+        // so far, in time independent of the section length
+        const EphemeralMemoryNNOutput& predict_next_token_value(const grammar::Token& token);
+        const EphemeralMemoryNNOutput& predict_next_token_value(SessionState& state,
+                                                                const grammar::Token& token) const;
+
+        // predict_next_token_value(states [index], tokens [index]) for every session at once,
+        // the accumulator runs once for the whole batch. A session may only appear once.
+        void predict_next_token_values(std::span<SessionState* const> states,
+                                       std::span<const grammar::Token> tokens) const;
+
+        // Type subdatabases a prediction's word is searched in, none for the whole database
+        [[nodiscard]] std::vector<DatabaseTypePairElement_t>
+            typed_search_subdatabases(const EphemeralMemoryNNOutput& prediction,
+                                      const TypedSearchOptions& options = {}) const;
+
+        // The top_n words closest to the predicted word vector among the words of the predicted
+        // type(s), closest first
+        [[nodiscard]] std::vector<VectorDatabase::SearchResult>
+            search_closest_predicted_n(const EphemeralMemoryNNOutput& prediction, int top_n,
+                                       const TypedSearchOptions& options = {}) const;
 
         /*
             NeuralNetwork ephemeral_memory_accmulator;
@@ -348,7 +505,17 @@ namespace lc {
 
         TextCompleter& set_vector_database(VectorDatabase&& vector_database);
 
+        // Subdatabases are views over vector_database and have to be recreated after changing it
         TextCompleter& create_vector_subdatabases();
+        TextCompleter& attach_vector_subdatabases();
+
+        // Routes master words to their type and lowercase subdatabases in one partition pass.
+        // Built Annoy indexes that took new words are left dirty until rebuilt.
+        TextCompleter& add_to_vector_subdatabases(const std::vector<std::size_t>& master_indices);
+        TextCompleter& rebuild_dirty_vector_subdatabase_indexes();
+
+        [[nodiscard]] std::array<std::shared_ptr<VectorSubdatabase>, 6>
+            get_vector_subdatabases() const;
 
         TextCompleter() = default;
         TextCompleter(const TextCompleter&) = default;
@@ -399,6 +566,8 @@ namespace lc {
 
         TextCompleter& start_new_section(float sentence_length_mean, float sentence_length_stddev,
                                          float flesch_kincaid_grade);
+        // Ends the section with its live_statistics
+        TextCompleter& start_new_section();
 
         TextCompleter& add_word_vector(const WordVector& added_word_vector);
         TextCompleter& add_word_vector(const std::vector<WordVector>& added_word_vectors);
@@ -408,6 +577,11 @@ namespace lc {
         TextCompleter& save_file(const std::filesystem::path& filepath);
         TextCompleter& load_file(const std::filesystem::path& filepath);
 
+        // Saved next to the completer, loading keeps the cache as is when word_vector_improviser
+        // or the vocabulary changed since it was saved
+        TextCompleter& save_improvised_word_vector_cache(const std::filesystem::path& filepath);
+        bool load_improvised_word_vector_cache(const std::filesystem::path& filepath);
+
         std::vector<grammar::Token> tokenize(const std::string& text);
     };
 
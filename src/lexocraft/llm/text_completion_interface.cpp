@@ -12,36 +12,53 @@ namespace lc {
     TextCompleter& TextCompleter::start_new_section(float sentence_length_mean,
                                                     float sentence_length_stddev,
                                                     float flesch_kincaid_grade) {
-        this->context_memory = this->accumulate_context_memory(
-            sentence_length_mean, sentence_length_stddev, flesch_kincaid_grade);
+        this->accumulate_context_memory(sentence_length_mean, sentence_length_stddev,
+                                        flesch_kincaid_grade);
+        this->session.live_statistics = {};
         return *this;
     }
 
+    TextCompleter& TextCompleter::start_new_section() {
+        const TextStatistics& statistics = session.live_statistics;
+
+        return start_new_section(statistics.sentence_length_mean(),
+                                 statistics.sentence_length_stddev(),
+                                 statistics.flesch_kincaid_level());
+    }
+
     TextCompleter& TextCompleter::add_word_vector(const WordVector& added_word_vector) {
-        vector_database->add_word(added_word_vector);
-        return create_vector_subdatabases();
+        return add_word_vector(std::vector<WordVector> {added_word_vector});
     }
 
     TextCompleter&
         TextCompleter::add_word_vector(const std::vector<WordVector>& added_word_vectors) {
+        // Subdatabases created for another (or no) master have to be recreated from scratch
+        const bool subdatabases_are_current =
+            alphanumeric_vector_subdatabase &&
+            alphanumeric_vector_subdatabase->master == vector_database;
+
+        std::vector<std::size_t> master_indices;
+        master_indices.reserve(added_word_vectors.size());
+
         for (const auto& word_vector: added_word_vectors) {
             vector_database->add_word(word_vector);
+            master_indices.push_back(vector_database->words.find(word_vector.word).value());
+        }
+
+        if (!subdatabases_are_current) {
+            return create_vector_subdatabases();
         }
 
-        return create_vector_subdatabases();
+        return add_to_vector_subdatabases(master_indices);
     }
 
     TextCompleter& TextCompleter::add_word_vector(const std::string& word,
                                                   const Eigen::VectorXf& vector) {
-        vector_database->add_word(WordVector(word, vector));
-
-        return create_vector_subdatabases();
+        return add_word_vector(WordVector(word, vector));
     }
 
     TextCompleter& TextCompleter::add_word_vector(const std::string& word, bool random) {
-        vector_database->add_word(WordVector(word, random));
-
-        return create_vector_subdatabases();
+        return add_word_vector(WordVector(word, random));
     }
 
     TextCompleter& TextCompleter::save_file(const std::filesystem::path& filepath) {
@@ -64,6 +81,21 @@ namespace lc {
         return *this;
     }
 
+    TextCompleter&
+        TextCompleter::save_improvised_word_vector_cache(const std::filesystem::path& filepath) {
+        improvised_word_vector_cache->save_file(filepath, improvised_word_vector_version(),
+                                                word_vector_improviser.fingerprint(),
+                                                vector_database->words.fingerprint());
+
+        return *this;
+    }
+
+    bool TextCompleter::load_improvised_word_vector_cache(const std::filesystem::path& filepath) {
+        return improvised_word_vector_cache->load_file(filepath, improvised_word_vector_version(),
+                                                       word_vector_improviser.fingerprint(),
+                                                       vector_database->words.fingerprint());
+    }
+
     std::vector<grammar::Token> TextCompleter::tokenize(const std::string& text) {
         return grammar::tokenize(text, *vector_database);
     }
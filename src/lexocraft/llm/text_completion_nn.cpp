@@ -4,34 +4,69 @@
 #include <nanobench.h>
 
 #include <lexocraft/fancy_eigen_print.hpp>
+#include <lexocraft/hashing.hpp>
 #include <lexocraft/llm/text_completion.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
 namespace lc {
+    namespace {
+        // Writes the fields into the input buffer of the network, which keeps its storage
+        Eigen::Ref<const Eigen::VectorXf> compute_fields(const NeuralNetwork& network,
+                                                         const TextCompleter::NNFieldsInput& fields,
+                                                         TextCompleter::NNBuffers& buffers) {
+            buffers.input.resize(static_cast<Eigen::Index>(fields.size()));
+            fields.write_to(buffers.input);
+
+            return network.compute_into(buffers.input, buffers.layers);
+        }
+    } // namespace
+
     WordVector TextCompleter::improvised_word_vector(
         const std::string& word,
-        const std::vector<VectorDatabase::SearchResult>& word_vectors_search_result) {
-        Eigen::VectorXf word_vector_value =
-            Eigen::VectorXf::Zero(word_vector_improviser_fields_sizes.word_vector_value);
-        ephemeral_memory =
-            Eigen::VectorXf::Zero(word_vector_improviser_fields_sizes.ephemeral_memory);
+        const std::vector<VectorDatabase::SearchResult>& word_vectors_search_result) const {
+        ImproviserBuffers buffers;
+
+        return WordVector {word, improvised_word_vector(word_vectors_search_result, buffers)};
+    }
+
+    const Eigen::VectorXf& TextCompleter::improvised_word_vector(
+        const std::vector<VectorDatabase::SearchResult>& word_vectors_search_result,
+        ImproviserBuffers& buffers) const {
+        // The improviser always starts from zeroed memory, which is no session's. Vectors of the
+        // same size keep their storage.
+        buffers.ephemeral_memory.setZero(
+            static_cast<Eigen::Index>(word_vector_improviser_fields_sizes.ephemeral_memory));
+        buffers.word_vector_value.setZero(
+            static_cast<Eigen::Index>(word_vector_improviser_fields_sizes.word_vector_value));
+        buffers.output.size_info = word_vector_improviser_output_sizes;
 
         for (const VectorDatabase::SearchResult& result: word_vectors_search_result) {
-            WordVectorImproviserNNFields fields(result, ephemeral_memory, word_vector_value,
-                                                word_vector_improviser_fields_sizes);
+            const WordVectorImproviserNNFields fields(result, buffers.ephemeral_memory,
+                                                      buffers.word_vector_value,
+                                                      word_vector_improviser_fields_sizes);
 
-            WordVectorImproviserNNOutput output(word_vector_improviser_output_sizes);
+            [[maybe_unused]] const bool is_read = buffers.output.from_output(
+                compute_fields(word_vector_improviser, fields, buffers.network));
+            assert(is_read && "Word vector improviser output has the wrong size");
 
-            const auto compute_result {word_vector_improviser.compute(fields.to_vector())};
-            assert(output.from_output(compute_result));
-            word_vector_value = output.word_vector_value;
+            // The previous value is overwritten by the next output, so no copy is needed
+            buffers.word_vector_value.swap(buffers.output.word_vector_value);
         }
 
-        return WordVector {word, word_vector_value};
+        return buffers.word_vector_value;
     }
 
     TextCompleter& TextCompleter::reset_ephemeral_memory() {
-        ephemeral_memory.setZero();
+        session.ephemeral_memory.setZero();
+        // Part of the history like a token, the state is no new state
+        session.history_hash = mix_hash(session.history_hash ^ 0xe9e3ULL);
+
+        return *this;
+    }
+
+    TextCompleter& TextCompleter::reset_context_memory() {
+        session.context_memory.setZero();
+        session.history_hash = mix_hash(session.history_hash ^ 0xc0e3ULL);
 
         return *this;
     }
@@ -39,42 +74,125 @@ namespace lc {
     Eigen::VectorXf TextCompleter::accumulate_context_memory(float sentence_length_mean,
                                                              float sentence_length_stddev,
                                                              float flesch_kincaid_grade) {
-        ContextBuilderNNFields fields(sentence_length_mean, sentence_length_stddev,
-                                      flesch_kincaid_grade, ephemeral_memory, context_memory,
-                                      context_builder_fields_sizes);
+        return accumulate_context_memory(session, sentence_length_mean, sentence_length_stddev,
+                                         flesch_kincaid_grade);
+    }
 
-        ContextBuilderNNOutput output(context_builder_output_sizes);
+    Eigen::VectorXf TextCompleter::accumulate_context_memory(SessionState& state,
+                                                             float sentence_length_mean,
+                                                             float sentence_length_stddev,
+                                                             float flesch_kincaid_grade) const {
+        const ContextBuilderNNFields fields(sentence_length_mean, sentence_length_stddev,
+                                            flesch_kincaid_grade, state.ephemeral_memory,
+                                            state.context_memory, context_builder_fields_sizes);
 
-        const auto compute_result {context_builder.compute(fields.to_vector())};
+        ContextBuilderNNOutput output(context_builder_output_sizes);
 
-        assert(output.from_output(compute_result));
+        [[maybe_unused]] const bool is_read = output.from_output(
+            compute_fields(context_builder, fields, state.context_builder_buffers));
+        assert(is_read && "Context builder output has the wrong size");
 
-        this->reset_ephemeral_memory();
-        this->context_memory = output.context_memory;
+        state.ephemeral_memory.setZero();
+        // The output is local, its buffer can become the state's
+        state.context_memory.swap(output.context_memory);
+        state.history_hash = history_hash_after_section(state.history_hash, sentence_length_mean,
+                                                        sentence_length_stddev,
+                                                        flesch_kincaid_grade);
 
-        return output.context_memory;
+        return state.context_memory;
     }
 
-    TextCompleter::EphemeralMemoryNNOutput TextCompleter::predict_next_token_value(
+    const TextCompleter::EphemeralMemoryNNOutput& TextCompleter::predict_next_token_value(
         const grammar::Token& token, float sentence_length_mean_, float sentence_length_stddev_,
         float flesch_kincaid_grade_, float sentence_count_) {
-        struct found_word_vector_result_t {
-            WordVector word_vector_result;
-            grammar::Token::Type type;
-        };
+        return predict_next_token_value(session, token, sentence_length_mean_,
+                                        sentence_length_stddev_, flesch_kincaid_grade_,
+                                        sentence_count_);
+    }
+
+    const TextCompleter::EphemeralMemoryNNOutput& TextCompleter::predict_next_token_value(
+        SessionState& state, const grammar::Token& token, float sentence_length_mean_,
+        float sentence_length_stddev_, float flesch_kincaid_grade_, float sentence_count_) const {
+        const WordVectorView word_vector = find_word_vector(state, token);
+
+        const EphemeralMemoryNNFields fields(sentence_length_mean_, sentence_length_stddev_,
+                                             flesch_kincaid_grade_, sentence_count_, word_vector,
+                                             state.ephemeral_memory, state.context_memory,
+                                             ephemeral_memory_fields_sizes);
+
+        EphemeralMemoryNNOutput& prediction = state.last_prediction;
+        prediction.size_info = ephemeral_memory_output_sizes;
 
-        const auto [word_vector_result, type] = find_word_vector(token.value);
+        // The fields were written to the input, so the memory can be overwritten in place
+        [[maybe_unused]] const bool is_read = prediction.from_output(
+            compute_fields(ephemeral_memory_accmulator, fields,
+                           state.ephemeral_memory_accmulator_buffers),
+            state.ephemeral_memory);
+        assert(is_read && "Ephemeral memory accumulator output has the wrong size");
 
-        const EphemeralMemoryNNFields fields(
-            sentence_length_mean_, sentence_length_stddev_, flesch_kincaid_grade_, sentence_count_,
-            word_vector_result, ephemeral_memory, context_memory, ephemeral_memory_fields_sizes);
+        state.history_hash = history_hash_after_token(state.history_hash, token,
+                                                      sentence_length_mean_,
+                                                      sentence_length_stddev_,
+                                                      flesch_kincaid_grade_, sentence_count_);
 
-        EphemeralMemoryNNOutput output(ephemeral_memory_output_sizes);
+        return prediction;
+    }
+
+    const TextCompleter::EphemeralMemoryNNOutput&
+        TextCompleter::predict_next_token_value(const grammar::Token& token) {
+        return predict_next_token_value(session, token);
+    }
+
+    const TextCompleter::EphemeralMemoryNNOutput&
+        TextCompleter::predict_next_token_value(SessionState& state,
+                                                const grammar::Token& token) const {
+        TextStatistics& statistics = state.live_statistics;
+        statistics.add(token);
+
+        return predict_next_token_value(state, token, statistics.sentence_length_mean(),
+                                        statistics.sentence_length_stddev(),
+                                        statistics.flesch_kincaid_level(),
+                                        statistics.sentence_count());
+    }
+
+    void TextCompleter::predict_next_token_values(std::span<SessionState* const> states,
+                                                  std::span<const grammar::Token> tokens) const {
+        assert(states.size() == tokens.size());
+
+        Eigen::MatrixXf inputs(ephemeral_memory_fields_sizes.total(), states.size());
+
+        for (std::size_t index {0}; index < states.size(); ++index) {
+            SessionState& state = *states [index];
+            const grammar::Token& token = tokens [index];
 
-        assert(output.from_output(ephemeral_memory_accmulator.compute(fields.to_vector())));
+            TextStatistics& statistics = state.live_statistics;
+            statistics.add(token);
 
-        this->ephemeral_memory = output.ephemeral_memory;
+            const WordVectorView word_vector = find_word_vector(state, token);
 
-        return output;
+            const EphemeralMemoryNNFields fields(
+                statistics.sentence_length_mean(), statistics.sentence_length_stddev(),
+                statistics.flesch_kincaid_level(), statistics.sentence_count(), word_vector,
+                state.ephemeral_memory, state.context_memory, ephemeral_memory_fields_sizes);
+
+            fields.write_to(inputs.col(static_cast<Eigen::Index>(index)));
+
+            state.history_hash = history_hash_after_token(
+                state.history_hash, token, fields.sentence_length_mean,
+                fields.sentence_length_stddev, fields.flesch_kincaid_grade, fields.sentence_count);
+        }
+
+        const Eigen::MatrixXf outputs = ephemeral_memory_accmulator.compute_batch(inputs);
+
+        for (std::size_t index {0}; index < states.size(); ++index) {
+            SessionState& state = *states [index];
+
+            EphemeralMemoryNNOutput& prediction = state.last_prediction;
+            prediction.size_info = ephemeral_memory_output_sizes;
+
+            [[maybe_unused]] const bool is_read = prediction.from_output(
+                outputs.col(static_cast<Eigen::Index>(index)), state.ephemeral_memory);
+            assert(is_read && "Ephemeral memory accumulator output has the wrong size");
+        }
     }
 } // namespace lc
@@ -6,6 +6,7 @@
 #include <lexocraft/llm/lexer.hpp>
 #include <lexocraft/llm/text_completion.hpp>
 #include <lexocraft/llm/text_completion_training.hpp>
+#include <lexocraft/llm/text_statistics.hpp>
 
 namespace lc {
     float TextCompletionTrainer::calculate_prediction_costs(
@@ -14,11 +15,14 @@ namespace lc {
         const std::optional<CostWeightCoefficients>& cost_weight_coefficients) {
         const std::vector<grammar::Token> tokens = text_completer->tokenize(training_data_section);
 
-        const float section_sentence_length_mean = sentence_length_mean(tokens);
-        const float section_sentence_length_stddev = sentence_length_stddev(tokens);
-        const float section_flesch_kincaid_level =
-            TextCompleter::flesch_kincaid_level(training_data_section);
-        const float section_sentence_count = sentence_count(tokens);
+        // One pass over the tokens for every section statistic
+        TextStatistics section_statistics;
+        section_statistics.add(tokens);
+
+        const float section_sentence_length_mean = section_statistics.sentence_length_mean();
+        const float section_sentence_length_stddev = section_statistics.sentence_length_stddev();
+        const float section_flesch_kincaid_level = section_statistics.flesch_kincaid_level();
+        const float section_sentence_count = section_statistics.sentence_count();
 
         float cost_sum {};
 
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cmath>
+
+#include <lexocraft/llm/character_classes.hpp>
+#include <lexocraft/llm/text_statistics.hpp>
+
+namespace lc {
+    namespace {
+        bool is_alphanumeric(char letter) {
+            return (grammar::character_classes(letter) &
+                    (grammar::character_class::LETTER | grammar::character_class::DIGIT)) != 0;
+        }
+
+        bool is_vowel(char letter) {
+            return std::string_view {"aeiouyAEIOUY"}.find(letter) != std::string_view::npos;
+        }
+
+        bool is_sentence_terminator(char letter) {
+            return letter == '.' || letter == '!' || letter == '?';
+        }
+    } // namespace
+
+    TextStatistics::Run& TextStatistics::Run::append(const Run& next) {
+        if (next.length > 0) {
+            last = next.last;
+        }
+
+        length += next.length;
+        vowels += next.vowels;
+
+        return *this;
+    }
+
+    std::size_t TextStatistics::Run::syllables() const {
+        // Words ending with an 'e' have no syllables, as in flesch_kincaid_level()
+        return length > 0 && last != 'e' ? vowels : 0;
+    }
+
+    void TextStatistics::SentenceLengths::add_sentence(std::uint64_t length) {
+        ++count;
+        sum += length;
+        square_sum += length * length;
+    }
+
+    TextStatistics& TextStatistics::add(const grammar::Token& token) {
+        add_token(token.value, token.next_is_space);
+
+        return *this;
+    }
+
+    TextStatistics& TextStatistics::add(std::span<const grammar::Token> tokens) {
+        for (const grammar::Token& token: tokens) {
+            add_token(token.value, token.next_is_space);
+        }
+
+        return *this;
+    }
+
+    TextStatistics& TextStatistics::add(const grammar::CompactToken& token,
+                                        std::string_view text) {
+        add_token(token.value(text), token.next_is_space);
+
+        return *this;
+    }
+
+    TextStatistics& TextStatistics::add_characters(std::string_view characters) {
+        for (const char letter: characters) {
+            add_character(letter);
+        }
+
+        return *this;
+    }
+
+    void TextStatistics::add_token(std::string_view value, bool next_is_space) {
+        ++token_count;
+
+        if (value.size() == 1 && is_sentence_terminator(value.front())) {
+            ++terminating_token_count;
+        }
+
+        if (value == ".") {
+            if (sentence_lengths.has_period) {
+                sentence_lengths.add_sentence(sentence_lengths.trailing);
+                sentence_lengths.trailing = 0;
+            } else {
+                sentence_lengths.has_period = true;
+            }
+        } else {
+            ++(sentence_lengths.has_period ? sentence_lengths.trailing : sentence_lengths.leading);
+        }
+
+        // The skipped spaces separate words, how many of them doesn't matter
+        add_characters(value);
+
+        if (next_is_space) {
+            add_character(' ');
+        }
+    }
+
+    void TextStatistics::add_character(char letter) {
+        if (is_alphanumeric(letter)) {
+            Run& run = word_counts.has_separator ? word_counts.trailing : word_counts.leading;
+            run.append({1, is_vowel(letter) ? std::size_t {1} : 0, letter});
+
+            return;
+        }
+
+        if (!word_counts.has_separator) {
+            word_counts.has_separator = true;
+        } else if (word_counts.trailing.length > 0) {
+            ++word_counts.closed_runs;
+            word_counts.closed_syllables += word_counts.trailing.syllables();
+            word_counts.trailing = {0, 0, '\0'};
+        }
+
+        if (is_sentence_terminator(letter)) {
+            ++word_counts.sentence_terminators;
+        }
+    }
+
+    TextStatistics& TextStatistics::merge(const TextStatistics& next) {
+        token_count += next.token_count;
+        terminating_token_count += next.terminating_token_count;
+
+        SentenceLengths& lengths = sentence_lengths;
+        const SentenceLengths& next_lengths = next.sentence_lengths;
+
+        if (!next_lengths.has_period) {
+            (lengths.has_period ? lengths.trailing : lengths.leading) += next_lengths.leading;
+        } else if (!lengths.has_period) {
+            lengths.leading += next_lengths.leading;
+            lengths.has_period = true;
+            lengths.trailing = next_lengths.trailing;
+            lengths.count = next_lengths.count;
+            lengths.sum = next_lengths.sum;
+            lengths.square_sum = next_lengths.square_sum;
+        } else {
+            lengths.add_sentence(lengths.trailing + next_lengths.leading);
+            lengths.trailing = next_lengths.trailing;
+            lengths.count += next_lengths.count;
+            lengths.sum += next_lengths.sum;
+            lengths.square_sum += next_lengths.square_sum;
+        }
+
+        WordCounts& words = word_counts;
+        const WordCounts& next_words = next.word_counts;
+
+        words.sentence_terminators += next_words.sentence_terminators;
+
+        if (!next_words.has_separator) {
+            (words.has_separator ? words.trailing : words.leading).append(next_words.leading);
+        } else if (!words.has_separator) {
+            words.leading.append(next_words.leading);
+            words.has_separator = true;
+            words.trailing = next_words.trailing;
+            words.closed_runs = next_words.closed_runs;
+            words.closed_syllables = next_words.closed_syllables;
+        } else {
+            // The run that straddles both parts is closed by the first separator of the next
+            const Run straddling_run = Run {words.trailing}.append(next_words.leading);
+
+            if (straddling_run.length > 0) {
+                ++words.closed_runs;
+                words.closed_syllables += straddling_run.syllables();
+            }
+
+            words.trailing = next_words.trailing;
+            words.closed_runs += next_words.closed_runs;
+            words.closed_syllables += next_words.closed_syllables;
+        }
+
+        return *this;
+    }
+
+    float TextStatistics::sentence_count() const {
+        return static_cast<float>(terminating_token_count);
+    }
+
+    float TextStatistics::sentence_length_mean() const {
+        return static_cast<float>(token_count) /
+               static_cast<float>(std::max(std::uint64_t {1}, terminating_token_count));
+    }
+
+    float TextStatistics::sentence_length_stddev() const {
+        // The first sentence ends at the first period even when empty, the last one only
+        // counts when it isn't
+        SentenceLengths sentences = sentence_lengths;
+
+        if (sentences.has_period) {
+            sentences.add_sentence(sentences.leading);
+
+            if (sentences.trailing > 0) {
+                sentences.add_sentence(sentences.trailing);
+            }
+        } else if (sentences.leading > 0) {
+            sentences.add_sentence(sentences.leading);
+        }
+
+        if (sentences.count == 0) {
+            return 0.0F; // No sentences
+        }
+
+        // Sum of (length - mean)^2, expanded so that the lengths needn't be kept
+        const auto mean = static_cast<double>(sentence_length_mean());
+        const double squared_deviation_sum = static_cast<double>(sentences.square_sum) -
+                                             2.0 * mean * static_cast<double>(sentences.sum) +
+                                             static_cast<double>(sentences.count) * mean * mean;
+
+        const float variance = static_cast<float>(std::max(0.0, squared_deviation_sum)) /
+                               static_cast<float>(sentences.count);
+
+        return std::sqrt(variance);
+    }
+
+    float TextStatistics::flesch_kincaid_level() const {
+        const WordCounts& words = word_counts;
+
+        // Every sentence, the one after the last terminator included, starts with an empty
+        // word, and every run closed by a separator adds one
+        const std::uint64_t word_count =
+            words.sentence_terminators + 1 + words.closed_runs +
+            (words.has_separator && words.leading.length > 0 ? 1 : 0);
+        const std::uint64_t syllables = words.closed_syllables + words.leading.syllables() +
+                                        (words.has_separator ? words.trailing.syllables() : 0);
+
+        // Sentences minus the one after the last terminator, but at least one: an infinite level
+        // for text without a terminator, as every live section starts, poisons the networks
+        const float average_sentence_length =
+            static_cast<float>(word_count) /
+            static_cast<float>(std::max(std::uint64_t {1}, words.sentence_terminators));
+        const float average_syllables_per_word =
+            static_cast<float>(syllables) / static_cast<float>(word_count);
+
+        return static_cast<float>(0.39 * average_sentence_length +
+                                  11.8 * average_syllables_per_word - 15.59);
+    }
+} // namespace lc
@@ -0,0 +1,81 @@
+#ifndef LEXOCRAFT_TEXT_STATISTICS_HPP
+#define LEXOCRAFT_TEXT_STATISTICS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <lexocraft/llm/lexer.hpp>
+
+namespace lc {
+    /*
+     Sentence count, sentence length mean and stddev and Flesch-Kincaid level of a text in one
+     pass over its tokens, with the same formulas as sentence_count(), sentence_length_mean(),
+     sentence_length_stddev() and TextCompleter::flesch_kincaid_level().
+
+     Statistics of consecutive parts of a text merge into the statistics of the whole, so parts
+     can be accumulated in parallel.
+    */
+    class TextStatistics {
+        public:
+
+        TextStatistics& add(const grammar::Token& token);
+        TextStatistics& add(std::span<const grammar::Token> tokens);
+        TextStatistics& add(const grammar::CompactToken& token, std::string_view text);
+
+        // Raw characters only feed the Flesch-Kincaid counts
+        TextStatistics& add_characters(std::string_view characters);
+
+        // `next` has to be the part of the text that follows this one
+        TextStatistics& merge(const TextStatistics& next);
+
+        [[nodiscard]] float sentence_count() const;
+        [[nodiscard]] float sentence_length_mean() const;
+        [[nodiscard]] float sentence_length_stddev() const;
+        [[nodiscard]] float flesch_kincaid_level() const;
+
+        private:
+
+        // Run of alphanumeric characters, a word for Flesch-Kincaid
+        struct Run {
+            std::size_t length;
+            std::size_t vowels;
+            char last;
+
+            Run& append(const Run& next);
+            [[nodiscard]] std::size_t syllables() const;
+        };
+
+        // Sentences are split at "." tokens only, the tokens between them are counted
+        struct SentenceLengths {
+            bool has_period;
+            std::uint64_t leading; // Tokens before the first period, or all of them
+            std::uint64_t trailing; // Tokens after the last period
+            std::uint64_t count; // Sentences between two periods of this part
+            std::uint64_t sum;
+            std::uint64_t square_sum;
+
+            void add_sentence(std::uint64_t length);
+        };
+
+        struct WordCounts {
+            bool has_separator; // Any non-alphanumeric character
+            Run leading; // Run before the first separator, or all characters
+            Run trailing; // Run after the last separator
+            std::uint64_t closed_runs; // Runs between two separators of this part
+            std::uint64_t closed_syllables;
+            std::uint64_t sentence_terminators; // '.', '!' and '?'
+        };
+
+        void add_token(std::string_view value, bool next_is_space);
+        void add_character(char letter);
+
+        std::uint64_t token_count {};
+        std::uint64_t terminating_token_count {}; // ".", "!" and "?" tokens
+        SentenceLengths sentence_lengths {false, 0, 0, 0, 0, 0};
+        WordCounts word_counts {false, {0, 0, '\0'}, {0, 0, '\0'}, 0, 0, 0};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_TEXT_STATISTICS_HPP
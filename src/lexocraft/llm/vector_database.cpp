@@ -1,8 +1,21 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cmath>
 #include <fstream>
 #include <functional>
+#include <limits>
+#include <mutex>
 #include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include <BS_thread_pool.hpp>
 #include <cereal/archives/binary.hpp>
 #include <cereal/cereal.hpp>
 #include <cereal/types/string.hpp>
@@ -12,9 +25,70 @@
 #include <icecream.hpp>
 
 #include <lexocraft/cereal_eigen.hpp>
+#include <lexocraft/hashing.hpp>
+#include <lexocraft/llm/mapped_file.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
 namespace lc {
+    namespace {
+        // Fixed so that the chunks, and with them the random vectors, don't depend on thread count
+        constexpr std::size_t PLAINTEXT_CHUNK_SIZE = std::size_t {1} << 20U;
+
+        struct PlaintextChunk {
+            std::vector<std::string_view> words; // Views into the mapped file
+            std::vector<float> vectors;
+            std::size_t arena_size {};
+        };
+
+        bool is_space(char letter) {
+            return std::isspace(static_cast<unsigned char>(letter)) != 0;
+        }
+
+        std::string_view trim_whitespace(std::string_view line) {
+            while (!line.empty() && is_space(line.front())) {
+                line.remove_prefix(1);
+            }
+
+            while (!line.empty() && is_space(line.back())) {
+                line.remove_suffix(1);
+            }
+
+            return line;
+        }
+
+        PlaintextChunk parse_plaintext_chunk(std::string_view text, std::size_t chunk_index) {
+            // The vectors follow the words of the chunk, the index keeps repeated chunks apart
+            const std::uint64_t text_hash = stable_hash(text);
+            std::seed_seq seed {static_cast<std::uint32_t>(chunk_index),
+                                static_cast<std::uint32_t>(text_hash),
+                                static_cast<std::uint32_t>(text_hash >> 32U)};
+
+            PlaintextChunk chunk;
+            std::mt19937 random_engine {seed};
+            std::uniform_real_distribution<float> distribution {-1.0F, 1.0F};
+
+            while (!text.empty()) {
+                const std::size_t line_end = std::min(text.find('\n'), text.size());
+                const std::string_view word = trim_whitespace(text.substr(0, line_end));
+
+                text.remove_prefix(std::min(line_end + 1, text.size()));
+
+                if (word.empty()) {
+                    continue;
+                }
+
+                chunk.words.push_back(word);
+                chunk.arena_size += word.size();
+
+                for (std::size_t index {0}; index < WordVector::WORD_VECTOR_DIMENSIONS; ++index) {
+                    chunk.vectors.push_back(distribution(random_engine));
+                }
+            }
+
+            return chunk;
+        }
+    } // namespace
+
     WordVector::WordVector(std::string&& word, Vector_t&& vector) :
         word(std::move(word)), vector(std::move(vector)) {
     }
@@ -59,37 +133,450 @@ namespace lc {
         return vector.data();
     }
 
+    WordStorage::Iterator::Iterator(const WordStorage* storage, std::size_t index) :
+        storage {storage}, index {index} {
+    }
+
+    WordVector WordStorage::Iterator::operator*() const {
+        return (*storage) [index];
+    }
+
+    WordStorage::Iterator& WordStorage::Iterator::operator++() {
+        ++index;
+
+        return *this;
+    }
+
+    WordStorage::Iterator WordStorage::Iterator::operator++(int) {
+        Iterator previous {*this};
+        ++index;
+
+        return previous;
+    }
+
+    bool WordStorage::Iterator::operator==(const Iterator& other) const {
+        return storage == other.storage && index == other.index;
+    }
+
+    WordStorage::WordStorage(const WordStorage& other) :
+        file {other.file}, owned_arena {other.owned_arena}, owned_offsets {other.owned_offsets},
+        owned_lengths {other.owned_lengths}, owned_vectors {other.owned_vectors},
+        owned_index {other.owned_index}, owned_longest_word {other.owned_longest_word},
+        frozen_index {other.frozen_index}, vocabulary_generation {other.vocabulary_generation} {
+        refresh_views();
+    }
+
+    WordStorage& WordStorage::operator=(const WordStorage& other) {
+        if (this != &other) {
+            WordStorage copy {other};
+            *this = std::move(copy);
+        }
+
+        return *this;
+    }
+
+    WordStorage::WordStorage(const std::vector<WordVector>& words) {
+        reserve(words.size());
+
+        for (const WordVector& word: words) {
+            push_back(word);
+        }
+    }
+
+    WordStorage::WordStorage(std::shared_ptr<const VectorDatabaseFile> file) :
+        file {std::move(file)} {
+        refresh_views();
+    }
+
+    std::size_t WordStorage::size() const {
+        return word_count;
+    }
+
+    bool WordStorage::empty() const {
+        return word_count == 0;
+    }
+
+    std::size_t WordStorage::longest_word() const {
+        return file ? file->longest_word() : owned_longest_word;
+    }
+
+    VectorPrecision WordStorage::precision() const {
+        return vector_precision;
+    }
+
+    bool WordStorage::is_borrowed() const {
+        return file != nullptr;
+    }
+
+    std::string_view WordStorage::word(std::size_t index) const {
+        return {std::next(arena_data, offsets_data [index]), lengths_data [index]};
+    }
+
+    const void* WordStorage::vector_data(std::size_t index) const {
+        return std::next(vectors_data, static_cast<std::ptrdiff_t>(index * vector_stride));
+    }
+
+    WordVector WordStorage::operator[](std::size_t index) const {
+        WordVector word_vector {std::string {word(index)}, false};
+
+        widen_vector(vector_data(index), word_vector.vector.data(),
+                     WordVector::WORD_VECTOR_DIMENSIONS, vector_precision);
+
+        return word_vector;
+    }
+
+    WordVector WordStorage::at(std::size_t index) const {
+        if (index >= word_count) {
+            throw std::out_of_range("WordStorage::at index " + std::to_string(index) +
+                                    " is out of range for size " + std::to_string(word_count));
+        }
+
+        return (*this) [index];
+    }
+
+    std::optional<std::size_t> WordStorage::find(std::string_view word) const {
+        if (frozen_index) {
+            const std::optional<std::uint32_t> candidate = frozen_index->candidate(word);
+
+            if (candidate.has_value() && this->word(candidate.value()) == word) {
+                return candidate.value();
+            }
+
+            return std::nullopt;
+        }
+
+        if (file) {
+            return file->find(word);
+        }
+
+        const auto iterator = owned_index.find(word);
+
+        if (iterator == owned_index.end()) {
+            return std::nullopt;
+        }
+
+        return iterator->second;
+    }
+
+    std::span<const char> WordStorage::string_arena() const {
+        return file ? file->string_arena() : std::span<const char> {owned_arena};
+    }
+
+    std::span<const std::uint32_t> WordStorage::string_offsets() const {
+        return {offsets_data, word_count};
+    }
+
+    std::span<const std::uint16_t> WordStorage::string_lengths() const {
+        return {lengths_data, word_count};
+    }
+
+    Eigen::Map<const Eigen::MatrixXf> WordStorage::vectors() const {
+        assert(vector_precision == VectorPrecision::Float32 &&
+               "Only float vectors can be viewed as a matrix");
+
+        return {reinterpret_cast<const float*>(vectors_data),
+                static_cast<Eigen::Index>(WordVector::WORD_VECTOR_DIMENSIONS),
+                static_cast<Eigen::Index>(word_count)};
+    }
+
+    WordStorage::Iterator WordStorage::begin() const {
+        return {this, 0};
+    }
+
+    WordStorage::Iterator WordStorage::end() const {
+        return {this, word_count};
+    }
+
+    std::size_t WordStorage::push_back(std::string_view word, const float* vector) {
+        if (word.size() > std::numeric_limits<std::uint16_t>::max()) {
+            throw std::length_error("WordStorage::push_back word of " +
+                                    std::to_string(word.size()) +
+                                    " bytes is longer than 16 bit lengths allow");
+        }
+
+        if (string_arena().size() + word.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("WordStorage::push_back word of " +
+                                    std::to_string(word.size()) +
+                                    " bytes overflows the 32 bit offsets of the string arena");
+        }
+
+        materialize();
+
+        if (frozen_index) {
+            frozen_index = nullptr;
+            rebuild_index();
+        }
+
+        const std::size_t index = owned_offsets.size();
+
+        owned_offsets.push_back(owned_arena.size());
+        owned_lengths.push_back(word.size());
+        owned_arena.insert(owned_arena.end(), word.begin(), word.end());
+        owned_vectors.insert(owned_vectors.end(), vector,
+                             std::next(vector, WordVector::WORD_VECTOR_DIMENSIONS));
+        owned_index [std::string {word}] = index;
+        owned_longest_word = std::max(owned_longest_word, word.size());
+
+        refresh_views();
+        vocabulary_generation = next_generation();
+
+        return index;
+    }
+
+    std::size_t WordStorage::push_back(const WordVector& word) {
+        return push_back(word.word, word.data());
+    }
+
+    void WordStorage::set_vector(std::size_t index, const float* vector) {
+        materialize();
+
+        const auto offset = static_cast<std::ptrdiff_t>(index * WordVector::WORD_VECTOR_DIMENSIONS);
+
+        std::copy_n(vector, WordVector::WORD_VECTOR_DIMENSIONS,
+                    std::next(owned_vectors.begin(), offset));
+        vocabulary_generation = next_generation();
+    }
+
+    void WordStorage::reserve(std::size_t capacity, std::size_t arena_size) {
+        materialize();
+
+        owned_arena.reserve(arena_size);
+        owned_offsets.reserve(capacity);
+        owned_lengths.reserve(capacity);
+        owned_vectors.reserve(capacity * WordVector::WORD_VECTOR_DIMENSIONS);
+        owned_index.reserve(capacity);
+
+        refresh_views();
+    }
+
+    void WordStorage::clear() {
+        *this = WordStorage {};
+    }
+
+    WordStorage& WordStorage::materialize() {
+        if (!file) {
+            return *this;
+        }
+
+        const std::shared_ptr<const VectorDatabaseFile> borrowed_file = std::move(file);
+        const std::size_t borrowed_count = word_count;
+        const VectorPrecision borrowed_precision = vector_precision;
+        const std::span<const char> borrowed_arena = borrowed_file->string_arena();
+
+        owned_arena.assign(borrowed_arena.begin(), borrowed_arena.end());
+        owned_offsets.assign(offsets_data, std::next(offsets_data, borrowed_count));
+        owned_lengths.assign(lengths_data, std::next(lengths_data, borrowed_count));
+        owned_vectors.resize(borrowed_count * WordVector::WORD_VECTOR_DIMENSIONS);
+        widen_vector(vectors_data, owned_vectors.data(), owned_vectors.size(), borrowed_precision);
+        owned_longest_word = borrowed_file->longest_word();
+
+        rebuild_index();
+        refresh_views();
+
+        return *this;
+    }
+
+    WordStorage& WordStorage::freeze() {
+        if (is_frozen()) {
+            return *this;
+        }
+
+        // Only the last occurrence of a repeated word can be found, like with the map
+        std::vector<std::uint32_t> word_indices;
+        word_indices.reserve(word_count);
+
+        for (std::size_t index {0}; index < word_count; ++index) {
+            if (find(word(index)) == index) {
+                word_indices.push_back(index);
+            }
+        }
+
+        frozen_index = std::make_shared<const PerfectHash>(
+            word_indices, [this](std::uint32_t index) { return word(index); });
+        owned_index = WordIndex_t {};
+
+        return *this;
+    }
+
+    bool WordStorage::is_frozen() const {
+        return perfect_hash() != nullptr;
+    }
+
+    std::uint64_t WordStorage::generation() const {
+        return vocabulary_generation;
+    }
+
+    std::uint64_t WordStorage::fingerprint() const {
+        std::uint64_t hash {mix_hash(static_cast<std::uint64_t>(vector_precision))};
+
+        for (std::size_t index = 0; index < word_count; ++index) {
+            hash = stable_hash(word(index), hash);
+            hash = stable_hash({reinterpret_cast<const char*>(vector_data(index)), vector_stride},
+                               hash);
+        }
+
+        return hash;
+    }
+
+    std::uint64_t WordStorage::next_generation() {
+        static std::atomic<std::uint64_t> last_generation {0};
+
+        return ++last_generation;
+    }
+
+    const PerfectHash* WordStorage::perfect_hash() const {
+        if (frozen_index) {
+            return frozen_index.get();
+        }
+
+        return file ? file->perfect_hash() : nullptr;
+    }
+
+    void WordStorage::rebuild_index() {
+        owned_index.clear();
+        owned_index.reserve(owned_offsets.size());
+        owned_longest_word = 0;
+
+        for (std::size_t index {0}; index < owned_offsets.size(); ++index) {
+            const std::string_view word {std::next(owned_arena.data(), owned_offsets [index]),
+                                         owned_lengths [index]};
+
+            owned_index [std::string {word}] = index;
+            owned_longest_word = std::max(owned_longest_word, word.size());
+        }
+    }
+
+    void WordStorage::refresh_views() {
+        if (file) {
+            word_count = file->size();
+            arena_data = file->string_arena().data();
+            offsets_data = file->string_offsets().data();
+            lengths_data = file->string_lengths().data();
+            vectors_data = file->vector(0);
+            vector_precision = file->precision();
+        }
+
+        else {
+            word_count = owned_offsets.size();
+            arena_data = owned_arena.data();
+            offsets_data = owned_offsets.data();
+            lengths_data = owned_lengths.data();
+            vectors_data = reinterpret_cast<const std::byte*>(owned_vectors.data());
+            vector_precision = VectorPrecision::Float32;
+        }
+
+        vector_stride = WordVector::WORD_VECTOR_DIMENSIONS * precision_bytes(vector_precision);
+    }
+
     VectorDatabase::VectorDatabase(const std::vector<WordVector>& words) : words(words) {
         for (std::size_t index {0}; index < words.size(); ++index) {
-            const WordVector& word = words.at(index);
-            word_map [word.word] = word;
-            annoy_index->add_item(index, word.vector.data());
+            annoy_index->add_item(index, words.at(index).vector.data());
         }
     }
 
+    VectorDatabase VectorDatabase::from_plaintext(const std::filesystem::path& filepath,
+                                                  std::size_t threads_count) {
+        const MappedFile file {filepath};
+        const std::string_view text = file.view();
+
+        // Chunks end after a newline so that no line is split between two of them
+        std::vector<std::string_view> chunk_texts;
+
+        for (std::size_t start {0}; start < text.size();) {
+            std::size_t end = std::min(start + PLAINTEXT_CHUNK_SIZE, text.size());
+            end = std::min(text.find('\n', end - 1), text.size() - 1) + 1;
+
+            chunk_texts.push_back(text.substr(start, end - start));
+            start = end;
+        }
+
+        std::vector<PlaintextChunk> chunks(chunk_texts.size());
+
+        {
+            BS::thread_pool thread_pool(threads_count);
+
+            for (std::size_t index {0}; index < chunk_texts.size(); ++index) {
+                static_cast<void>(thread_pool.submit_task([&chunks, &chunk_texts, index] {
+                    chunks [index] = parse_plaintext_chunk(chunk_texts [index], index);
+                }));
+            }
+
+            thread_pool.wait();
+        }
+
+        std::size_t word_count {0};
+        std::size_t arena_size {0};
+
+        for (const PlaintextChunk& chunk: chunks) {
+            word_count += chunk.words.size();
+            arena_size += chunk.arena_size;
+        }
+
+        VectorDatabase database;
+        database.words.reserve(word_count, arena_size);
+
+        for (const PlaintextChunk& chunk: chunks) {
+            for (std::size_t index {0}; index < chunk.words.size(); ++index) {
+                const float* const vector =
+                    &chunk.vectors [index * WordVector::WORD_VECTOR_DIMENSIONS];
+                const std::size_t word_index =
+                    database.words.push_back(chunk.words [index], vector);
+
+                database.annoy_index->add_item(static_cast<int>(word_index), vector);
+            }
+        }
+
+        return database;
+    }
+
     void VectorDatabase::add_word(const std::string& word, bool randomize_vector) {
         // (WordVector {std::string {word}, randomize_vector})
 
         const WordVector new_word {std::string {word}, randomize_vector};
-        words.push_back(new_word);
-        word_map [word] = new_word;
-        const int index = words.size() - 1;
+        const int index = words.push_back(new_word);
         annoy_index->add_item(index, new_word.vector.data());
+
+        if (phonetic_index_is_built) {
+            phonetic_index.add_word(index, word);
+        }
+
+        if (ivfpq_index->is_trained()) {
+            unshared_ivfpq_index().add_item(index, new_word.vector.data());
+        }
     }
 
     void VectorDatabase::add_word(const WordVector& word, bool replace_existing) {
-        const bool already_has_word = word_map.contains(word.word);
+        const std::optional<std::size_t> existing_index = words.find(word.word);
+
+        if (replace_existing && existing_index.has_value()) {
+            const auto index = static_cast<int>(existing_index.value());
+            words.set_vector(existing_index.value(), word.data());
 
-        if (replace_existing && already_has_word) {
-            word_map [word.word] = word;
+            // The cell and code of the previous vector would select the candidates
+            if (ivfpq_index->is_trained()) {
+                unshared_ivfpq_index().remove_item(index).add_item(index, word.vector.data());
+            }
         }
 
-        else if (!already_has_word) {
-            words.push_back(word);
-            word_map [word.word] = word;
+        else if (!existing_index.has_value()) {
+            const std::size_t index = words.push_back(word);
+
+            if (ivfpq_index->is_trained()) {
+                unshared_ivfpq_index().add_item(static_cast<int>(index), word.vector.data());
+            }
+
+            if (phonetic_index_is_built) {
+                phonetic_index.add_word(index, word.word);
+            }
         }
     }
 
+    VectorDatabase& VectorDatabase::freeze() {
+        words.freeze();
+
+        return *this;
+    }
+
     void VectorDatabase::save_file(const std::filesystem::path& filepath) const {
         assert(annoy_index_is_built && "Annoy index must be built before saving");
 
@@ -106,12 +593,6 @@ namespace lc {
         cereal::BinaryInputArchive iarchive {file};
 
         iarchive(*this);
-
-        // Add words to map
-
-        for (const WordVector& word: words) {
-            word_map [word.word] = word;
-        }
     }
 
     bool add_search_result(std::vector<VectorDatabase::SearchResult>& results,
@@ -167,15 +648,16 @@ namespace lc {
             return results.size() == static_cast<std::size_t>(top_n);
         };
 
-        for (const WordVector& word: words) {
-            const float similarity = rapidfuzz::fuzz::ratio(searched_word, word.word) / 100.0F;
+        for (std::size_t index {0}; index < words.size(); ++index) {
+            const float similarity =
+                rapidfuzz::fuzz::ratio(searched_word, words.word(index)) / 100.0F;
 
             if (similarity < threshold) {
                 continue;
             }
 
-            const bool was_added =
-                add_search_result(results, {word, similarity}, top_n, lowest_similarity_in_top_n);
+            const bool was_added = add_search_result(results, {words [index], similarity, index},
+                                                     top_n, lowest_similarity_in_top_n);
 
             if (was_added && results_are_full() && stop_when_top_n_are_found) {
                 break;
@@ -185,6 +667,97 @@ namespace lc {
         return results;
     }
 
+    std::vector<VectorDatabase::SearchResult> VectorDatabase::phonetic_search_closest_n(
+        const std::string& searched_word, int top_n, float threshold, float soundex_weight,
+        float levenshtein_weight) const {
+        assert(phonetic_index_is_built && "Phonetic index must be built before searching");
+        assert(soundex_weight + levenshtein_weight > 0.0F);
+
+        const std::optional<PhoneticIndex::Code_t> searched_code =
+            PhoneticIndex::soundex(searched_word);
+
+        const float total_weight = soundex_weight + levenshtein_weight;
+        const rapidfuzz::fuzz::CachedRatio<char> scorer {searched_word};
+
+        const auto soundex_similarity = [](std::size_t prefix_length) {
+            return static_cast<float>(prefix_length) / PhoneticIndex::CODE_LENGTH;
+        };
+
+        std::vector<SearchResult> results;
+
+        results.reserve(top_n);
+
+        // Whether words sharing prefix_length code characters can still enter the top_n
+        const auto can_rank = [&](std::size_t prefix_length) {
+            const float best_similarity =
+                (soundex_weight * soundex_similarity(prefix_length) + levenshtein_weight) /
+                total_weight;
+
+            return best_similarity >= threshold &&
+                   (results.size() < static_cast<std::size_t>(top_n) ||
+                    best_similarity >= results.back().similarity);
+        };
+
+        const auto add_word = [&](std::uint32_t index, std::size_t prefix_length) {
+            const auto levenshtein_similarity =
+                static_cast<float>(scorer.similarity(words.word(index)) / 100.0);
+            const float similarity = (soundex_weight * soundex_similarity(prefix_length) +
+                                      levenshtein_weight * levenshtein_similarity) /
+                                     total_weight;
+
+            if (similarity < threshold) {
+                return;
+            }
+
+            const std::optional<float> lowest_similarity_in_top_n =
+                results.empty() ? std::nullopt : std::optional<float> {results.back().similarity};
+
+            add_search_result(results, {words [index], similarity, index}, top_n,
+                              lowest_similarity_in_top_n);
+        };
+
+        // Without a letter there is no code to share, every word is compared by spelling only
+        if (!searched_code.has_value()) {
+            if (can_rank(0)) {
+                for (std::uint32_t index {0}; index < words.size(); ++index) {
+                    add_word(index, 0);
+                }
+            }
+
+            return results;
+        }
+
+        for (std::size_t prefix_length {PhoneticIndex::CODE_LENGTH}; prefix_length > 0;
+             --prefix_length) {
+            if (!can_rank(prefix_length)) {
+                return results;
+            }
+
+            for (const PhoneticIndex::Code_t code:
+                 PhoneticIndex::codes_sharing_prefix(searched_code.value(), prefix_length)) {
+                for (const std::uint32_t index: phonetic_index.words_with_code(code)) {
+                    add_word(index, prefix_length);
+                }
+            }
+        }
+
+        // Words of another first letter, or without a code, can still rank by spelling alone
+        if (can_rank(0)) {
+            for (const PhoneticIndex::Code_t code:
+                 PhoneticIndex::codes_sharing_prefix(searched_code.value(), 0)) {
+                for (const std::uint32_t index: phonetic_index.words_with_code(code)) {
+                    add_word(index, 0);
+                }
+            }
+
+            for (const std::uint32_t index: phonetic_index.words_without_code()) {
+                add_word(index, 0);
+            }
+        }
+
+        return results;
+    }
+
     std::vector<VectorDatabase::SearchResult>
         VectorDatabase::search_closest_vector_value_n(const WordVector& searched_vector, int top_n,
                                                       int search_k) const {
@@ -194,6 +767,26 @@ namespace lc {
     std::vector<VectorDatabase::SearchResult>
         VectorDatabase::search_closest_vector_value_n(const Eigen::VectorXf& searched_vector,
                                                       int top_n, int search_k) const {
+        if (index_backend == IndexBackend::IVFPQ) {
+            IVFPQSearchParameters search_parameters = ivfpq_search_parameters;
+
+            if (search_k > 0) {
+                search_parameters.probed_cells = search_k;
+            }
+
+            return search_closest_vector_value_n_ivfpq(searched_vector, top_n, search_parameters);
+        }
+
+        if (index_backend == IndexBackend::BruteForce) {
+            return search_closest_vector_value_n_brute_force(searched_vector, top_n);
+        }
+
+        return search_closest_vector_value_n_annoy(searched_vector, top_n, search_k);
+    }
+
+    std::vector<VectorDatabase::SearchResult>
+        VectorDatabase::search_closest_vector_value_n_annoy(const Eigen::VectorXf& searched_vector,
+                                                            int top_n, int search_k) const {
         std::vector<int> result_indices;
         std::vector<float> distances;
 
@@ -205,28 +798,148 @@ namespace lc {
         results.reserve(result_indices.size());
 
         for (std::size_t index {0}; index < result_indices.size(); ++index) {
-            const WordVector& word = words.at(result_indices.at(index));
+            const auto word_index = static_cast<std::size_t>(result_indices.at(index));
+
+            results.push_back({words.at(word_index), 1 - distances.at(index), word_index});
+        }
+
+        return results;
+    }
+
+    std::vector<VectorDatabase::SearchResult> VectorDatabase::search_closest_vector_value_n_ivfpq(
+        const Eigen::VectorXf& searched_vector, int top_n,
+        const IVFPQSearchParameters& search_parameters) const {
+        assert(ivfpq_index->is_trained() && "IVF-PQ index must be built before searching it");
+
+        const std::size_t result_count = std::max(top_n, 0);
+        const std::size_t candidate_count =
+            result_count * std::max(search_parameters.rerank_factor, std::size_t {1});
+
+        std::vector<IVFPQIndex::Neighbor> neighbors = ivfpq_index->search(
+            searched_vector.data(), candidate_count, search_parameters.probed_cells);
+
+        if (search_parameters.rerank_factor > 0) {
+            // Replace the quantized distances with exact ones before choosing the top_n
+            for (IVFPQIndex::Neighbor& neighbor: neighbors) {
+                neighbor.squared_distance =
+                    squared_distance(words.vector_data(neighbor.item), searched_vector.data(),
+                                     WordVector::WORD_VECTOR_DIMENSIONS, words.precision());
+            }
+
+            const std::size_t kept_count = std::min(result_count, neighbors.size());
+
+            std::partial_sort(neighbors.begin(), std::next(neighbors.begin(), kept_count),
+                              neighbors.end(),
+                              [](const IVFPQIndex::Neighbor& first,
+                                 const IVFPQIndex::Neighbor& second) {
+                                  return first.squared_distance < second.squared_distance;
+                              });
+
+            neighbors.resize(kept_count);
+        }
+
+        std::vector<SearchResult> results;
+
+        results.reserve(neighbors.size());
+
+        for (const IVFPQIndex::Neighbor& neighbor: neighbors) {
+            const float distance = std::sqrt(std::max(neighbor.squared_distance, 0.0F));
+
+            results.push_back({words.at(neighbor.item), 1 - distance,
+                               static_cast<std::size_t>(neighbor.item)});
+        }
+
+        return results;
+    }
+
+    std::vector<VectorDatabase::SearchResult>
+        VectorDatabase::search_closest_vector_value_n_brute_force(
+            const Eigen::VectorXf& searched_vector, int top_n) const {
+        assert(searched_vector.size() == WordVector::WORD_VECTOR_DIMENSIONS);
+
+        const VectorPrecision precision = words.precision();
+        const std::size_t word_count = words.size();
+
+        std::vector<std::pair<float, std::size_t>> distances;
+
+        distances.reserve(word_count);
+
+        for (std::size_t index {0}; index < word_count; ++index) {
+            const float distance =
+                squared_distance(words.vector_data(index), searched_vector.data(),
+                                 WordVector::WORD_VECTOR_DIMENSIONS, precision);
+
+            distances.emplace_back(distance, index);
+        }
+
+        const std::size_t kept_count =
+            std::min(static_cast<std::size_t>(std::max(top_n, 0)), distances.size());
+
+        std::partial_sort(distances.begin(), std::next(distances.begin(), kept_count),
+                          distances.end());
+
+        std::vector<SearchResult> results;
+
+        results.reserve(kept_count);
+
+        for (std::size_t rank {0}; rank < kept_count; ++rank) {
+            const auto [distance_squared, index] = distances [rank];
 
-            results.push_back({word, 1 - distances.at(index)});
+            results.push_back({words [index], 1 - std::sqrt(distance_squared), index});
         }
 
         return results;
     }
 
     std::optional<WordVector> VectorDatabase::search_from_map(const std::string& word) const {
-        if (!word_map.contains(word)) {
-            return std::nullopt;
+        if (const std::optional<std::size_t> index = words.find(word)) {
+            return words [index.value()];
         }
 
-        return word_map.at(word);
+        return std::nullopt;
     }
 
     std::size_t VectorDatabase::longest_element() const {
-        return std::max_element(words.begin(), words.end(),
-                                [](const WordVector& first_word, const WordVector& second_word) {
-                                    return first_word.word.size() < second_word.word.size();
-                                })
-            ->word.size();
+        return words.longest_word();
+    }
+
+    std::shared_ptr<const VocabularyTrie> VectorDatabase::vocabulary_trie() const {
+        return vocabulary_trie_cache.get(words);
+    }
+
+    VectorDatabase::VocabularyTrieCache::VocabularyTrieCache(const VocabularyTrieCache& other) {
+        *this = other;
+    }
+
+    VectorDatabase::VocabularyTrieCache&
+        VectorDatabase::VocabularyTrieCache::operator=(const VocabularyTrieCache& other) {
+        if (this != &other) {
+            const std::scoped_lock lock {mutex, other.mutex};
+
+            trie = other.trie;
+            generation = other.generation;
+        }
+
+        return *this;
+    }
+
+    std::shared_ptr<const VocabularyTrie>
+        VectorDatabase::VocabularyTrieCache::get(const WordStorage& words) {
+        const std::lock_guard lock {mutex};
+
+        if (!trie || generation != words.generation()) {
+            std::vector<std::string_view> vocabulary;
+            vocabulary.reserve(words.size());
+
+            for (std::size_t index {0}; index < words.size(); ++index) {
+                vocabulary.push_back(words.word(index));
+            }
+
+            trie = std::make_shared<const VocabularyTrie>(vocabulary);
+            generation = words.generation();
+        }
+
+        return trie;
     }
 
     VectorDatabase& VectorDatabase::build_annoy_index(int trees) {
@@ -242,4 +955,46 @@ namespace lc {
 
         return *this;
     }
+
+    VectorDatabase& VectorDatabase::build_phonetic_index() {
+        phonetic_index.clear();
+
+        for (std::size_t index {0}; index < words.size(); ++index) {
+            phonetic_index.add_word(index, words.word(index));
+        }
+
+        phonetic_index_is_built = true;
+
+        return *this;
+    }
+
+    VectorDatabase& VectorDatabase::build_ivfpq_index(const IVFPQIndex::Parameters& parameters) {
+        ivfpq_index = std::make_shared<IVFPQIndex>(WordVector::WORD_VECTOR_DIMENSIONS);
+
+        if (words.precision() == VectorPrecision::Float32) {
+            ivfpq_index->train(words.vectors(), parameters);
+            ivfpq_index->add_items(words.vectors());
+            index_backend = IndexBackend::IVFPQ;
+
+            return *this;
+        }
+
+        Eigen::MatrixXf vectors(WordVector::WORD_VECTOR_DIMENSIONS, words.size());
+
+        widen_vector(words.vector_data(0), vectors.data(), vectors.size(), words.precision());
+
+        ivfpq_index->train(vectors, parameters);
+        ivfpq_index->add_items(vectors);
+        index_backend = IndexBackend::IVFPQ;
+
+        return *this;
+    }
+
+    IVFPQIndex& VectorDatabase::unshared_ivfpq_index() {
+        if (ivfpq_index.use_count() > 1) {
+            ivfpq_index = std::make_shared<IVFPQIndex>(*ivfpq_index);
+        }
+
+        return *ivfpq_index;
+    }
 } // namespace lc
@@ -1,9 +1,18 @@
 #ifndef LEXOCRAFT_VECTOR_DATABASE_HPP
 #define LEXOCRAFT_VECTOR_DATABASE_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <annoy/annoylib.h>
@@ -16,6 +25,12 @@
 #include <cereal/types/vector.hpp>
 
 #include <lexocraft/cereal_eigen.hpp>
+#include <lexocraft/llm/half_precision.hpp>
+#include <lexocraft/llm/ivfpq_index.hpp>
+#include <lexocraft/llm/perfect_hash.hpp>
+#include <lexocraft/llm/phonetic_index.hpp>
+#include <lexocraft/llm/vector_database_file.hpp>
+#include <lexocraft/llm/vocabulary_trie.hpp>
 
 namespace lc {
     class WordVector {
@@ -53,21 +68,182 @@ namespace lc {
         }
     };
 
-    class VectorDatabase {
+    /*
+     Struct-of-arrays vocabulary: every vector in one column-major (WORD_VECTOR_DIMENSIONS x size)
+     matrix and every word in one string arena, addressed by an offset and a length. A scan over
+     the words or over the vectors only touches the array it needs.
+
+     The arrays are either owned or borrowed from a VectorDatabaseFile (mapped or compacted), in
+     which case the first modification copies them into owned float storage.
+
+     Elements are read as WordVector copies, so the container looks like a read-only
+     std::vector<WordVector>.
+    */
+    class WordStorage {
         public:
 
-        /*
-    using RobinMap_t =
-        tsl::robin_map<std::string, WordVector, std::hash<std::string>, std::equal_to<>,
-                       std::allocator<std::pair<std::string, int>>, true>;
-                       */
+        // Transparent so that lookups by std::string_view do not allocate
+        struct WordHash {
+            using is_transparent = void;
+
+            std::size_t operator()(std::string_view word) const {
+                return std::hash<std::string_view> {}(word);
+            }
+        };
+
+        using WordIndex_t = tsl::robin_map<std::string, std::uint32_t, WordHash, std::equal_to<>>;
+
+        class Iterator {
+            public:
+
+            using iterator_category = std::input_iterator_tag;
+            using value_type = WordVector;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = WordVector;
+
+            Iterator(const WordStorage* storage, std::size_t index);
+
+            WordVector operator*() const;
+            Iterator& operator++();
+            Iterator operator++(int);
+            bool operator==(const Iterator& other) const;
+
+            private:
+
+            const WordStorage* storage;
+            std::size_t index;
+        };
+
+        WordStorage() = default;
+        WordStorage(const WordStorage& other);
+        WordStorage(WordStorage&&) = default;
+        WordStorage& operator=(const WordStorage& other);
+        WordStorage& operator=(WordStorage&&) = default;
+
+        explicit WordStorage(const std::vector<WordVector>& words);
+        explicit WordStorage(std::shared_ptr<const VectorDatabaseFile> file);
+
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] bool empty() const;
+        [[nodiscard]] std::size_t longest_word() const;
+        [[nodiscard]] VectorPrecision precision() const;
+        [[nodiscard]] bool is_borrowed() const;
+
+        [[nodiscard]] std::string_view word(std::size_t index) const;
+        [[nodiscard]] const void* vector_data(std::size_t index) const; // precision() elements
+
+        [[nodiscard]] WordVector operator[](std::size_t index) const;
+        [[nodiscard]] WordVector at(std::size_t index) const;
+
+        // Index of the last occurrence of `word`
+        [[nodiscard]] std::optional<std::size_t> find(std::string_view word) const;
+
+        [[nodiscard]] std::span<const char> string_arena() const;
+        [[nodiscard]] std::span<const std::uint32_t> string_offsets() const;
+        [[nodiscard]] std::span<const std::uint16_t> string_lengths() const;
+
+        // Only for float storage
+        [[nodiscard]] Eigen::Map<const Eigen::MatrixXf> vectors() const;
+
+        [[nodiscard]] Iterator begin() const;
+        [[nodiscard]] Iterator end() const;
+
+        // Throws std::length_error when the word doesn't fit the 16 bit lengths or the 32 bit
+        // offsets of the string arena
+        std::size_t push_back(std::string_view word, const float* vector);
+        std::size_t push_back(const WordVector& word);
+        void set_vector(std::size_t index, const float* vector);
+
+        void reserve(std::size_t word_count, std::size_t arena_size = 0);
+        void clear();
+
+        // Copies borrowed arrays into owned float storage
+        WordStorage& materialize();
+
+        // Replaces the lookup map with a minimal perfect hash, the next push_back thaws it again
+        WordStorage& freeze();
+        [[nodiscard]] bool is_frozen() const;
+        [[nodiscard]] const PerfectHash* perfect_hash() const;
+
+        // Unique to the words and vectors: copies share it, and push_back, set_vector and loading
+        // take a new one, so that caches of a vocabulary can be keyed on it
+        [[nodiscard]] std::uint64_t generation() const;
+        // Hash of the words, vectors and precision that is the same in every run, unlike
+        // generation(), for caches of the vocabulary that are saved to files
+        [[nodiscard]] std::uint64_t fingerprint() const;
+
+        template <class Archive>
+        void save(Archive& archive) const {
+            if (is_borrowed()) {
+                WordStorage {*this}.materialize().save(archive);
+
+                return;
+            }
+
+            archive(owned_arena, owned_offsets, owned_lengths, owned_vectors);
+        }
+
+        template <class Archive>
+        void load(Archive& archive) {
+            file = nullptr;
+            frozen_index = nullptr;
+
+            archive(owned_arena, owned_offsets, owned_lengths, owned_vectors);
+
+            rebuild_index();
+            refresh_views();
+            vocabulary_generation = next_generation();
+        }
+
+        private:
+
+        void rebuild_index();
+        void refresh_views();
+
+        static std::uint64_t next_generation();
+
+        std::shared_ptr<const VectorDatabaseFile> file {};
+
+        std::vector<char> owned_arena {};
+        std::vector<std::uint32_t> owned_offsets {};
+        std::vector<std::uint16_t> owned_lengths {};
+        std::vector<float> owned_vectors {};
+        WordIndex_t owned_index {};
+        std::size_t owned_longest_word {};
+        std::shared_ptr<const PerfectHash> frozen_index {}; // Replaces owned_index when set
+        std::uint64_t vocabulary_generation {next_generation()};
+
+        // Views of either the owned or the borrowed arrays
+        std::size_t word_count {};
+        const char* arena_data {};
+        const std::uint32_t* offsets_data {};
+        const std::uint16_t* lengths_data {};
+        const std::byte* vectors_data {};
+        std::size_t vector_stride {WordVector::WORD_VECTOR_DIMENSIONS * sizeof(float)};
+        VectorPrecision vector_precision {VectorPrecision::Float32};
+    };
+
+    class VectorDatabase {
+        public:
 
-        using RobinMap_t = tsl::robin_map<std::string, WordVector>;
         // using ai = Annoy::AnnoyIndex<typename S, typename T, typename Distance, typename Random,
         // class ThreadedBuildPolicy>
         using AnnoyIndex_t = Annoy::AnnoyIndex<int, float, Annoy::Euclidean, Annoy::Kiss64Random,
                                                Annoy::AnnoyIndexSingleThreadedBuildPolicy>;
 
+        // Index used by search_closest_vector_value_n
+        enum class IndexBackend : std::uint8_t {
+            Annoy,
+            IVFPQ,
+            BruteForce, // Exact scan, reads 16-bit vectors without widening them first
+        };
+
+        struct IVFPQSearchParameters {
+            std::size_t probed_cells {16};
+            std::size_t rerank_factor {4}; // Exactly re-ranked candidates per result, 0 disables
+        };
+
         // all default constructors
         VectorDatabase() = default;
         VectorDatabase(const VectorDatabase&) = default;
@@ -77,21 +253,69 @@ namespace lc {
 
         explicit VectorDatabase(const std::vector<WordVector>& words);
 
-        std::vector<WordVector> words {};
-        RobinMap_t word_map {};
+        // One word per line, surrounding whitespace and empty lines are skipped. The file is mapped
+        // and parsed in parallel chunks, each seeded from its text and index, so the random vectors
+        // only depend on the file contents.
+        [[nodiscard]] static VectorDatabase from_plaintext(const std::filesystem::path& filepath,
+                                                           std::size_t threads_count = 0);
+
+        WordStorage words {};
         std::shared_ptr<AnnoyIndex_t> annoy_index {
             std::make_shared<AnnoyIndex_t>(WordVector::WORD_VECTOR_DIMENSIONS)};
         bool annoy_index_is_built {false};
 
+        IndexBackend index_backend {IndexBackend::Annoy};
+        // Shared by copies until one of them changes it
+        std::shared_ptr<IVFPQIndex> ivfpq_index {
+            std::make_shared<IVFPQIndex>(WordVector::WORD_VECTOR_DIMENSIONS)};
+        IVFPQSearchParameters ivfpq_search_parameters {};
+
+        PhoneticIndex phonetic_index {};
+        bool phonetic_index_is_built {false};
+
+        // Trie of the words of one generation. Every copy of the database has its own, which
+        // starts from the trie of the copied one.
+        class VocabularyTrieCache {
+            public:
+
+            VocabularyTrieCache() = default;
+            VocabularyTrieCache(const VocabularyTrieCache& other);
+            VocabularyTrieCache& operator=(const VocabularyTrieCache& other);
+
+            [[nodiscard]] std::shared_ptr<const VocabularyTrie> get(const WordStorage& words);
+
+            private:
+
+            mutable std::mutex mutex;
+            std::shared_ptr<const VocabularyTrie> trie {};
+            std::uint64_t generation {};
+        };
+
+        mutable VocabularyTrieCache vocabulary_trie_cache {};
+
         void add_word(const std::string& word, bool randomize_vector = true);
         void add_word(const WordVector& word, bool replace_existing = true);
 
         void save_file(const std::filesystem::path& filepath) const;
         void load_file(const std::filesystem::path& filepath);
 
+        void save_mapped_file(const std::filesystem::path& filepath,
+                              VectorPrecision precision = VectorPrecision::Float32) const;
+        void save_mapped_file(std::ostream& file, VectorPrecision precision) const;
+        void load_mapped_file(const std::filesystem::path& filepath);
+
+        // Keeps the vectors in memory at `precision` and widens them on access
+        VectorDatabase& compact(VectorPrecision precision = VectorPrecision::Float16);
+
+        // Looks words up through a minimal perfect hash, which save_mapped_file() persists.
+        // Adding a word thaws the vocabulary again.
+        VectorDatabase& freeze();
+
         struct SearchResult {
             WordVector word;
             float similarity;
+            // In the words of the (master) database, a lowercase subdatabase's word may differ
+            std::size_t word_index;
         };
 
         [[nodiscard]] std::vector<SearchResult>
@@ -99,29 +323,64 @@ namespace lc {
                                        float threshold = 0.9F,
                                        bool stop_when_top_n_are_found = true) const;
 
+        // With the IVF-PQ backend a positive search_k overrides the number of probed cells
         [[nodiscard]] std::vector<SearchResult>
             search_closest_vector_value_n(const WordVector& searched_vector, int top_n, int search_k=-1) const;
 
         [[nodiscard]] std::vector<SearchResult>
             search_closest_vector_value_n(const Eigen::VectorXf& searched_vector, int top_n, int search_k=-1) const;
 
+        [[nodiscard]] std::vector<SearchResult>
+            search_closest_vector_value_n_annoy(const Eigen::VectorXf& searched_vector, int top_n,
+                                                int search_k = -1) const;
+
+        [[nodiscard]] std::vector<SearchResult> search_closest_vector_value_n_ivfpq(
+            const Eigen::VectorXf& searched_vector, int top_n,
+            const IVFPQSearchParameters& search_parameters) const;
+
+        [[nodiscard]] std::vector<SearchResult>
+            search_closest_vector_value_n_brute_force(const Eigen::VectorXf& searched_vector,
+                                                      int top_n) const;
+
+        // Scores (soundex_weight * soundex + levenshtein_weight * ratio) / (sum of weights), where
+        // soundex is the fraction of the Soundex code shared with the searched word. Phonetic
+        // buckets are visited from the longest shared code prefix down to the codes of other
+        // first letters and the words without a code, and the search stops once no remaining
+        // bucket can beat the top_n. Needs build_phonetic_index().
+        [[nodiscard]] std::vector<SearchResult>
+            phonetic_search_closest_n(const std::string& searched_word, int top_n,
+                                      float threshold = 0.9F, float soundex_weight = 0.5F,
+                                      float levenshtein_weight = 0.5F) const;
+
         [[nodiscard]] std::optional<WordVector> search_from_map(const std::string& word) const;
 
         [[nodiscard]] std::size_t longest_element() const;
 
+        // Built on first use and rebuilt once the words change
+        [[nodiscard]] std::shared_ptr<const VocabularyTrie> vocabulary_trie() const;
+
         VectorDatabase& build_annoy_index(int trees = 100);
         VectorDatabase& unbuild_annoy_index();
 
+        // Kept up to date by add_word once built
+        VectorDatabase& build_phonetic_index();
+
+        // Trains the IVF-PQ index on every word vector and makes it the search backend
+        VectorDatabase& build_ivfpq_index(const IVFPQIndex::Parameters& parameters = {});
+
         template <class Archive>
         void save(Archive& archive) const {
-            archive(words, annoy_index->serialize());
+            archive(words, annoy_index->serialize(), index_backend, *ivfpq_index);
         }
 
         template <class Archive>
         void load(Archive& archive) {
             std::vector<uint8_t> bytes;
 
-            archive(words, bytes);
+            // A fresh index so that copies sharing the previous one are left untouched
+            ivfpq_index = std::make_shared<IVFPQIndex>(WordVector::WORD_VECTOR_DIMENSIONS);
+
+            archive(words, bytes, index_backend, *ivfpq_index);
 
             if (!annoy_index) {
                 annoy_index = std::make_shared<AnnoyIndex_t>(WordVector::WORD_VECTOR_DIMENSIONS);
@@ -129,12 +388,14 @@ namespace lc {
 
             annoy_index->deserialize(&bytes);
 
-            word_map.clear();
-
-            for (const auto& word: words) {
-                word_map [word.word] = word;
-            }
+            phonetic_index.clear();
+            phonetic_index_is_built = false;
         }
+
+        private:
+
+        // ivfpq_index, copied first when another database shares it
+        IVFPQIndex& unshared_ivfpq_index();
     };
 
     bool add_search_result(std::vector<VectorDatabase::SearchResult>& results,
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cereal/archives/binary.hpp>
+
+#include <lexocraft/hashing.hpp>
+#include <lexocraft/llm/vector_database.hpp>
+#include <lexocraft/llm/vector_database_file.hpp>
+
+namespace lc {
+    namespace {
+        // Read-only streambuf over mapped bytes so cereal can read a section in place
+        class MemoryStreamBuffer : public std::streambuf {
+            public:
+
+            explicit MemoryStreamBuffer(std::span<const std::byte> bytes) {
+                char* const begin = const_cast<char*>(reinterpret_cast<const char*>(bytes.data()));
+                setg(begin, begin, std::next(begin, static_cast<std::ptrdiff_t>(bytes.size())));
+            }
+        };
+
+        constexpr std::size_t align_up(std::size_t value, std::size_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        template <typename T>
+        std::span<const std::byte> as_bytes(const std::vector<T>& values) {
+            return std::as_bytes(std::span<const T> {values});
+        }
+
+        std::filesystem::path annoy_companion_path(const std::filesystem::path& filepath) {
+            std::filesystem::path companion_path {filepath};
+            companion_path += ".annoy";
+
+            return companion_path;
+        }
+    } // namespace
+
+    /********************** VectorDatabaseFile ********************/
+
+    VectorDatabaseFile::VectorDatabaseFile(const std::filesystem::path& filepath) :
+        file {filepath}, image {file.bytes()} {
+        index_sections(filepath.string());
+    }
+
+    VectorDatabaseFile::VectorDatabaseFile(std::vector<std::byte>&& image_bytes) :
+        owned_image {std::move(image_bytes)}, image {owned_image} {
+        index_sections("In-memory vector database");
+    }
+
+    void VectorDatabaseFile::index_sections(const std::string& name) {
+        const std::span<const std::byte> bytes = image;
+
+        if (bytes.size() < sizeof(Header)) {
+            throw std::runtime_error(name + " is not a vector database file");
+        }
+
+        file_header = reinterpret_cast<const Header*>(bytes.data());
+
+        if (file_header->magic != MAGIC) {
+            throw std::runtime_error(name + " is not a vector database file");
+        }
+
+        if (file_header->version != VERSION) {
+            throw std::runtime_error(name + " has unsupported version " +
+                                     std::to_string(file_header->version));
+        }
+
+        if (file_header->vector_precision > static_cast<std::uint32_t>(VectorPrecision::BFloat16)) {
+            throw std::runtime_error(name + " has unknown vector precision " +
+                                     std::to_string(file_header->vector_precision));
+        }
+
+        const std::size_t table_end =
+            sizeof(Header) + file_header->section_count * sizeof(SectionEntry);
+
+        if (bytes.size() < table_end) {
+            throw std::runtime_error(name + " has a truncated section table");
+        }
+
+        for (const SectionEntry& entry: std::span {
+                 reinterpret_cast<const SectionEntry*>(std::next(bytes.data(), sizeof(Header))),
+                 file_header->section_count}) {
+            if (entry.offset > bytes.size() || entry.size > bytes.size() - entry.offset) {
+                throw std::runtime_error(name + " has a truncated section");
+            }
+        }
+
+        const std::size_t word_count = file_header->word_count;
+
+        // Bounds the products below, every word takes at least an offset
+        if (word_count > bytes.size() || file_header->dimensions > bytes.size()) {
+            throw std::runtime_error(name + " has an invalid word count or dimension count");
+        }
+
+        const auto required_section = [&](SectionId id, std::size_t expected_size) {
+            const std::optional<std::span<const std::byte>> maybe_section = section(id);
+
+            if (!maybe_section.has_value() || maybe_section->size() != expected_size) {
+                throw std::runtime_error(name + " is missing section " +
+                                         std::to_string(static_cast<std::uint32_t>(id)));
+            }
+
+            return maybe_section->data();
+        };
+
+        const std::span<const std::byte> arena_bytes =
+            section(SectionId::StringArena).value_or(std::span<const std::byte> {});
+
+        arena = {reinterpret_cast<const char*>(arena_bytes.data()), arena_bytes.size()};
+        offsets = reinterpret_cast<const std::uint32_t*>(
+            required_section(SectionId::StringOffsets, word_count * sizeof(std::uint32_t)));
+        lengths = reinterpret_cast<const std::uint16_t*>(
+            required_section(SectionId::StringLengths, word_count * sizeof(std::uint16_t)));
+        vector_stride = file_header->dimensions * precision_bytes(precision());
+
+        if (vector_stride != 0 && word_count > bytes.size() / vector_stride) {
+            throw std::runtime_error(name + " has a truncated section");
+        }
+
+        vectors = required_section(SectionId::Vectors, word_count * vector_stride);
+
+        // Words are read without bounds checks afterwards
+        for (std::size_t index {0}; index < word_count; ++index) {
+            if (offsets [index] > arena.size() ||
+                lengths [index] > arena.size() - offsets [index]) {
+                throw std::runtime_error(name + " has word " + std::to_string(index) +
+                                         " outside of its string arena");
+            }
+        }
+
+        if (const auto perfect_hash_section = section(SectionId::PerfectHash)) {
+            frozen_index = PerfectHash::from_bytes(perfect_hash_section.value());
+
+            if (frozen_index->size() > word_count || !frozen_index->has_words_below(word_count)) {
+                throw std::runtime_error(name + " has a perfect hash over unknown words");
+            }
+
+            return;
+        }
+
+        const std::size_t slot_count = hash_slot_count(word_count);
+        hash_slots = {reinterpret_cast<const HashSlot*>(
+                          required_section(SectionId::HashIndex, slot_count * sizeof(HashSlot))),
+                      slot_count};
+
+        // An empty slot ends every probe sequence
+        bool has_empty_slot {false};
+
+        for (const HashSlot& slot: hash_slots) {
+            if (slot.word == EMPTY_SLOT) {
+                has_empty_slot = true;
+            }
+
+            else if (slot.word >= word_count) {
+                throw std::runtime_error(name + " has a hash index over unknown words");
+            }
+        }
+
+        if (!has_empty_slot) {
+            throw std::runtime_error(name + " has a full hash index");
+        }
+    }
+
+    const VectorDatabaseFile::Header& VectorDatabaseFile::header() const {
+        return *file_header;
+    }
+
+    std::size_t VectorDatabaseFile::size() const {
+        return file_header->word_count;
+    }
+
+    std::size_t VectorDatabaseFile::longest_word() const {
+        return file_header->longest_word;
+    }
+
+    VectorPrecision VectorDatabaseFile::precision() const {
+        return static_cast<VectorPrecision>(file_header->vector_precision);
+    }
+
+    std::string_view VectorDatabaseFile::word(std::size_t index) const {
+        return {std::next(arena.data(), offsets [index]), lengths [index]};
+    }
+
+    const std::byte* VectorDatabaseFile::vector(std::size_t index) const {
+        return std::next(vectors, static_cast<std::ptrdiff_t>(index * vector_stride));
+    }
+
+    std::span<const char> VectorDatabaseFile::string_arena() const {
+        return arena;
+    }
+
+    std::span<const std::uint32_t> VectorDatabaseFile::string_offsets() const {
+        return {offsets, size()};
+    }
+
+    std::span<const std::uint16_t> VectorDatabaseFile::string_lengths() const {
+        return {lengths, size()};
+    }
+
+    std::optional<std::uint32_t> VectorDatabaseFile::find(std::string_view word) const {
+        if (frozen_index.has_value()) {
+            const std::optional<std::uint32_t> candidate = frozen_index->candidate(word);
+
+            if (candidate.has_value() && this->word(candidate.value()) == word) {
+                return candidate;
+            }
+
+            return std::nullopt;
+        }
+
+        const std::uint64_t hash = stable_hash(word, HASH_SEED);
+        const auto hash_tag = static_cast<std::uint32_t>(hash >> 32U);
+        const std::size_t mask = hash_slots.size() - 1;
+
+        for (std::size_t slot_index = hash & mask;; slot_index = (slot_index + 1) & mask) {
+            const HashSlot& slot = hash_slots [slot_index];
+
+            if (slot.word == EMPTY_SLOT) {
+                return std::nullopt;
+            }
+
+            if (slot.hash_tag == hash_tag && this->word(slot.word) == word) {
+                return slot.word;
+            }
+        }
+    }
+
+    const PerfectHash* VectorDatabaseFile::perfect_hash() const {
+        return frozen_index.has_value() ? &frozen_index.value() : nullptr;
+    }
+
+    std::optional<std::span<const std::byte>> VectorDatabaseFile::section(SectionId id) const {
+        const std::span<const SectionEntry> entries {
+            reinterpret_cast<const SectionEntry*>(std::next(image.data(), sizeof(Header))),
+            file_header->section_count};
+
+        for (const SectionEntry& entry: entries) {
+            if (entry.id == id) {
+                return image.subspan(entry.offset, entry.size);
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::size_t VectorDatabaseFile::hash_slot_count(std::size_t word_count) {
+        // At most half full so that probe sequences stay short
+        return std::bit_ceil(std::max(word_count * 2, std::size_t {2}));
+    }
+
+    /********************** VectorDatabase ********************/
+
+    void VectorDatabase::save_mapped_file(const std::filesystem::path& filepath,
+                                          VectorPrecision precision) const {
+        std::ofstream file {filepath, std::ios::binary};
+
+        save_mapped_file(file, precision);
+
+        file.close();
+
+        if (annoy_index->get_n_trees() > 0) {
+            annoy_index->save(annoy_companion_path(filepath).string().c_str());
+        }
+    }
+
+    void VectorDatabase::save_mapped_file(std::ostream& file, VectorPrecision precision) const {
+        using SectionId = VectorDatabaseFile::SectionId;
+
+        const std::size_t word_count = words.size();
+        constexpr std::size_t dimensions = WordVector::WORD_VECTOR_DIMENSIONS;
+
+        // The string arrays are written as they are, only the vectors may need converting
+        const std::size_t vector_stride = dimensions * precision_bytes(precision);
+        std::vector<std::byte> converted_vectors;
+        std::span<const std::byte> vectors {
+            static_cast<const std::byte*>(words.vector_data(0)), word_count * vector_stride};
+
+        if (words.precision() != precision) {
+            std::array<float, dimensions> widened_vector {};
+            converted_vectors.resize(word_count * vector_stride);
+
+            for (std::size_t index {0}; index < word_count; ++index) {
+                widen_vector(words.vector_data(index), widened_vector.data(), dimensions,
+                             words.precision());
+                std::byte* const converted_vector =
+                    std::next(converted_vectors.data(), index * vector_stride);
+
+                narrow_vector(widened_vector.data(), converted_vector, dimensions, precision);
+            }
+
+            vectors = converted_vectors;
+        }
+
+        // A frozen vocabulary keeps its perfect hash instead of the probing table
+        const PerfectHash* const perfect_hash = words.perfect_hash();
+        std::vector<std::byte> perfect_hash_bytes;
+        std::vector<VectorDatabaseFile::HashSlot> hash_slots;
+
+        if (perfect_hash != nullptr) {
+            perfect_hash_bytes = perfect_hash->to_bytes();
+        }
+
+        else {
+            hash_slots.assign(VectorDatabaseFile::hash_slot_count(word_count),
+                              {VectorDatabaseFile::EMPTY_SLOT, 0});
+            const std::size_t mask = hash_slots.size() - 1;
+
+            for (std::size_t index {0}; index < word_count; ++index) {
+                const std::string_view word = words.word(index);
+                const std::uint64_t hash = stable_hash(word, VectorDatabaseFile::HASH_SEED);
+                const auto hash_tag = static_cast<std::uint32_t>(hash >> 32U);
+                std::size_t slot_index = hash & mask;
+
+                // Like WordStorage::find, a repeated word resolves to its last occurrence
+                while (hash_slots [slot_index].word != VectorDatabaseFile::EMPTY_SLOT &&
+                       !(hash_slots [slot_index].hash_tag == hash_tag &&
+                         words.word(hash_slots [slot_index].word) == word)) {
+                    slot_index = (slot_index + 1) & mask;
+                }
+
+                hash_slots [slot_index] = {static_cast<std::uint32_t>(index), hash_tag};
+            }
+        }
+
+        std::string ivfpq_bytes;
+
+        if (ivfpq_index->is_trained()) {
+            std::ostringstream ivfpq_stream;
+            cereal::BinaryOutputArchive archive {ivfpq_stream};
+            archive(*ivfpq_index);
+            ivfpq_bytes = ivfpq_stream.str();
+        }
+
+        std::vector<std::pair<SectionId, std::span<const std::byte>>> sections {
+            {SectionId::StringArena,   std::as_bytes(words.string_arena())  },
+            {SectionId::StringOffsets, std::as_bytes(words.string_offsets())},
+            {SectionId::StringLengths, std::as_bytes(words.string_lengths())},
+            {SectionId::Vectors,       vectors                              },
+        };
+
+        if (perfect_hash != nullptr) {
+            sections.emplace_back(SectionId::PerfectHash, as_bytes(perfect_hash_bytes));
+        }
+
+        else {
+            sections.emplace_back(SectionId::HashIndex, as_bytes(hash_slots));
+        }
+
+        if (!ivfpq_bytes.empty()) {
+            const std::span<const char> ivfpq_span {ivfpq_bytes.data(), ivfpq_bytes.size()};
+            sections.emplace_back(SectionId::IVFPQIndex, std::as_bytes(ivfpq_span));
+        }
+
+        VectorDatabaseFile::Header header {};
+        header.magic = VectorDatabaseFile::MAGIC;
+        header.version = VectorDatabaseFile::VERSION;
+        header.section_count = sections.size();
+        header.word_count = word_count;
+        header.dimensions = dimensions;
+        header.longest_word = words.longest_word();
+        header.index_backend = static_cast<std::uint32_t>(index_backend);
+        header.vector_precision = static_cast<std::uint32_t>(precision);
+
+        std::vector<VectorDatabaseFile::SectionEntry> entries;
+        std::size_t offset =
+            sizeof(header) + sections.size() * sizeof(VectorDatabaseFile::SectionEntry);
+
+        for (const auto& [id, bytes]: sections) {
+            offset = align_up(offset, VectorDatabaseFile::SECTION_ALIGNMENT);
+            entries.push_back({id, 0, offset, bytes.size()});
+            offset += bytes.size();
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()),
+                   static_cast<std::streamsize>(entries.size() * sizeof(entries.front())));
+
+        std::size_t position = sizeof(header) + entries.size() * sizeof(entries.front());
+        const std::array<char, VectorDatabaseFile::SECTION_ALIGNMENT> padding {};
+
+        for (std::size_t index {0}; index < sections.size(); ++index) {
+            file.write(padding.data(),
+                       static_cast<std::streamsize>(entries [index].offset - position));
+            file.write(reinterpret_cast<const char*>(sections [index].second.data()),
+                       static_cast<std::streamsize>(sections [index].second.size()));
+            position = entries [index].offset + entries [index].size;
+        }
+    }
+
+    void VectorDatabase::load_mapped_file(const std::filesystem::path& filepath) {
+        auto file = std::make_shared<const VectorDatabaseFile>(filepath);
+
+        if (file->header().dimensions != WordVector::WORD_VECTOR_DIMENSIONS) {
+            throw std::runtime_error(filepath.string() + " has " +
+                                     std::to_string(file->header().dimensions) +
+                                     " dimensional word vectors");
+        }
+
+        if (file->header().index_backend >
+            static_cast<std::uint32_t>(IndexBackend::BruteForce)) {
+            throw std::runtime_error(filepath.string() + " has an unknown index backend");
+        }
+
+        auto loaded_ivfpq_index = std::make_shared<IVFPQIndex>(WordVector::WORD_VECTOR_DIMENSIONS);
+
+        if (const auto ivfpq_section = file->section(VectorDatabaseFile::SectionId::IVFPQIndex)) {
+            MemoryStreamBuffer buffer {ivfpq_section.value()};
+            std::istream ivfpq_stream {&buffer};
+            cereal::BinaryInputArchive archive {ivfpq_stream};
+            archive(*loaded_ivfpq_index);
+
+            if (loaded_ivfpq_index->dimensions != WordVector::WORD_VECTOR_DIMENSIONS ||
+                !loaded_ivfpq_index->is_consistent(file->header().word_count)) {
+                throw std::runtime_error(filepath.string() + " has a corrupt IVF-PQ index");
+            }
+        }
+
+        const auto loaded_index_backend = static_cast<IndexBackend>(file->header().index_backend);
+
+        if (loaded_index_backend == IndexBackend::IVFPQ && !loaded_ivfpq_index->is_trained()) {
+            throw std::runtime_error(filepath.string() + " searches an IVF-PQ index it lacks");
+        }
+
+        index_backend = loaded_index_backend;
+        ivfpq_index = std::move(loaded_ivfpq_index);
+
+        // A fresh index so that copies sharing the previous one are left untouched
+        annoy_index = std::make_shared<AnnoyIndex_t>(WordVector::WORD_VECTOR_DIMENSIONS);
+        annoy_index_is_built = false;
+
+        if (const std::filesystem::path annoy_path = annoy_companion_path(filepath);
+            std::filesystem::exists(annoy_path)) {
+            annoy_index_is_built = annoy_index->load(annoy_path.string().c_str());
+        }
+
+        words = WordStorage {std::move(file)};
+
+        phonetic_index.clear();
+        phonetic_index_is_built = false;
+    }
+
+    VectorDatabase& VectorDatabase::compact(VectorPrecision precision) {
+        std::ostringstream stream;
+
+        save_mapped_file(stream, precision);
+
+        const std::string image = std::move(stream).str();
+        std::vector<std::byte> image_bytes(image.size());
+        std::memcpy(image_bytes.data(), image.data(), image.size());
+
+        // The Annoy and IVF-PQ indexes refer to words by position, which is kept
+        words = WordStorage {std::make_shared<const VectorDatabaseFile>(std::move(image_bytes))};
+
+        return *this;
+    }
+} // namespace lc
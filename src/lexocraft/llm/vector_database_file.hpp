@@ -0,0 +1,126 @@
+#ifndef LEXOCRAFT_VECTOR_DATABASE_FILE_HPP
+#define LEXOCRAFT_VECTOR_DATABASE_FILE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lexocraft/llm/half_precision.hpp>
+#include <lexocraft/llm/mapped_file.hpp>
+#include <lexocraft/llm/perfect_hash.hpp>
+
+namespace lc {
+    /*
+     Sectioned VectorDatabase file that is used in place through mmap.
+
+     Layout:
+        Header
+        SectionEntry[section_count]
+        sections, each starting on a SECTION_ALIGNMENT boundary
+
+     Vectors are stored as float, fp16 or bf16 (Header::vector_precision) and are widened by the
+     reader.
+
+     Every array is stored in the native byte order of the writer, so a file is only portable
+     between machines with the same endianness.
+
+     The Annoy trees are kept in a companion "<file>.annoy" file because Annoy can only map a
+     whole file.
+    */
+    class VectorDatabaseFile {
+        public:
+
+        static constexpr std::array<char, 8> MAGIC {'L', 'E', 'X', 'O', 'V', 'D', 'B', '\0'};
+        static constexpr std::uint32_t VERSION {1};
+        static constexpr std::size_t SECTION_ALIGNMENT {64};
+        static constexpr std::uint32_t EMPTY_SLOT {0xFFFFFFFF};
+        static constexpr std::uint64_t HASH_SEED {0x6c65786f63726166ULL};
+
+        enum class SectionId : std::uint32_t {
+            StringArena = 1,   // char[], every word back to back
+            StringOffsets = 2, // std::uint32_t[word_count]
+            StringLengths = 3, // std::uint16_t[word_count]
+            Vectors = 4,       // VectorPrecision[word_count * dimensions]
+            HashIndex = 5,     // HashSlot[power of two], linear probing over stable_hash
+            IVFPQIndex = 6,    // cereal binary IVFPQIndex
+            PerfectHash = 7,   // PerfectHash::to_bytes(), replaces HashIndex in frozen files
+        };
+
+        struct Header {
+            std::array<char, 8> magic;
+            std::uint32_t version;
+            std::uint32_t section_count;
+            std::uint64_t word_count;
+            std::uint64_t dimensions;
+            std::uint64_t longest_word;
+            std::uint32_t index_backend;
+            std::uint32_t vector_precision; // VectorPrecision, 0 (float) in files without it
+        };
+
+        struct SectionEntry {
+            SectionId id;
+            std::uint32_t reserved;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        struct HashSlot {
+            std::uint32_t word;     // EMPTY_SLOT when unused
+            std::uint32_t hash_tag; // High half of the hash, rejects most mismatches
+        };
+
+        VectorDatabaseFile() = default;
+
+        explicit VectorDatabaseFile(const std::filesystem::path& filepath);
+
+        // Uses an image held in memory instead of a mapped file
+        explicit VectorDatabaseFile(std::vector<std::byte>&& image_bytes);
+
+        [[nodiscard]] const Header& header() const;
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] std::size_t longest_word() const;
+        [[nodiscard]] VectorPrecision precision() const;
+
+        [[nodiscard]] std::string_view word(std::size_t index) const;
+        // Points to `dimensions` elements of precision()
+        [[nodiscard]] const std::byte* vector(std::size_t index) const;
+
+        [[nodiscard]] std::span<const char> string_arena() const;
+        [[nodiscard]] std::span<const std::uint32_t> string_offsets() const;
+        [[nodiscard]] std::span<const std::uint16_t> string_lengths() const;
+
+        [[nodiscard]] std::optional<std::uint32_t> find(std::string_view word) const;
+
+        // Only in files of a frozen vocabulary
+        [[nodiscard]] const PerfectHash* perfect_hash() const;
+
+        [[nodiscard]] std::optional<std::span<const std::byte>> section(SectionId id) const;
+
+        static std::size_t hash_slot_count(std::size_t word_count);
+
+        private:
+
+        void index_sections(const std::string& name);
+
+        MappedFile file;
+        std::vector<std::byte> owned_image {};
+        std::span<const std::byte> image {};
+
+        const Header* file_header {};
+        std::span<const char> arena {};
+        const std::uint32_t* offsets {};
+        const std::uint16_t* lengths {};
+        const std::byte* vectors {};
+        std::size_t vector_stride {}; // Bytes per vector
+        std::span<const HashSlot> hash_slots {};
+        std::optional<PerfectHash> frozen_index {};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_VECTOR_DATABASE_FILE_HPP
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <rapidfuzz/fuzz.hpp>
+
+#include <lexocraft/llm/half_precision.hpp>
+#include <lexocraft/llm/vector_subdatabase.hpp>
+
+namespace lc {
+    namespace {
+        void assign_lowercase(std::string& lowercase_word, std::string_view word) {
+            lowercase_word.clear();
+
+            std::transform(word.begin(), word.end(), std::back_inserter(lowercase_word),
+                           [](char letter) { return std::tolower(letter); });
+        }
+    } // namespace
+
+    VectorSubdatabase::VectorSubdatabase(std::shared_ptr<const VectorDatabase> master,
+                                         bool lowercase) :
+        master {std::move(master)}, lowercase {lowercase} {
+    }
+
+    void VectorSubdatabase::add_master_word(std::size_t master_index) {
+        assert(master && "Subdatabase has no master database");
+
+        // Annoy can't add to a built index, unbuild it and leave the rebuild to the caller
+        if (annoy_index_is_built) {
+            unbuild_annoy_index();
+            annoy_index_is_dirty = true;
+        }
+
+        const std::string added_word = word_at_master(master_index);
+        const auto existing_position = word_map.find(added_word);
+        std::size_t position = master_indices.size();
+
+        if (existing_position != word_map.end()) {
+            position = existing_position->second;
+            master_indices [position] = master_index;
+        }
+
+        else {
+            master_indices.push_back(master_index);
+            word_map [added_word] = position;
+        }
+
+        const WordVector master_word = master->words [master_index];
+        annoy_index->add_item(static_cast<int>(position), master_word.data());
+    }
+
+    void VectorSubdatabase::add_master_words(const std::vector<std::size_t>& master_indices) {
+        this->master_indices.reserve(this->master_indices.size() + master_indices.size());
+        word_map.reserve(word_map.size() + master_indices.size());
+
+        for (const std::size_t master_index: master_indices) {
+            add_master_word(master_index);
+        }
+    }
+
+    VectorSubdatabase& VectorSubdatabase::attach(std::shared_ptr<const VectorDatabase> master) {
+        this->master = std::move(master);
+
+        word_map.clear();
+        word_map.reserve(master_indices.size());
+
+        for (std::size_t position {0}; position < master_indices.size(); ++position) {
+            word_map [word(position)] = position;
+        }
+
+        if (!annoy_index_is_built) {
+            for (std::size_t position {0}; position < master_indices.size(); ++position) {
+                const WordVector master_word = this->master->words [master_indices [position]];
+                annoy_index->add_item(static_cast<int>(position), master_word.data());
+            }
+        }
+
+        return *this;
+    }
+
+    std::size_t VectorSubdatabase::size() const {
+        return master_indices.size();
+    }
+
+    bool VectorSubdatabase::empty() const {
+        return master_indices.empty();
+    }
+
+    std::string VectorSubdatabase::word(std::size_t index) const {
+        return word_at_master(master_indices [index]);
+    }
+
+    WordVector VectorSubdatabase::at(std::size_t index) const {
+        if (index >= master_indices.size()) {
+            throw std::out_of_range("VectorSubdatabase::at index " + std::to_string(index) +
+                                    " is out of range for size " +
+                                    std::to_string(master_indices.size()));
+        }
+
+        WordVector word_vector = master->words [master_indices [index]];
+
+        if (lowercase) {
+            word_vector.word = word(index);
+        }
+
+        return word_vector;
+    }
+
+    std::vector<VectorSubdatabase::SearchResult>
+        VectorSubdatabase::rapidfuzz_search_closest_n(const std::string& searched_word, int top_n,
+                                                      float threshold,
+                                                      bool stop_when_top_n_are_found) const {
+        std::vector<SearchResult> results;
+
+        results.reserve(top_n);
+
+        float lowest_similarity_in_top_n = 0.0F;
+        std::string lowercase_word;
+
+        for (std::size_t index {0}; index < master_indices.size(); ++index) {
+            std::string_view candidate = master->words.word(master_indices [index]);
+
+            if (lowercase) {
+                assign_lowercase(lowercase_word, candidate);
+                candidate = lowercase_word;
+            }
+
+            const float similarity = rapidfuzz::fuzz::ratio(searched_word, candidate) / 100.0F;
+
+            if (similarity < threshold) {
+                continue;
+            }
+
+            const bool was_added =
+                add_search_result(results, {at(index), similarity, master_indices [index]}, top_n,
+                                  lowest_similarity_in_top_n);
+
+            if (was_added && results.size() == static_cast<std::size_t>(top_n) &&
+                stop_when_top_n_are_found) {
+                break;
+            }
+        }
+
+        return results;
+    }
+
+    std::vector<float>
+        VectorSubdatabase::rapidfuzz_similarities(const std::string& searched_word) const {
+        const rapidfuzz::fuzz::CachedRatio<char> scorer {searched_word};
+
+        std::vector<float> similarities;
+        similarities.reserve(master_indices.size());
+
+        std::string lowercase_word;
+
+        for (const std::uint32_t master_index: master_indices) {
+            std::string_view candidate = master->words.word(master_index);
+
+            if (lowercase) {
+                assign_lowercase(lowercase_word, candidate);
+                candidate = lowercase_word;
+            }
+
+            // Same value as rapidfuzz::fuzz::ratio(searched_word, candidate) / 100.0F
+            similarities.push_back(static_cast<float>(scorer.similarity(candidate) / 100.0F));
+        }
+
+        return similarities;
+    }
+
+    std::vector<VectorSubdatabase::SearchResult>
+        VectorSubdatabase::rapidfuzz_search_closest_n(std::span<const float> similarities,
+                                                      int top_n, float threshold,
+                                                      bool stop_when_top_n_are_found) const {
+        assert(similarities.size() == master_indices.size());
+
+        std::vector<SearchResult> results;
+
+        results.reserve(top_n);
+
+        float lowest_similarity_in_top_n = 0.0F;
+
+        for (std::size_t index {0}; index < similarities.size(); ++index) {
+            const float similarity = similarities [index];
+
+            if (similarity < threshold) {
+                continue;
+            }
+
+            const bool was_added =
+                add_search_result(results, {at(index), similarity, master_indices [index]}, top_n,
+                                  lowest_similarity_in_top_n);
+
+            if (was_added && results.size() == static_cast<std::size_t>(top_n) &&
+                stop_when_top_n_are_found) {
+                break;
+            }
+        }
+
+        return results;
+    }
+
+    std::vector<VectorSubdatabase::SearchResult>
+        VectorSubdatabase::search_closest_vector_value_n(const Eigen::VectorXf& searched_vector,
+                                                         int top_n, int search_k) const {
+        if (!annoy_index_is_built) {
+            return search_closest_vector_value_n_brute_force(searched_vector, top_n);
+        }
+
+        std::vector<int> result_indices;
+        std::vector<float> distances;
+
+        annoy_index->get_nns_by_vector(searched_vector.data(), top_n, search_k, &result_indices,
+                                       &distances);
+
+        std::vector<SearchResult> results;
+
+        results.reserve(result_indices.size());
+
+        for (std::size_t index {0}; index < result_indices.size(); ++index) {
+            const auto subdatabase_index = static_cast<std::size_t>(result_indices.at(index));
+
+            results.push_back({at(subdatabase_index), 1 - distances.at(index),
+                               master_indices.at(subdatabase_index)});
+        }
+
+        return results;
+    }
+
+    std::vector<VectorSubdatabase::SearchResult>
+        VectorSubdatabase::search_closest_vector_value_n_brute_force(
+            const Eigen::VectorXf& searched_vector, int top_n) const {
+        assert(searched_vector.size() == WordVector::WORD_VECTOR_DIMENSIONS);
+
+        const VectorPrecision precision = master->words.precision();
+
+        std::vector<std::pair<float, std::size_t>> distances;
+
+        distances.reserve(master_indices.size());
+
+        for (std::size_t index {0}; index < master_indices.size(); ++index) {
+            const float distance =
+                squared_distance(master->words.vector_data(master_indices [index]),
+                                 searched_vector.data(), WordVector::WORD_VECTOR_DIMENSIONS,
+                                 precision);
+
+            distances.emplace_back(distance, index);
+        }
+
+        const std::size_t kept_count =
+            std::min(static_cast<std::size_t>(std::max(top_n, 0)), distances.size());
+
+        std::partial_sort(distances.begin(), std::next(distances.begin(), kept_count),
+                          distances.end());
+
+        std::vector<SearchResult> results;
+
+        results.reserve(kept_count);
+
+        for (std::size_t rank {0}; rank < kept_count; ++rank) {
+            const auto [distance_squared, index] = distances [rank];
+
+            results.push_back(
+                {at(index), 1 - std::sqrt(distance_squared), master_indices [index]});
+        }
+
+        return results;
+    }
+
+    std::optional<WordVector> VectorSubdatabase::search_from_map(const std::string& word) const {
+        const auto position = word_map.find(word);
+
+        if (position == word_map.end()) {
+            return std::nullopt;
+        }
+
+        return at(position->second);
+    }
+
+    std::optional<std::size_t> VectorSubdatabase::find_master_index(std::string_view word) const {
+        const auto position = word_map.find(word);
+
+        if (position == word_map.end()) {
+            return std::nullopt;
+        }
+
+        return master_indices [position->second];
+    }
+
+    std::size_t VectorSubdatabase::longest_element() const {
+        std::size_t longest {0};
+
+        for (const std::uint32_t master_index: master_indices) {
+            longest = std::max(longest, master->words.word(master_index).size());
+        }
+
+        return longest;
+    }
+
+    VectorSubdatabase& VectorSubdatabase::build_annoy_index(int trees) {
+        annoy_index->build(trees);
+        annoy_index_is_built = true;
+        annoy_index_is_dirty = false;
+        annoy_index_trees = trees;
+
+        return *this;
+    }
+
+    VectorSubdatabase& VectorSubdatabase::unbuild_annoy_index() {
+        annoy_index->unbuild();
+        annoy_index_is_built = false;
+
+        return *this;
+    }
+
+    VectorSubdatabase& VectorSubdatabase::rebuild_dirty_annoy_index() {
+        if (annoy_index_is_dirty) {
+            build_annoy_index(annoy_index_trees);
+        }
+
+        return *this;
+    }
+
+    std::string VectorSubdatabase::word_at_master(std::size_t master_index) const {
+        const std::string_view master_word = master->words.word(master_index);
+
+        if (!lowercase) {
+            return std::string {master_word};
+        }
+
+        std::string lowercase_word;
+        assign_lowercase(lowercase_word, master_word);
+
+        return lowercase_word;
+    }
+} // namespace lc
@@ -0,0 +1,134 @@
+#ifndef LEXOCRAFT_VECTOR_SUBDATABASE_HPP
+#define LEXOCRAFT_VECTOR_SUBDATABASE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include <cereal/types/vector.hpp>
+
+#include <lexocraft/llm/vector_database.hpp>
+
+namespace lc {
+    /*
+     Subset of a master VectorDatabase stored as indices into its WordStorage. Only the lookup map
+     and the Annoy index belong to the subdatabase, words and vectors are read from the master.
+
+     A lowercase subdatabase looks words up by their lowercase spelling and returns them
+     lowercased, with the vector of the master word.
+
+     The master is not serialized, attach() has to be called again after loading.
+    */
+    class VectorSubdatabase {
+        public:
+
+        using AnnoyIndex_t = VectorDatabase::AnnoyIndex_t;
+        using SearchResult = VectorDatabase::SearchResult;
+
+        VectorSubdatabase() = default;
+        VectorSubdatabase(const VectorSubdatabase&) = default;
+        VectorSubdatabase(VectorSubdatabase&&) = default;
+        VectorSubdatabase& operator=(const VectorSubdatabase&) = default;
+        VectorSubdatabase& operator=(VectorSubdatabase&&) = default;
+
+        explicit VectorSubdatabase(std::shared_ptr<const VectorDatabase> master,
+                                   bool lowercase = false);
+
+        std::shared_ptr<const VectorDatabase> master {};
+        std::vector<std::uint32_t> master_indices {};
+        bool lowercase {false};
+
+        WordStorage::WordIndex_t word_map {}; // Word to position in master_indices
+        std::shared_ptr<AnnoyIndex_t> annoy_index {
+            std::make_shared<AnnoyIndex_t>(WordVector::WORD_VECTOR_DIMENSIONS)};
+        bool annoy_index_is_built {false};
+
+        // Set when an add invalidated a built Annoy index, rebuilt with the same tree count
+        bool annoy_index_is_dirty {false};
+        int annoy_index_trees {100};
+
+        // Adds a master word, a word that is already present takes the new vector
+        void add_master_word(std::size_t master_index);
+        void add_master_words(const std::vector<std::size_t>& master_indices);
+
+        // Points at a (re)loaded master and rebuilds the lookup map. Annoy only saves built
+        // indexes, so an unbuilt one gets its items again from the master.
+        VectorSubdatabase& attach(std::shared_ptr<const VectorDatabase> master);
+
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] bool empty() const;
+
+        [[nodiscard]] std::string word(std::size_t index) const;
+        [[nodiscard]] WordVector at(std::size_t index) const;
+
+        [[nodiscard]] std::vector<SearchResult>
+            rapidfuzz_search_closest_n(const std::string& searched_word, int top_n,
+                                       float threshold = 0.9F,
+                                       bool stop_when_top_n_are_found = true) const;
+
+        // Rapidfuzz ratio / 100 of every word to the searched word, in one pass
+        [[nodiscard]] std::vector<float>
+            rapidfuzz_similarities(const std::string& searched_word) const;
+
+        // Same results as searching for the word the similarities were computed for, without
+        // scoring the words again for every threshold
+        [[nodiscard]] std::vector<SearchResult>
+            rapidfuzz_search_closest_n(std::span<const float> similarities, int top_n,
+                                       float threshold = 0.9F,
+                                       bool stop_when_top_n_are_found = true) const;
+
+        // Scans the words exactly while the Annoy index isn't built, or is dirty
+        [[nodiscard]] std::vector<SearchResult>
+            search_closest_vector_value_n(const Eigen::VectorXf& searched_vector, int top_n,
+                                          int search_k = -1) const;
+        [[nodiscard]] std::vector<SearchResult>
+            search_closest_vector_value_n_brute_force(const Eigen::VectorXf& searched_vector,
+                                                      int top_n) const;
+
+        [[nodiscard]] std::optional<WordVector> search_from_map(const std::string& word) const;
+        // Index of the word in the master, found without copying it
+        [[nodiscard]] std::optional<std::size_t> find_master_index(std::string_view word) const;
+
+        [[nodiscard]] std::size_t longest_element() const;
+
+        VectorSubdatabase& build_annoy_index(int trees = 100);
+        VectorSubdatabase& unbuild_annoy_index();
+        VectorSubdatabase& rebuild_dirty_annoy_index();
+
+        template <class Archive>
+        void save(Archive& archive) const {
+            archive(master_indices, lowercase, annoy_index->serialize(), annoy_index_is_built,
+                    annoy_index_is_dirty, annoy_index_trees);
+        }
+
+        template <class Archive>
+        void load(Archive& archive) {
+            std::vector<uint8_t> bytes;
+
+            archive(master_indices, lowercase, bytes, annoy_index_is_built, annoy_index_is_dirty,
+                    annoy_index_trees);
+
+            if (!annoy_index) {
+                annoy_index = std::make_shared<AnnoyIndex_t>(WordVector::WORD_VECTOR_DIMENSIONS);
+            }
+
+            annoy_index->deserialize(&bytes);
+
+            master = nullptr;
+            word_map.clear();
+        }
+
+        private:
+
+        [[nodiscard]] std::string word_at_master(std::size_t master_index) const;
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_VECTOR_SUBDATABASE_HPP
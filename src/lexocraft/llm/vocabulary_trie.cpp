@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <lexocraft/llm/vocabulary_trie.hpp>
+
+namespace lc {
+    namespace {
+        constexpr std::int32_t FREE {-1};
+        constexpr std::int32_t NONE {-1};
+        constexpr std::size_t MINIMUM_GROWTH {1024};
+
+        // A free position that failed to fit this many states leaves the free list, it can still
+        // hold a child that isn't the first one
+        constexpr std::uint8_t MAX_FAILURES {16};
+
+        /*
+         Places the states so that no two children of any state collide. Free positions form a
+         linked list, so the search for a base skips the occupied positions of the arrays.
+        */
+        class TrieBuilder {
+            public:
+
+            std::vector<std::int32_t> base {0};
+            std::vector<std::int32_t> check {0};
+            std::vector<std::uint32_t> state_words {VocabularyTrie::NO_WORD};
+
+            std::int32_t place(std::int32_t parent, const std::vector<std::int32_t>& codes) {
+                const std::int32_t child_base = find_base(codes);
+
+                base [parent] = child_base;
+
+                for (const std::int32_t code: codes) {
+                    occupy(child_base + code);
+                    check [child_base + code] = parent;
+                }
+
+                return child_base;
+            }
+
+            private:
+
+            void grow(std::size_t minimum_size) {
+                const std::size_t old_size = check.size();
+
+                if (minimum_size <= old_size) {
+                    return;
+                }
+
+                const std::size_t new_size =
+                    std::max({minimum_size, old_size * 2, old_size + MINIMUM_GROWTH});
+
+                if (new_size > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+                    throw std::runtime_error("Vocabulary is too large for a trie");
+                }
+
+                base.resize(new_size, 0);
+                check.resize(new_size, FREE);
+                state_words.resize(new_size, VocabularyTrie::NO_WORD);
+                failures.resize(new_size, 0);
+                next_free.resize(new_size, NONE);
+                previous_free.resize(new_size, NONE);
+
+                for (std::size_t position {old_size}; position < new_size; ++position) {
+                    const auto free_position = static_cast<std::int32_t>(position);
+
+                    previous_free [position] = last_free;
+
+                    if (last_free != NONE) {
+                        next_free [last_free] = free_position;
+                    }
+
+                    last_free = free_position;
+                }
+
+                if (search_start == NONE) {
+                    search_start = static_cast<std::int32_t>(old_size);
+                }
+            }
+
+            void occupy(std::int32_t position) {
+                if (failures [position] < MAX_FAILURES) {
+                    unlink(position);
+                }
+            }
+
+            void unlink(std::int32_t position) {
+                const std::int32_t previous = previous_free [position];
+                const std::int32_t next = next_free [position];
+
+                if (position == search_start) {
+                    search_start = next;
+                }
+
+                if (previous != NONE) {
+                    next_free [previous] = next;
+                }
+
+                if (next == NONE) {
+                    last_free = previous;
+                } else {
+                    previous_free [next] = previous;
+                }
+            }
+
+            bool fits(std::int32_t child_base, const std::vector<std::int32_t>& codes) {
+                grow(static_cast<std::size_t>(child_base + codes.back()) + 1);
+
+                return std::all_of(codes.begin(), codes.end(),
+                                   [this, child_base](std::int32_t code) {
+                                       return check [child_base + code] == FREE;
+                                   });
+            }
+
+            // `codes` is sorted and not empty
+            std::int32_t find_base(const std::vector<std::int32_t>& codes) {
+                std::int32_t position = search_start;
+
+                while (true) {
+                    if (position == NONE) {
+                        position = static_cast<std::int32_t>(check.size());
+                        grow(check.size() + 1);
+                    }
+
+                    const std::int32_t child_base = position - codes.front();
+
+                    if (child_base >= 0 && fits(child_base, codes)) {
+                        return child_base;
+                    }
+
+                    const std::int32_t next = next_free [position];
+
+                    if (++failures [position] == MAX_FAILURES) {
+                        unlink(position);
+                    }
+
+                    position = next;
+                }
+            }
+
+            std::vector<std::int32_t> next_free {NONE};
+            std::vector<std::int32_t> previous_free {NONE};
+            std::vector<std::uint8_t> failures {0};
+            std::int32_t search_start {NONE};
+            std::int32_t last_free {NONE};
+        };
+
+        // Sorted words in [begin, end) that share their first `depth` bytes
+        struct PendingState {
+            std::int32_t state;
+            std::size_t begin;
+            std::size_t end;
+            std::size_t depth;
+        };
+    } // namespace
+
+    VocabularyTrie::VocabularyTrie(const std::vector<std::string_view>& words) {
+        std::vector<std::pair<std::string_view, std::uint32_t>> sorted_words;
+        sorted_words.reserve(words.size());
+
+        for (std::size_t index {0}; index < words.size(); ++index) {
+            if (!words [index].empty()) {
+                sorted_words.emplace_back(words [index], static_cast<std::uint32_t>(index));
+            }
+        }
+
+        std::sort(sorted_words.begin(), sorted_words.end());
+
+        // Equal words sort by index, the last of them is kept
+        const auto last_of_equal_words =
+            std::unique(sorted_words.rbegin(), sorted_words.rend(),
+                        [](const auto& first, const auto& second) {
+                            return first.first == second.first;
+                        });
+        sorted_words.erase(sorted_words.begin(), last_of_equal_words.base());
+
+        word_count = sorted_words.size();
+
+        for (const auto& [word, index]: sorted_words) {
+            for (const char letter: word) {
+                word_bytes.set(static_cast<unsigned char>(letter));
+            }
+        }
+
+        if (sorted_words.empty()) {
+            return;
+        }
+
+        TrieBuilder builder;
+        std::deque<PendingState> pending {{0, 0, sorted_words.size(), 0}};
+        std::vector<std::int32_t> codes;
+
+        while (!pending.empty()) {
+            const PendingState current = pending.front();
+            pending.pop_front();
+
+            std::size_t index = current.begin;
+
+            // Sorted words that end here come before every longer word with the same prefix
+            if (sorted_words [index].first.size() == current.depth) {
+                builder.state_words [current.state] = sorted_words [index].second;
+                ++index;
+            }
+
+            if (index == current.end) {
+                continue;
+            }
+
+            codes.clear();
+
+            for (std::size_t word {index}; word < current.end; ++word) {
+                const std::int32_t code = code_of(sorted_words [word].first [current.depth]);
+
+                if (codes.empty() || codes.back() != code) {
+                    codes.push_back(code);
+                }
+            }
+
+            const std::int32_t child_base = builder.place(current.state, codes);
+
+            for (const std::int32_t code: codes) {
+                const std::size_t begin = index;
+
+                while (index < current.end &&
+                       code_of(sorted_words [index].first [current.depth]) == code) {
+                    ++index;
+                }
+
+                pending.push_back({child_base + code, begin, index, current.depth + 1});
+            }
+        }
+
+        base = std::move(builder.base);
+        check = std::move(builder.check);
+        state_words = std::move(builder.state_words);
+    }
+
+    bool VocabularyTrie::contains_byte(char letter) const {
+        return word_bytes.test(static_cast<unsigned char>(letter));
+    }
+
+    std::size_t VocabularyTrie::size() const {
+        return word_count;
+    }
+
+    std::size_t VocabularyTrie::state_count() const {
+        return static_cast<std::size_t>(
+            std::count_if(check.begin(), check.end(), [](std::int32_t parent) {
+                return parent != FREE;
+            }));
+    }
+} // namespace lc
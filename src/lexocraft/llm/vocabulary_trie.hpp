@@ -0,0 +1,76 @@
+#ifndef LEXOCRAFT_VOCABULARY_TRIE_HPP
+#define LEXOCRAFT_VOCABULARY_TRIE_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace lc {
+    /*
+     Double-array trie over the bytes of every vocabulary word. The child of state s on byte c is
+     base[s] + c + 1 when check[that child] == s, so a walk costs two array reads per byte and
+     never allocates. A state that ends a word stores the word's index.
+    */
+    class VocabularyTrie {
+        public:
+
+        static constexpr std::uint32_t NO_WORD {0xFFFFFFFF};
+
+        struct Match {
+            std::size_t length; // 0 when nothing matched
+            std::uint32_t word;
+        };
+
+        VocabularyTrie() = default;
+
+        // Words are indexed by their position, a repeated word keeps its last index like the
+        // WordStorage map does. Empty words are ignored.
+        explicit VocabularyTrie(const std::vector<std::string_view>& words);
+
+        // Longest word that is a prefix of `text` and for which `can_end(length)` holds
+        template <typename Predicate>
+        [[nodiscard]] Match longest_match(std::string_view text, Predicate&& can_end) const {
+            Match longest {0, NO_WORD};
+            std::int32_t state {0};
+
+            for (std::size_t length {1}; length <= text.size(); ++length) {
+                const std::int32_t next_state = base [state] + code_of(text [length - 1]);
+
+                if (static_cast<std::size_t>(next_state) >= check.size() ||
+                    check [next_state] != state) {
+                    break;
+                }
+
+                state = next_state;
+
+                if (state_words [state] != NO_WORD && can_end(length)) {
+                    longest = {length, state_words [state]};
+                }
+            }
+
+            return longest;
+        }
+
+        // Whether any word contains `letter`
+        [[nodiscard]] bool contains_byte(char letter) const;
+
+        [[nodiscard]] std::size_t size() const; // Distinct words
+        [[nodiscard]] std::size_t state_count() const;
+
+        private:
+
+        static std::int32_t code_of(char letter) {
+            return static_cast<std::int32_t>(static_cast<unsigned char>(letter)) + 1;
+        }
+
+        std::vector<std::int32_t> base {0};
+        std::vector<std::int32_t> check {0};
+        std::vector<std::uint32_t> state_words {NO_WORD};
+        std::bitset<256> word_bytes {};
+        std::size_t word_count {};
+    };
+} // namespace lc
+
+#endif // LEXOCRAFT_VOCABULARY_TRIE_HPP
@@ -1,10 +1,14 @@
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <string_view>
 #include <vector>
 
 #include <cereal/cereal.hpp>
 
+#include <lexocraft/hashing.hpp>
 #include <lexocraft/neural_network/neural_network.hpp>
 
 namespace lc {
@@ -35,6 +39,52 @@ namespace lc {
         return input;
     }
 
+    Eigen::MatrixXf NeuralNetwork::compute_batch(Eigen::MatrixXf inputs) const {
+        for (std::size_t index {0}; index < weights.size(); ++index) {
+            inputs = (weights [index] * inputs).colwise() + biases [index];
+            inputs = inputs.unaryExpr([](float value) { return sigmoid_abs(value); });
+        }
+
+        return inputs;
+    }
+
+    Eigen::Ref<const Eigen::VectorXf>
+        NeuralNetwork::compute_into(const Eigen::Ref<const Eigen::VectorXf>& input,
+                                    ComputeBuffers& buffers) const {
+        if (weights.empty()) {
+            return input;
+        }
+
+        // Both buffers fit the largest layer, so they are only allocated once
+        const Eigen::Index largest_layer_size =
+            static_cast<Eigen::Index>(*std::max_element(layer_sizes.begin(), layer_sizes.end()));
+
+        for (Eigen::VectorXf& layer: buffers.layers) {
+            if (layer.size() < largest_layer_size) {
+                layer.resize(largest_layer_size);
+            }
+        }
+
+        for (std::size_t index {0}; index < weights.size(); ++index) {
+            Eigen::VectorXf& next_layer = buffers.layers [index % 2];
+            const Eigen::Index size = weights [index].rows();
+
+            if (index == 0) {
+                next_layer.head(size).noalias() = weights [index] * input;
+            } else {
+                const Eigen::VectorXf& layer = buffers.layers [(index - 1) % 2];
+                next_layer.head(size).noalias() =
+                    weights [index] * layer.head(weights [index].cols());
+            }
+
+            next_layer.head(size) += biases [index];
+            next_layer.head(size) =
+                next_layer.head(size).unaryExpr([](float value) { return sigmoid_abs(value); });
+        }
+
+        return buffers.layers [(weights.size() - 1) % 2].head(weights.back().rows());
+    }
+
     NeuralNetwork::NeuralNetworkDiff NeuralNetwork::random_diff() const noexcept {
         return NeuralNetworkDiff(layer_sizes);
     }
@@ -51,6 +101,8 @@ namespace lc {
         for (auto& bias: biases) {
             bias = Eigen::VectorXf::Random(bias.rows());
         }
+
+        mark_modified();
     }
 
     void NeuralNetwork::modify(NeuralNetwork::NeuralNetworkDiff diff, bool apply_biases,
@@ -66,6 +118,8 @@ namespace lc {
                 weights [index] += diff.weight_diffs [index];
             }
         }
+
+        mark_modified();
     }
 
     /* Example usage:
@@ -106,6 +160,39 @@ namespace lc {
         }
     }
 
+    void NeuralNetwork::mark_modified() {
+        version = next_version();
+    }
+
+    std::uint64_t NeuralNetwork::next_version() {
+        static std::atomic<std::uint64_t> last_version {0};
+
+        return ++last_version;
+    }
+
+    std::uint64_t NeuralNetwork::fingerprint() const {
+        const auto bytes_of = [](const float* data, Eigen::Index size) {
+            return std::string_view {reinterpret_cast<const char*>(data),
+                                     static_cast<std::size_t>(size) * sizeof(float)};
+        };
+
+        std::uint64_t hash {0};
+
+        for (const std::size_t layer_size: layer_sizes) {
+            hash = mix_hash(hash ^ layer_size);
+        }
+
+        for (const Eigen::MatrixXf& weight: weights) {
+            hash = stable_hash(bytes_of(weight.data(), weight.size()), hash);
+        }
+
+        for (const Eigen::VectorXf& bias: biases) {
+            hash = stable_hash(bytes_of(bias.data(), bias.size()), hash);
+        }
+
+        return hash;
+    }
+
     void NeuralNetwork::save_file(const std::filesystem::path& filepath) const {
         std::ofstream file {filepath};
 
@@ -1,6 +1,7 @@
 #ifndef LEXOCRAFT_NEURAL_NETWORK_HPP
 #define LEXOCRAFT_NEURAL_NETWORK_HPP
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
@@ -56,6 +57,11 @@ namespace lc {
             }
         };
 
+        // Layer values of compute_into(), reused so that computing doesn't allocate
+        struct ComputeBuffers {
+            std::array<Eigen::VectorXf, 2> layers;
+        };
+
         constexpr static float GOOD_COST {0.1F};
         constexpr static std::size_t FIELD_COUNT {7};
 
@@ -69,6 +75,10 @@ namespace lc {
         float most_recent_cost {};
         std::size_t diff_improvement_streak {};
 
+        // Unique to the weights: copies share it, and randomize(), modify() and loading take a
+        // new one. Code writing weights or biases directly has to call mark_modified().
+        std::uint64_t version {next_version()};
+
         NeuralNetwork() = default;
         NeuralNetwork(NeuralNetwork&& other) noexcept = default;
         NeuralNetwork(const NeuralNetwork& other) noexcept = default;
@@ -82,9 +92,18 @@ namespace lc {
         void modify(NeuralNetworkDiff diff, bool apply_biases = true, bool apply_weights = true);
 
         void train(float cost);
+        void mark_modified();
 
         [[nodiscard]] Eigen::VectorXf compute(Eigen::VectorXf input) const noexcept;
+        // One input per column, every layer is a single matrix product for the whole batch
+        [[nodiscard]] Eigen::MatrixXf compute_batch(Eigen::MatrixXf inputs) const;
+        // Same as compute(), the output is a view into `buffers` until they are used again
+        [[nodiscard]] Eigen::Ref<const Eigen::VectorXf>
+            compute_into(const Eigen::Ref<const Eigen::VectorXf>& input,
+                         ComputeBuffers& buffers) const;
         [[nodiscard]] NeuralNetworkDiff random_diff() const noexcept;
+        // Hash of the layer sizes, weights and biases that is the same in every run
+        [[nodiscard]] std::uint64_t fingerprint() const;
 
         void save_file(const std::filesystem::path& filepath) const;
 
@@ -92,10 +111,18 @@ namespace lc {
         void serialize(Archive& archive) {
             archive(iterations, layer_sizes, weights, biases, most_recent_diff, most_recent_cost,
                     diff_improvement_streak);
+
+            if constexpr (Archive::is_loading::value) {
+                mark_modified();
+            }
         }
 
         static NeuralNetwork load_file(const std::filesystem::path& filepath);
         static float sigmoid_abs(float value);
+
+        private:
+
+        static std::uint64_t next_version();
     };
 } // namespace lc
 
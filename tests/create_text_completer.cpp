@@ -16,13 +16,6 @@
 #include <lexocraft/llm/text_completion.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
-std::string remove_whitespace(std::string str) {
-    str.erase(str.begin(), std::find_if_not(str.begin(), str.end(), ::isspace));
-    str.erase(std::find_if_not(str.rbegin(), str.rend(), ::isspace).base(), str.end());
-
-    return str;
-}
-
 int main(const int argc, const char** argv) {
     std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
 
@@ -44,19 +37,10 @@ int main(const int argc, const char** argv) {
 
     if (vector_database_type == "plaintext") {
         std::cout << "Creating a plaintext vector database\n";
-        std::ifstream vector_database_file {vector_database_path};
-        std::vector<lc::WordVector> word_vectors {};
-        std::string line {};
-
-        IC();
         std::cout << "Reading word vectors from plaintext file: " << vector_database_path << "\n";
-        while (std::getline(vector_database_file, line)) {
-            word_vectors.emplace_back(remove_whitespace(line));
-        }
-
-        std::cout << "Read " << word_vectors.size() << " word vectors\n";
+        vector_database.emplace(lc::VectorDatabase::from_plaintext(vector_database_path));
 
-        vector_database.emplace(std::move(word_vectors));
+        std::cout << "Read " << vector_database->words.size() << " word vectors\n";
 
         std::cout << "Building Annoy index\n";
         const auto result =
@@ -100,7 +84,7 @@ int main(const int argc, const char** argv) {
     text_completer.set_ephemeral_memory_accumulator_layer_sizes(trinary_layer_size_vector_generator,
                                                                 10);
 
-    std::vector<std::pair<std::string, std::shared_ptr<lc::VectorDatabase>>>
+    std::vector<std::pair<std::string, std::shared_ptr<lc::VectorSubdatabase>>>
         vector_subdatabase_pairs {
             {"alphanumeric",           text_completer.alphanumeric_vector_subdatabase          },
             {"digit",                  text_completer.digit_vector_subdatabase                 },
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nanobench.h>
+
+#include <lexocraft/llm/vector_database.hpp>
+
+namespace {
+    std::vector<int> exact_nearest(const lc::VectorDatabase& database, const Eigen::VectorXf& query,
+                                   std::size_t top_n) {
+        std::vector<std::pair<float, int>> distances;
+
+        distances.reserve(database.words.size());
+
+        for (std::size_t index {0}; index < database.words.size(); ++index) {
+            distances.emplace_back((database.words [index].vector - query).squaredNorm(), index);
+        }
+
+        std::partial_sort(distances.begin(), std::next(distances.begin(), top_n), distances.end());
+
+        std::vector<int> nearest;
+
+        for (std::size_t index {0}; index < top_n; ++index) {
+            nearest.push_back(distances [index].second);
+        }
+
+        return nearest;
+    }
+
+    float recall(const std::vector<lc::VectorDatabase::SearchResult>& results,
+                 const std::vector<int>& expected, const lc::VectorDatabase& database) {
+        std::size_t found {};
+
+        for (const int index: expected) {
+            const std::string& word = database.words [index].word;
+
+            found += std::any_of(results.begin(), results.end(),
+                                 [&word](const lc::VectorDatabase::SearchResult& result) {
+                                     return result.word.word == word;
+                                 });
+        }
+
+        return static_cast<float>(found) / static_cast<float>(expected.size());
+    }
+} // namespace
+
+int main(const int argc, const char** argv) {
+    std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
+
+    std::cout << "args: " << args.size() << "\n";
+
+    for (std::size_t index = 0; index < args.size(); ++index) {
+        std::cout << "arg[" << index << "]: " << args [index] << "\n";
+    }
+
+    if (args.empty()) {
+        std::cout << "Usage: <database> OPTIONAL: <coarse_cells> <subquantizers> <probed_cells> "
+                     "<rerank_factor> <queries> <top_n>\n";
+
+        return 1;
+    }
+
+    const std::string database_path = args.at(0);
+
+    lc::IVFPQIndex::Parameters parameters {};
+    parameters.coarse_cells = args.size() > 1 ? std::stoul(args.at(1)) : 1024;
+    parameters.subquantizers = args.size() > 2 ? std::stoul(args.at(2)) : 8;
+
+    lc::VectorDatabase::IVFPQSearchParameters search_parameters {};
+    search_parameters.probed_cells = args.size() > 3 ? std::stoul(args.at(3)) : 16;
+    search_parameters.rerank_factor = args.size() > 4 ? std::stoul(args.at(4)) : 4;
+
+    const std::size_t query_count = args.size() > 5 ? std::stoul(args.at(5)) : 200;
+    const int top_n = args.size() > 6 ? std::stoi(args.at(6)) : 10;
+
+    lc::VectorDatabase database;
+
+    std::cout << "Loading database from " << database_path << "\n";
+    database.load_file(database_path);
+    std::cout << "Loaded " << database.words.size() << " word vectors\n";
+
+    if (!database.annoy_index_is_built) {
+        std::cout << "Building Annoy index\n";
+        database.build_annoy_index(10);
+    }
+
+    std::cout << "Building IVF-PQ index (" << parameters.coarse_cells << " cells, "
+              << parameters.subquantizers << " byte codes)\n";
+
+    ankerl::nanobench::Bench()
+        .timeUnit(std::chrono::milliseconds {1}, "ms")
+        .epochs(1)
+        .epochIterations(1)
+        .run("build_ivfpq_index", [&] { database.build_ivfpq_index(parameters); });
+
+    // Queries are perturbed database vectors so that they have meaningful neighbors
+    std::mt19937 generator {0};
+    std::uniform_int_distribution<std::size_t> random_word {0, database.words.size() - 1};
+    std::normal_distribution<float> noise {0.0F, 0.05F};
+    std::vector<Eigen::VectorXf> queries;
+
+    for (std::size_t query {0}; query < query_count; ++query) {
+        Eigen::VectorXf vector = database.words [random_word(generator)].vector;
+        vector = vector.unaryExpr([&](float value) { return value + noise(generator); });
+        queries.push_back(vector);
+    }
+
+    std::vector<std::vector<int>> expected;
+
+    for (const Eigen::VectorXf& query: queries) {
+        expected.push_back(exact_nearest(database, query, top_n));
+    }
+
+    float annoy_recall {};
+    float ivfpq_recall {};
+
+    for (std::size_t query {0}; query < query_count; ++query) {
+        annoy_recall +=
+            recall(database.search_closest_vector_value_n_annoy(queries [query], top_n),
+                   expected [query], database);
+        ivfpq_recall += recall(database.search_closest_vector_value_n_ivfpq(queries [query], top_n,
+                                                                            search_parameters),
+                               expected [query], database);
+    }
+
+    std::size_t query_index {};
+
+    ankerl::nanobench::Bench bench;
+    bench.title("nearest word vector search").unit("query").minEpochIterations(query_count);
+
+    bench.run("annoy", [&] {
+        ankerl::nanobench::doNotOptimizeAway(database.search_closest_vector_value_n_annoy(
+            queries [query_index++ % query_count], top_n));
+    });
+
+    bench.run("ivfpq", [&] {
+        ankerl::nanobench::doNotOptimizeAway(database.search_closest_vector_value_n_ivfpq(
+            queries [query_index++ % query_count], top_n, search_parameters));
+    });
+
+    const std::size_t raw_vector_bytes =
+        database.words.size() * lc::WordVector::WORD_VECTOR_DIMENSIONS * sizeof(float);
+
+    std::cout << "Recall@" << top_n << " annoy: " << annoy_recall / query_count << "\n";
+    std::cout << "Recall@" << top_n << " ivfpq: " << ivfpq_recall / query_count << "\n";
+    std::cout << "Memory raw vectors: " << raw_vector_bytes << " bytes\n";
+    std::cout << "Memory annoy: " << database.annoy_index->serialize().size() << " bytes\n";
+    std::cout << "Memory ivfpq: " << database.ivfpq_index->memory_usage() << " bytes\n";
+
+    // Words added to a copy stay out of the index of the original
+    const std::size_t indexed_count = database.ivfpq_index->size();
+    lc::VectorDatabase copied_database {database};
+
+    copied_database.add_word("copied word that is nowhere else", true);
+
+    if (database.ivfpq_index->size() != indexed_count ||
+        copied_database.ivfpq_index->size() != indexed_count + 1) {
+        std::cout << "Adding a word to a copy changed the IVF-PQ index of the original\n";
+
+        return 1;
+    }
+
+    // A replaced vector is indexed by its new value
+    const lc::WordVector replaced_word {database.words [0].word,
+                                        lc::WordVector::Vector_t {-database.words [1].vector}};
+    copied_database.add_word(replaced_word, true);
+
+    const std::vector<lc::VectorDatabase::SearchResult> replaced_results =
+        copied_database.search_closest_vector_value_n_ivfpq(replaced_word.vector, 1,
+                                                            search_parameters);
+
+    if (copied_database.ivfpq_index->size() != indexed_count + 1 || replaced_results.empty() ||
+        replaced_results.front().word.word != replaced_word.word) {
+        std::cout << "The IVF-PQ index kept the replaced vector\n";
+
+        return 1;
+    }
+}
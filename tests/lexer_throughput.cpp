@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nanobench.h>
+
+#include <lexocraft/llm/character_classes.hpp>
+#include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/vector_database.hpp>
+
+int main(const int argc, const char** argv) {
+    std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
+
+    std::cout << "args: " << args.size() << "\n";
+
+    for (std::size_t index = 0; index < args.size(); ++index) {
+        std::cout << "arg[" << index << "]: " << args [index] << "\n";
+    }
+
+    if (args.size() < 2) {
+        std::cout << "Usage: <plaintext database> <text>\n";
+
+        return 1;
+    }
+
+    const std::string database_path = args.at(0);
+    const std::string text_path = args.at(1);
+
+    // ------------------------- Classification -------------------------
+
+    std::string every_byte;
+
+    for (std::size_t byte {0}; byte < 256; ++byte) {
+        every_byte.push_back(static_cast<char>(byte));
+    }
+
+    for (std::size_t index {0}; index < every_byte.size(); ++index) {
+        const lc::grammar::BlockClasses block = lc::grammar::classify_block(every_byte, index);
+        const char letter = every_byte [index];
+
+        if ((block.letters & 1U) != static_cast<std::uint64_t>(lc::grammar::is_letter(letter)) ||
+            (block.digits & 1U) != static_cast<std::uint64_t>(lc::grammar::is_digit(letter)) ||
+            (block.spaces & 1U) != static_cast<std::uint64_t>(letter == ' ')) {
+            std::cout << "classify_block disagrees with the class table on byte " << index << "\n";
+
+            return 1;
+        }
+    }
+
+    // ------------------------- Throughput -------------------------
+
+    const lc::VectorDatabase database = lc::VectorDatabase::from_plaintext(database_path);
+    std::cout << "Loaded " << database.words.size() << " words\n";
+
+    const std::ifstream file {text_path};
+    std::stringstream file_contents_buffer;
+    file_contents_buffer << file.rdbuf();
+    const std::string file_contents {file_contents_buffer.str()};
+
+    std::cout << "Read " << file_contents.size() << " bytes from " << text_path << "\n";
+
+    // Built outside of the measurements
+    static_cast<void>(database.vocabulary_trie());
+
+    ankerl::nanobench::Bench bench;
+    bench.title("lexer").unit("byte").batch(file_contents.size()).minEpochIterations(3);
+
+    bench.run("classify_block", [&] {
+        std::uint64_t letters {0};
+
+        for (std::size_t index {0}; index < file_contents.size();
+             index += lc::grammar::BlockClasses::SIZE) {
+            letters += lc::grammar::classify_block(file_contents, index).letters;
+        }
+
+        ankerl::nanobench::doNotOptimizeAway(letters);
+    });
+
+    bench.run("token_type", [&] {
+        std::size_t alphanumeric {0};
+
+        for (std::size_t index {0}; index + 8 <= file_contents.size(); index += 8) {
+            alphanumeric += static_cast<std::size_t>(
+                lc::grammar::token_type(std::string_view {file_contents}.substr(index, 8)) ==
+                lc::grammar::Token::Type::Alphanumeric);
+        }
+
+        ankerl::nanobench::doNotOptimizeAway(alphanumeric);
+    });
+
+    bench.run("tokenize", [&] {
+        ankerl::nanobench::doNotOptimizeAway(lc::grammar::tokenize(file_contents, database));
+    });
+
+    bench.run("tokenize_compact", [&] {
+        ankerl::nanobench::doNotOptimizeAway(
+            lc::grammar::tokenize_compact(file_contents, database));
+    });
+}
@@ -66,4 +66,15 @@ int main(int argc, char** argv) {
               << " nanoseconds\n";
 
     std::cout << "output.size(): " << output.size() << "\n";
+
+    // Buffers reused by compute_into() must give the same output as compute()
+    lc::NeuralNetwork::ComputeBuffers buffers;
+
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        if (neural_network.compute_into(input, buffers) != output) {
+            std::cout << "compute_into() differs from compute()\n";
+
+            return 1;
+        }
+    }
 }
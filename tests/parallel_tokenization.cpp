@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nanobench.h>
+
+#include <lexocraft/llm/lexer.hpp>
+#include <lexocraft/llm/vector_database.hpp>
+
+namespace {
+    bool same_tokens(const std::vector<lc::grammar::Token>& first,
+                     const std::vector<lc::grammar::Token>& second) {
+        return std::equal(first.begin(), first.end(), second.begin(), second.end(),
+                          [](const lc::grammar::Token& left, const lc::grammar::Token& right) {
+                              return left.value == right.value && left.type == right.type &&
+                                     left.next_is_space == right.next_is_space;
+                          });
+    }
+} // namespace
+
+int main(const int argc, const char** argv) {
+    std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
+
+    std::cout << "args: " << args.size() << "\n";
+
+    for (std::size_t index = 0; index < args.size(); ++index) {
+        std::cout << "arg[" << index << "]: " << args [index] << "\n";
+    }
+
+    if (args.size() < 3) {
+        std::cout << "Usage: <plaintext|binary> <database> <text, e.g. "
+                     "assets/wikipedia/combined.txt> OPTIONAL: <max_threads>\n";
+
+        return 1;
+    }
+
+    const std::string database_type = args.at(0);
+    const std::string database_path = args.at(1);
+    const std::string text_path = args.at(2);
+    const std::size_t max_threads =
+        args.size() > 3 ? std::stoul(args.at(3)) : std::thread::hardware_concurrency();
+
+    lc::VectorDatabase database;
+
+    std::cout << "Loading database from " << database_path << "\n";
+
+    if (database_type == "plaintext") {
+        database = lc::VectorDatabase::from_plaintext(database_path);
+    } else {
+        database.load_file(database_path);
+    }
+
+    std::cout << "Loaded " << database.words.size() << " words\n";
+
+    const std::ifstream file {text_path};
+    std::stringstream file_contents_buffer;
+    file_contents_buffer << file.rdbuf();
+    const std::string file_contents {file_contents_buffer.str()};
+
+    std::cout << "Read " << file_contents.size() << " bytes from " << text_path << "\n";
+
+    const std::vector<lc::grammar::Token> serial_tokens =
+        lc::grammar::tokenize(file_contents, database);
+
+    std::cout << "Serial tokens: " << serial_tokens.size() << "\n";
+
+    ankerl::nanobench::Bench bench;
+    bench.title("tokenization").timeUnit(std::chrono::milliseconds {1}, "ms").epochs(3);
+    bench.relative(true);
+
+    bench.run("tokenize", [&] {
+        ankerl::nanobench::doNotOptimizeAway(lc::grammar::tokenize(file_contents, database));
+    });
+
+    for (std::size_t threads {1}; threads <= max_threads; threads *= 2) {
+        const std::vector<lc::grammar::Token> parallel_tokens =
+            lc::grammar::tokenize_parallel(file_contents, database, threads);
+
+        if (!same_tokens(serial_tokens, parallel_tokens)) {
+            std::cout << "tokenize_parallel with " << threads
+                      << " threads differs from tokenize\n";
+
+            return 1;
+        }
+
+        bench.run("tokenize_parallel(threads=" + std::to_string(threads) + ")", [&] {
+            ankerl::nanobench::doNotOptimizeAway(
+                lc::grammar::tokenize_parallel(file_contents, database, threads));
+        });
+    }
+
+    std::cout << "Parallel tokens match the serial tokens\n";
+}
@@ -1,13 +1,119 @@
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <ratio>
+#include <span>
 #include <sstream>
+#include <string_view>
 
 #include <lexocraft/llm/lexer.hpp>
 #include <lexocraft/llm/text_completion.hpp>
+#include <lexocraft/llm/text_statistics.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
+namespace {
+    // Per-sentence formulas TextStatistics has to reproduce
+    std::size_t count_sentence_terminators(const std::vector<lc::grammar::Token>& tokens) {
+        return std::count_if(tokens.begin(), tokens.end(), [](const lc::grammar::Token& token) {
+            return token.value == "." || token.value == "!" || token.value == "?";
+        });
+    }
+
+    float expected_sentence_length_mean(const std::vector<lc::grammar::Token>& tokens) {
+        return static_cast<float>(tokens.size()) /
+               static_cast<float>(std::max(std::size_t {1}, count_sentence_terminators(tokens)));
+    }
+
+    float expected_sentence_length_stddev(const std::vector<lc::grammar::Token>& tokens) {
+        std::vector<std::size_t> sentence_lengths;
+        std::size_t current_sentence_length {0};
+
+        for (const lc::grammar::Token& token: tokens) {
+            if (token.value == ".") {
+                sentence_lengths.push_back(current_sentence_length);
+                current_sentence_length = 0;
+            } else {
+                ++current_sentence_length;
+            }
+        }
+
+        if (current_sentence_length > 0) {
+            sentence_lengths.push_back(current_sentence_length);
+        }
+
+        if (sentence_lengths.empty()) {
+            return 0.0F;
+        }
+
+        const float mean = expected_sentence_length_mean(tokens);
+        float squared_deviation_sum {0.0F};
+
+        for (const std::size_t length: sentence_lengths) {
+            const float deviation = static_cast<float>(length) - mean;
+            squared_deviation_sum += deviation * deviation;
+        }
+
+        return std::sqrt(squared_deviation_sum / static_cast<float>(sentence_lengths.size()));
+    }
+
+    float expected_flesch_kincaid_level(const std::string& text) {
+        std::vector<std::string> words;
+        std::size_t sentence_count {0};
+        std::size_t start {0};
+
+        // Every sentence, the one after the last terminator included, starts with an empty word
+        while (start <= text.size()) {
+            const std::size_t end = std::min(text.find_first_of(".!?", start), text.size());
+            words.emplace_back("");
+
+            for (const char letter: std::string_view {text}.substr(start, end + 1 - start)) {
+                if (std::isalnum(static_cast<unsigned char>(letter)) != 0) {
+                    words.back() += letter;
+                } else if (!words.back().empty()) {
+                    words.emplace_back("");
+                }
+            }
+
+            ++sentence_count;
+            start = end + 1;
+        }
+
+        std::size_t syllables {0};
+
+        for (const std::string& word: words) {
+            if (!word.ends_with("e")) {
+                syllables += std::count_if(word.begin(), word.end(), [](char letter) {
+                    return std::string_view {"aeiouyAEIOUY"}.find(letter) != std::string::npos;
+                });
+            }
+        }
+
+        const float average_sentence_length =
+            static_cast<float>(words.size()) /
+            static_cast<float>(std::max(std::size_t {1}, sentence_count - 1));
+        const float average_syllables_per_word =
+            static_cast<float>(syllables) / static_cast<float>(words.size());
+
+        return static_cast<float>(0.39 * average_sentence_length +
+                                  11.8 * average_syllables_per_word - 15.59);
+    }
+
+    bool is_close(float value, float expected) {
+        return std::abs(value - expected) <= 1e-4F * std::max(1.0F, std::abs(expected));
+    }
+
+    bool are_same_statistics(const lc::TextStatistics& statistics,
+                             const lc::TextStatistics& expected) {
+        return is_close(statistics.sentence_count(), expected.sentence_count()) &&
+               is_close(statistics.sentence_length_mean(), expected.sentence_length_mean()) &&
+               is_close(statistics.sentence_length_stddev(), expected.sentence_length_stddev()) &&
+               is_close(statistics.flesch_kincaid_level(), expected.flesch_kincaid_level());
+    }
+} // namespace
+
 int main(int argc, char** argv) {
     std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
 
@@ -56,6 +162,103 @@ int main(int argc, char** argv) {
 
     std::cout << "]\n";
 
+    std::ifstream streamed_file {filepath};
+    lc::grammar::TokenStream token_stream {streamed_file, database, 4096};
+    std::size_t streamed_tokens {0};
+
+    for (const lc::grammar::Token& token: token_stream) {
+        const lc::grammar::Token& expected = result.at(streamed_tokens++);
+
+        if (token.value != expected.value || token.type != expected.type ||
+            token.next_is_space != expected.next_is_space) {
+            std::cout << "Streamed token " << token << " differs from " << expected << "\n";
+
+            return 1;
+        }
+    }
+
+    if (streamed_tokens != result.size()) {
+        std::cout << "Streamed " << streamed_tokens << " tokens instead of " << result.size()
+                  << "\n";
+
+        return 1;
+    }
+
+    // Each copy of a database tokenizes with its own words, after changes of any size
+    static_cast<void>(database.vocabulary_trie());
+
+    lc::VectorDatabase first_copy {database};
+    lc::VectorDatabase second_copy {database};
+
+    first_copy.add_word("zyxwvu", true);
+    second_copy.add_word("qvzxqv", true);
+
+    const auto is_vocabulary_word = [](const std::string& word,
+                                       const lc::VectorDatabase& vector_database) {
+        const std::vector<lc::grammar::Token> tokens = lc::grammar::tokenize(word, vector_database);
+
+        return tokens.size() == 1 && tokens.front().has_vocabulary_id() &&
+               vector_database.words.word(tokens.front().vocabulary_id) == word;
+    };
+
+    if (!is_vocabulary_word("zyxwvu", first_copy) || is_vocabulary_word("qvzxqv", first_copy) ||
+        !is_vocabulary_word("qvzxqv", second_copy) || is_vocabulary_word("zyxwvu", second_copy)) {
+        std::cout << "A copy tokenized with the words of another copy\n";
+
+        return 1;
+    }
+
+    // Same word count, other words
+    first_copy.words = second_copy.words;
+
+    if (!is_vocabulary_word("qvzxqv", first_copy) || is_vocabulary_word("zyxwvu", first_copy)) {
+        std::cout << "Reassigned words were tokenized with the previous ones\n";
+
+        return 1;
+    }
+
+    // One pass gives the per-sentence statistics, and parts of any size merge into the whole
+    lc::TextStatistics statistics {};
+    statistics.add(result);
+
+    lc::TextStatistics character_statistics {};
+    character_statistics.add_characters(file_contents);
+
+    if (!is_close(statistics.sentence_count(),
+                  static_cast<float>(count_sentence_terminators(result))) ||
+        !is_close(statistics.sentence_length_mean(), expected_sentence_length_mean(result)) ||
+        !is_close(statistics.sentence_length_stddev(), expected_sentence_length_stddev(result)) ||
+        !is_close(character_statistics.flesch_kincaid_level(),
+                  expected_flesch_kincaid_level(file_contents))) {
+        std::cout << "Text statistics differ from the per-sentence formulas\n";
+
+        return 1;
+    }
+
+    for (const std::size_t part_size: {1, 2, 3, 7, 64}) {
+        lc::TextStatistics merged_statistics {};
+        lc::TextStatistics merged_character_statistics {};
+
+        for (std::size_t start {0}; start < result.size(); start += part_size) {
+            merged_statistics.merge(lc::TextStatistics {}.add(
+                std::span {result}.subspan(start, std::min(part_size, result.size() - start))));
+        }
+
+        for (std::size_t start {0}; start < file_contents.size(); start += part_size) {
+            merged_character_statistics.merge(lc::TextStatistics {}.add_characters(
+                std::string_view {file_contents}.substr(start, part_size)));
+        }
+
+        if (!are_same_statistics(merged_statistics, statistics) ||
+            !is_close(merged_character_statistics.flesch_kincaid_level(),
+                      character_statistics.flesch_kincaid_level())) {
+            std::cout << "Statistics merged from parts of " << part_size
+                      << " differ from the whole\n";
+
+            return 1;
+        }
+    }
+
     std::cout << "Sentence mean: " << lc::sentence_length_mean(result) << "\n";
     std::cout << "Sentence stddev: " << lc::sentence_length_stddev(result) << "\n";
 }
@@ -1,10 +1,47 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <ios>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <lexocraft/fancy_eigen_print.hpp>
+#include <lexocraft/llm/completion_scheduler.hpp>
+#include <lexocraft/llm/completion_session.hpp>
+#include <lexocraft/llm/prefix_cache.hpp>
+#include <lexocraft/llm/session_snapshot.hpp>
 #include <lexocraft/llm/text_completion.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
+namespace {
+    // Small random networks, enough to compare ways of running them
+    std::shared_ptr<const lc::TextCompleter> random_model(const std::string& database_path) {
+        lc::VectorDatabase database {};
+
+        database.load_file(database_path);
+
+        lc::TextCompleter completer {std::move(database), 100, 50};
+        completer.create_vector_subdatabases();
+
+        completer.set_ephemeral_memory_accmulator_nn(
+            {completer.ephemeral_memory_fields_sizes.total(), 100,
+             completer.ephemeral_memory_output_sizes.total()},
+            true);
+        completer.set_context_builder_nn({completer.context_builder_fields_sizes.total(), 100,
+                                          completer.context_builder_output_sizes.total()},
+                                         true);
+        completer.set_word_vector_improviser_nn(
+            {completer.word_vector_improviser_fields_sizes.total(), 100,
+             completer.word_vector_improviser_output_sizes.total()},
+            true);
+
+        return std::make_shared<const lc::TextCompleter>(std::move(completer));
+    }
+} // namespace
+
 int main(int argc, char** argv) {
     std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
     std::cout << std::boolalpha;
@@ -85,8 +122,10 @@ int main(int argc, char** argv) {
         std::cout << "completer.context_builder.biases[0]: "
                   << lc::fancy_eigen_vector_str(completer.context_builder.biases [0]) << "\n";
 
-        // completer.ephemeral_memory = Eigen::VectorXf::Random(completer.ephemeral_memory.size());
-        // completer.context_memory = Eigen::VectorXf::Random(completer.context_memory.size());
+        // completer.session.ephemeral_memory =
+        //     Eigen::VectorXf::Random(completer.session.ephemeral_memory.size());
+        // completer.session.context_memory =
+        //     Eigen::VectorXf::Random(completer.session.context_memory.size());
 
         std::cout << "Context builder NN set\n";
 
@@ -100,6 +139,581 @@ int main(int argc, char** argv) {
         std::cout << "Context memory accumulated\n";
 
         std::cout << "Context memory quantity: "
-                  << lc::fancy_eigen_vector_str(completer.context_memory) << "\n";
+                  << lc::fancy_eigen_vector_str(completer.session.context_memory) << "\n";
+    }
+
+    if (action == "sessions") {
+        const std::string database_path = args.at(1);
+        const std::string text = args.at(2);
+        const std::size_t session_count = args.size() > 3 ? std::stoul(args.at(3)) : 8;
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+        const std::vector<lc::grammar::Token> tokens =
+            lc::grammar::tokenize(text, *model->vector_database);
+
+        // Sessions that took the same tokens end with the same memories, however they ran
+        const auto run_session = [&](lc::CompletionSession& session) {
+            for (const lc::grammar::Token& token: tokens) {
+                static_cast<void>(session.predict_next_token_value(token));
+            }
+
+            session.start_new_section();
+        };
+
+        lc::CompletionSession expected_session {model};
+        run_session(expected_session);
+
+        std::vector<lc::CompletionSession> sessions(session_count, lc::CompletionSession {model});
+        std::vector<std::thread> threads;
+
+        for (lc::CompletionSession& session: sessions) {
+            threads.emplace_back([&] { run_session(session); });
+        }
+
+        for (std::thread& thread: threads) {
+            thread.join();
+        }
+
+        for (const lc::CompletionSession& session: sessions) {
+            if (session.state.ephemeral_memory != expected_session.state.ephemeral_memory ||
+                session.state.context_memory != expected_session.state.context_memory) {
+                std::cout << "Concurrent sessions diverged\n";
+
+                return 1;
+            }
+        }
+
+        std::cout << sessions.size() << " sessions shared one model over " << tokens.size()
+                  << " tokens\n";
+    }
+
+    if (action == "vocabulary ids") {
+        const std::string database_path = args.at(1);
+        const std::string text = args.at(2);
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+        const lc::WordStorage& words = model->vector_database->words;
+
+        // The same words at other indices
+        lc::VectorDatabase reversed_database;
+
+        for (std::size_t index {words.size()}; index > 0; --index) {
+            reversed_database.add_word(words [index - 1], false);
+        }
+
+        std::vector<lc::grammar::Token> foreign_tokens =
+            lc::grammar::tokenize(text, reversed_database);
+        foreign_tokens.front().vocabulary_id = std::numeric_limits<std::uint32_t>::max() - 1;
+
+        lc::CompletionSession expected_session {model};
+        lc::CompletionSession session {model};
+
+        for (const lc::grammar::Token& token:
+             lc::grammar::tokenize(text, *model->vector_database)) {
+            static_cast<void>(expected_session.predict_next_token_value(token));
+        }
+
+        for (const lc::grammar::Token& token: foreign_tokens) {
+            static_cast<void>(session.predict_next_token_value(token));
+        }
+
+        if (session.state.ephemeral_memory != expected_session.state.ephemeral_memory ||
+            session.state.context_memory != expected_session.state.context_memory) {
+            std::cout << "Tokens of another database were read with the wrong words\n";
+
+            return 1;
+        }
+
+        // Views read the same vectors as copies, in place for words of a float vocabulary
+        lc::TextCompleter compact_model = *model;
+        compact_model.vector_database =
+            std::make_shared<lc::VectorDatabase>(*model->vector_database);
+        compact_model.vector_database->compact();
+        compact_model.create_vector_subdatabases();
+
+        std::vector<lc::grammar::Token> viewed_tokens = foreign_tokens;
+        viewed_tokens.push_back({text + "qzx", lc::grammar::Token::Type::Alphanumeric, true});
+
+        for (const lc::TextCompleter* viewing_model:
+             std::initializer_list<const lc::TextCompleter*> {model.get(), &compact_model}) {
+            const lc::WordStorage& viewed_words = viewing_model->vector_database->words;
+            lc::TextCompleter::SessionState state = viewing_model->new_session_state();
+
+            for (const lc::grammar::Token& token: viewed_tokens) {
+                const auto [word_vector, type] = viewing_model->find_word_vector(token);
+                const lc::TextCompleter::WordVectorView view =
+                    viewing_model->find_word_vector(state, token);
+                const std::optional<std::size_t> index = viewed_words.find(token.value);
+                const bool is_in_place =
+                    index.has_value() && view.vector.data() == viewed_words.vector_data(*index);
+
+                if (view.vector != word_vector.word_vector.vector ||
+                    view.improvised != word_vector.improvised ||
+                    (index.has_value() &&
+                     is_in_place != (viewed_words.precision() == lc::VectorPrecision::Float32))) {
+                    std::cout << "The vector of " << token.value << " was viewed wrong\n";
+
+                    return 1;
+                }
+            }
+        }
+
+        std::cout << foreign_tokens.size() << " tokens of another database read by value\n";
+    }
+
+    if (action == "live statistics") {
+        const std::string database_path = args.at(1);
+        const std::string text = args.at(2);
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+
+        // Every section starts without a sentence terminator, its statistics have to stay finite
+        lc::CompletionSession session {model};
+        std::size_t predicted_tokens {0};
+
+        for (const lc::grammar::Token& token:
+             lc::grammar::tokenize(text, *model->vector_database)) {
+            if (token.value == "." || token.value == "!" || token.value == "?") {
+                break;
+            }
+
+            const lc::CompletionSession::Prediction& prediction =
+                session.predict_next_token_value(token);
+            ++predicted_tokens;
+
+            if (!std::isfinite(session.state.live_statistics.flesch_kincaid_level()) ||
+                !session.state.ephemeral_memory.allFinite() ||
+                !prediction.word_vector_value.allFinite()) {
+                std::cout << "Prediction before the first terminator is not finite\n";
+
+                return 1;
+            }
+        }
+
+        // The context of a section that ends without a terminator too
+        session.start_new_section();
+
+        if (!session.state.context_memory.allFinite()) {
+            std::cout << "Context of a section without a terminator is not finite\n";
+
+            return 1;
+        }
+
+        std::cout << predicted_tokens << " finite predictions before the first terminator\n";
+    }
+
+    if (action == "batching") {
+        const std::string database_path = args.at(1);
+        const std::string text = args.at(2);
+        const std::size_t session_count = args.size() > 3 ? std::stoul(args.at(3)) : 32;
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+        const std::vector<lc::grammar::Token> tokens =
+            lc::grammar::tokenize(text, *model->vector_database);
+
+        lc::CompletionSession expected_session {model};
+
+        for (const lc::grammar::Token& token: tokens) {
+            static_cast<void>(expected_session.predict_next_token_value(token));
+        }
+
+        std::vector<lc::CompletionSession> sessions(session_count, lc::CompletionSession {model});
+
+        {
+            lc::CompletionScheduler scheduler {
+                model, {.max_batch_size = 16, .max_latency = std::chrono::milliseconds {5}}
+            };
+
+            std::vector<std::thread> threads;
+
+            // Sessions join at different tokens and leave when their text ends
+            for (std::size_t index {0}; index < sessions.size(); ++index) {
+                threads.emplace_back([&, index] {
+                    std::this_thread::sleep_for(std::chrono::microseconds {index * 100});
+
+                    for (const lc::grammar::Token& token: tokens) {
+                        static_cast<void>(scheduler.submit(sessions [index], token).get());
+                    }
+                });
+            }
+
+            for (std::thread& thread: threads) {
+                thread.join();
+            }
+
+            std::cout << scheduler.step_count() << " steps in " << scheduler.batch_count()
+                      << " batches\n";
+        }
+
+        // A batch is a matrix product instead of vector products, which may round differently
+        for (const lc::CompletionSession& session: sessions) {
+            if (!session.state.ephemeral_memory.isApprox(expected_session.state.ephemeral_memory,
+                                                         1e-4F)) {
+                std::cout << "Batched session diverged from the unbatched one\n";
+
+                return 1;
+            }
+        }
+    }
+    if (action == "oov") {
+        using Clock = std::chrono::steady_clock;
+
+        const std::string database_path = args.at(1);
+        const std::vector<std::string> words {std::next(args.begin(), 2), args.end()};
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+
+        // The search find_word_vector() replaced, every subdatabase scanned at every threshold
+        const auto cascade = [&](const std::string& word) {
+            for (float threshold = 0.9F; threshold >= -0.1F; threshold -= 0.1F) {
+                for (const auto& [database, type]: model->get_database_type_pairs()) {
+                    const std::vector<lc::VectorDatabase::SearchResult> word_vectors =
+                        database->rapidfuzz_search_closest_n(word, 10, threshold);
+
+                    if (!word_vectors.empty()) {
+                        return std::make_tuple(model->improvised_word_vector(word, word_vectors),
+                                               type);
+                    }
+                }
+            }
+
+            return std::make_tuple(model->improvised_word_vector(word, {}),
+                                   lc::grammar::Token::Type::Alphanumeric);
+        };
+
+        std::chrono::duration<double> lookup_duration {};
+        std::chrono::duration<double> cascade_duration {};
+
+        lc::TextCompleter::ImproviserBuffers buffers;
+        const float* input_data {nullptr};
+
+        for (const std::string& word: words) {
+            const Clock::time_point lookup_start = Clock::now();
+            const auto [result, type] = model->find_word_vector(word);
+            lookup_duration += Clock::now() - lookup_start;
+
+            if (!result.improvised) {
+                std::cout << word << " is in the vocabulary\n";
+
+                continue;
+            }
+
+            const Clock::time_point cascade_start = Clock::now();
+            const auto [expected_word_vector, expected_type] = cascade(word);
+            cascade_duration += Clock::now() - cascade_start;
+
+            if (type != expected_type ||
+                result.word_vector.vector != expected_word_vector.vector) {
+                std::cout << "find_word_vector(\"" << word << "\") differs from the cascade\n";
+
+                return 1;
+            }
+
+            // Caller-owned buffers improvise the same vector and keep their storage
+            const lc::grammar::Token::Type buffered_type =
+                model->improvise_word_vector(word, buffers);
+
+            if (buffered_type != expected_type ||
+                buffers.word_vector_value != expected_word_vector.vector ||
+                (input_data != nullptr && buffers.network.input.data() != input_data)) {
+                std::cout << "Improvising \"" << word << "\" into buffers differs\n";
+
+                return 1;
+            }
+
+            input_data = buffers.network.input.data();
+        }
+
+        std::cout << "find_word_vector: " << lookup_duration.count()
+                  << "s, cascade: " << cascade_duration.count() << "s\n";
+    }
+    if (action == "improvised") {
+        using Clock = std::chrono::steady_clock;
+
+        const std::string database_path = args.at(1);
+        const std::string word = args.at(2);
+        const std::filesystem::path cache_path =
+            std::filesystem::temp_directory_path() / "lexocraft_improvised_word_vectors";
+
+        lc::TextCompleter completer = *random_model(database_path);
+        const lc::ImprovisedWordVectorCache& cache = *completer.improvised_word_vector_cache;
+
+        const Clock::time_point improvised_start = Clock::now();
+        const auto [improvised, type] = completer.find_word_vector(word);
+        const std::chrono::duration<double> improvised_duration =
+            Clock::now() - improvised_start;
+
+        if (!improvised.improvised) {
+            std::cout << word << " is in the vocabulary\n";
+
+            return 1;
+        }
+
+        const Clock::time_point cached_start = Clock::now();
+        const auto [cached, cached_type] = completer.find_word_vector(word);
+        const std::chrono::duration<double> cached_duration = Clock::now() - cached_start;
+
+        std::cout << "Improvised in " << improvised_duration.count() << "s, found again in "
+                  << cached_duration.count() << "s\n";
+
+        if (cache.hit_count() != 1 || cached.word_vector.vector != improvised.word_vector.vector ||
+            cached_type != type) {
+            std::cout << "The improvised word vector wasn't cached\n";
+
+            return 1;
+        }
+
+        completer.save_improvised_word_vector_cache(cache_path);
+
+        // Copies with the same words share the vectors, others improvise from their own words
+        lc::TextCompleter copied_completer = completer;
+        copied_completer.vector_database =
+            std::make_shared<lc::VectorDatabase>(*completer.vector_database);
+        copied_completer.create_vector_subdatabases();
+
+        lc::TextCompleter other_vocabulary_completer = copied_completer;
+        other_vocabulary_completer.vector_database =
+            std::make_shared<lc::VectorDatabase>(*completer.vector_database);
+        other_vocabulary_completer.add_word_vector(word + word, true);
+
+        static_cast<void>(copied_completer.find_word_vector(word));
+
+        if (cache.hit_count() != 2) {
+            std::cout << "A copy of the vocabulary missed the cache\n";
+
+            return 1;
+        }
+
+        static_cast<void>(other_vocabulary_completer.find_word_vector(word));
+
+        if (cache.hit_count() != 2) {
+            std::cout << "The cache wasn't invalidated by a changed vocabulary\n";
+
+            return 1;
+        }
+
+        // A changed improviser doesn't see the vectors of the previous one
+        lc::TextCompleter changed_completer = completer;
+        changed_completer.word_vector_improviser.randomize();
+
+        static_cast<void>(changed_completer.find_word_vector(word));
+
+        if (cache.hit_count() != 2) {
+            std::cout << "The cache wasn't invalidated by a changed improviser\n";
+
+            return 1;
+        }
+
+        // Only the improviser and vocabulary the file was saved with may load it
+        completer.improvised_word_vector_cache =
+            std::make_shared<lc::ImprovisedWordVectorCache>();
+        changed_completer.improvised_word_vector_cache =
+            std::make_shared<lc::ImprovisedWordVectorCache>();
+        other_vocabulary_completer.improvised_word_vector_cache =
+            std::make_shared<lc::ImprovisedWordVectorCache>();
+
+        if (changed_completer.load_improvised_word_vector_cache(cache_path) ||
+            !completer.load_improvised_word_vector_cache(cache_path)) {
+            std::cout << "The saved cache was matched with the wrong improviser\n";
+
+            return 1;
+        }
+
+        if (other_vocabulary_completer.load_improvised_word_vector_cache(cache_path) ||
+            other_vocabulary_completer.improvised_word_vector_cache->size() != 0) {
+            std::cout << "The saved cache was matched with the wrong vocabulary\n";
+
+            return 1;
+        }
+
+        const auto [loaded, loaded_type] = completer.find_word_vector(word);
+
+        if (completer.improvised_word_vector_cache->hit_count() != 1 ||
+            loaded.word_vector.vector != improvised.word_vector.vector) {
+            std::cout << "The loaded cache lost the improvised word vector\n";
+
+            return 1;
+        }
+
+        std::filesystem::remove(cache_path);
+    }
+    if (action == "prefix") {
+        using Clock = std::chrono::steady_clock;
+
+        const std::string database_path = args.at(1);
+        const std::string prefix = args.at(2);
+        const std::vector<std::string> suffixes {std::next(args.begin(), 3), args.end()};
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+        lc::PrefixCache cache {{.memory_budget = std::size_t {1} << 20U, .checkpoint_interval = 4}};
+
+        std::chrono::duration<double> cached_duration {};
+        std::chrono::duration<double> uncached_duration {};
+
+        for (const std::string& suffix: suffixes) {
+            const std::vector<lc::grammar::Token> tokens =
+                lc::grammar::tokenize(prefix + " " + suffix, *model->vector_database);
+
+            lc::CompletionSession expected_session {model};
+            const Clock::time_point uncached_start = Clock::now();
+
+            for (const lc::grammar::Token& token: tokens) {
+                static_cast<void>(expected_session.predict_next_token_value(token));
+            }
+
+            uncached_duration += Clock::now() - uncached_start;
+
+            lc::CompletionSession session {model};
+            const Clock::time_point cached_start = Clock::now();
+            static_cast<void>(cache.feed(*model, session.state, tokens));
+            cached_duration += Clock::now() - cached_start;
+
+            // Resuming runs the same computations as feeding the prefix again
+            if (session.state.ephemeral_memory != expected_session.state.ephemeral_memory ||
+                session.state.context_memory != expected_session.state.context_memory ||
+                session.state.history_hash != expected_session.state.history_hash ||
+                session.state.last_prediction.word_vector_value !=
+                    expected_session.state.last_prediction.word_vector_value) {
+                std::cout << "Resuming from a cached prefix changed the state\n";
+
+                return 1;
+            }
+        }
+
+        std::cout << cache.hit_count() << " hits, " << cache.miss_count() << " misses, "
+                  << cache.skipped_token_count() << " tokens skipped, " << cache.size()
+                  << " states in " << cache.memory_usage() << " bytes\n";
+        std::cout << "Fed in " << cached_duration.count() << "s, without the cache in "
+                  << uncached_duration.count() << "s\n";
+
+        // Every text after the first starts with the cached prefix
+        if (suffixes.size() > 1 && cache.hit_count() < suffixes.size() - 1) {
+            std::cout << "Texts sharing a prefix missed the cache\n";
+
+            return 1;
+        }
+
+        // A model reading the tokens with other words can't resume from the cached states
+        lc::TextCompleter other_vocabulary_model = *model;
+        other_vocabulary_model.vector_database =
+            std::make_shared<lc::VectorDatabase>(*model->vector_database);
+        other_vocabulary_model.add_word_vector(prefix + prefix, true);
+
+        lc::TextCompleter::SessionState other_vocabulary_state =
+            other_vocabulary_model.new_session_state();
+        const std::uint64_t hit_count = cache.hit_count();
+
+        static_cast<void>(cache.feed(
+            other_vocabulary_model, other_vocabulary_state,
+            lc::grammar::tokenize(prefix, *other_vocabulary_model.vector_database)));
+
+        if (cache.hit_count() != hit_count) {
+            std::cout << "A model with other words resumed from the cached states\n";
+
+            return 1;
+        }
+
+        lc::PrefixCache small_cache {{.memory_budget = 4096, .checkpoint_interval = 1}};
+        lc::CompletionSession session {model};
+
+        static_cast<void>(small_cache.feed(
+            *model, session.state, lc::grammar::tokenize(prefix, *model->vector_database)));
+
+        if (small_cache.memory_usage() > 4096) {
+            std::cout << "The cache outgrew its memory budget\n";
+
+            return 1;
+        }
+    }
+
+    if (action == "snapshots") {
+        using Clock = std::chrono::steady_clock;
+
+        const std::string database_path = args.at(1);
+        const std::string prompt = args.at(2);
+        const std::string continuation = args.at(3);
+
+        const std::shared_ptr<const lc::TextCompleter> model = random_model(database_path);
+        const std::vector<lc::grammar::Token> continuation_tokens =
+            lc::grammar::tokenize(continuation, *model->vector_database);
+
+        lc::CompletionSession session {model};
+
+        for (const lc::grammar::Token& token:
+             lc::grammar::tokenize(prompt, *model->vector_database)) {
+            static_cast<void>(session.predict_next_token_value(token));
+        }
+
+        lc::SessionSnapshotPool pool {*model, 2};
+        const lc::SessionSnapshotPool::Handle branch = session.fork(pool);
+
+        lc::CompletionSession expected_session {model};
+        expected_session.state = session.state;
+
+        // Exploring a continuation then rolling back must leave no trace
+        for (int attempt {0}; attempt < 2; ++attempt) {
+            session.restore(*branch);
+
+            for (const lc::grammar::Token& token: continuation_tokens) {
+                static_cast<void>(session.predict_next_token_value(token));
+            }
+        }
+
+        for (const lc::grammar::Token& token: continuation_tokens) {
+            static_cast<void>(expected_session.predict_next_token_value(token));
+        }
+
+        if (session.state.ephemeral_memory != expected_session.state.ephemeral_memory ||
+            session.state.context_memory != expected_session.state.context_memory ||
+            session.state.history_hash != expected_session.state.history_hash ||
+            session.state.last_prediction.word_vector_value !=
+                expected_session.state.last_prediction.word_vector_value) {
+            std::cout << "Restoring a snapshot changed the continuation\n";
+
+            return 1;
+        }
+
+        constexpr int fork_count {10000};
+        std::vector<lc::SessionSnapshotPool::Handle> forks;
+        forks.reserve(2);
+
+        const Clock::time_point fork_start = Clock::now();
+
+        for (int fork {0}; fork < fork_count; ++fork) {
+            forks.push_back(session.fork(pool));
+            forks.pop_back();
+        }
+
+        const std::chrono::duration<double> fork_duration = Clock::now() - fork_start;
+
+        std::vector<lc::TextCompleter::SessionState> copies;
+        copies.reserve(1);
+
+        const Clock::time_point copy_start = Clock::now();
+
+        for (int copy {0}; copy < fork_count; ++copy) {
+            copies.push_back(session.state);
+            copies.pop_back();
+        }
+
+        const std::chrono::duration<double> copy_duration = Clock::now() - copy_start;
+
+        std::cout << "Snapshots of " << branch->memory_usage() << " bytes, forked in "
+                  << fork_duration.count() / fork_count << "s, states copied in "
+                  << copy_duration.count() / fork_count << "s\n";
+
+        // Released snapshots are reused, the pool only grows past what is held at once
+        for (int fork {0}; fork < 3; ++fork) {
+            forks.push_back(session.fork(pool));
+        }
+
+        forks.clear();
+
+        if (pool.size() != 4 || pool.free_count() != 3) {
+            std::cout << "The pool holds " << pool.size() << " snapshots, " << pool.free_count()
+                      << " of them free\n";
+
+            return 1;
+        }
     }
 }
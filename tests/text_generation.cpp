@@ -0,0 +1,242 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lexocraft/llm/completion_session.hpp>
+#include <lexocraft/llm/text_completion.hpp>
+#include <lexocraft/llm/vector_database.hpp>
+
+namespace {
+    struct GenerationResult {
+        std::vector<lc::grammar::Token> tokens;
+        std::vector<lc::grammar::Token> streamed_tokens;
+        double time_to_first_token; // Seconds
+        double tokens_per_second;
+    };
+
+    GenerationResult generate(const std::shared_ptr<const lc::TextCompleter>& model,
+                              const std::string& prompt, std::size_t max_tokens,
+                              const lc::GenerationOptions& options) {
+        using Clock = std::chrono::steady_clock;
+
+        lc::CompletionSession session {model};
+        GenerationResult result {};
+
+        const Clock::time_point start_time = Clock::now();
+        Clock::time_point first_token_time = start_time;
+
+        result.tokens = session.generate(
+            prompt, max_tokens,
+            [&](const lc::grammar::Token& token) {
+                if (result.streamed_tokens.empty()) {
+                    first_token_time = Clock::now();
+                }
+
+                result.streamed_tokens.push_back(token);
+                std::cout << token.value << (token.next_is_space ? " " : "") << std::flush;
+
+                return true;
+            },
+            options);
+
+        const std::chrono::duration<double> duration = Clock::now() - start_time;
+        const std::chrono::duration<double> first_token_duration = first_token_time - start_time;
+
+        result.time_to_first_token = first_token_duration.count();
+        result.tokens_per_second = static_cast<double>(result.tokens.size()) / duration.count();
+
+        std::cout << "\n";
+
+        return result;
+    }
+
+    std::shared_ptr<const lc::TextCompleter> random_model(lc::VectorDatabase database) {
+        lc::TextCompleter completer {std::move(database), 100, 50};
+        completer.create_vector_subdatabases();
+
+        completer.set_ephemeral_memory_accmulator_nn(
+            {completer.ephemeral_memory_fields_sizes.total(), 200, 200,
+             completer.ephemeral_memory_output_sizes.total()},
+            true);
+        completer.set_word_vector_improviser_nn(
+            {completer.word_vector_improviser_fields_sizes.total(), 100,
+             completer.word_vector_improviser_output_sizes.total()},
+            true);
+
+        return std::make_shared<const lc::TextCompleter>(std::move(completer));
+    }
+} // namespace
+
+int main(const int argc, const char** argv) {
+    std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
+
+    std::cout << "args: " << args.size() << "\n";
+
+    for (std::size_t index = 0; index < args.size(); ++index) {
+        std::cout << "arg[" << index << "]: " << args [index] << "\n";
+    }
+
+    if (args.size() < 2) {
+        std::cout << "Usage: <database> <prompt> [max_tokens]\n";
+
+        return 1;
+    }
+
+    const std::string database_path = args.at(0);
+    const std::string prompt = args.at(1);
+    const std::size_t max_tokens = args.size() > 2 ? std::stoul(args.at(2)) : 20;
+
+    lc::VectorDatabase database {};
+    database.load_file(database_path);
+
+    const std::shared_ptr<const lc::TextCompleter> model = random_model(std::move(database));
+
+    const std::vector<std::pair<std::string, lc::GenerationOptions>> decodings {
+        {"greedy", {}},
+        {"top-k", {.top_k = 5, .temperature = 0.05F, .seed = 1}},
+        {"beam", {.beam_width = 3}},
+        {"typed", {.is_type_constrained = true}},
+        {"typed beam", {.beam_width = 3, .is_type_constrained = true}},
+    };
+
+    for (const auto& [name, options]: decodings) {
+        std::cout << "\n" << name << ": ";
+
+        const GenerationResult result = generate(model, prompt, max_tokens, options);
+
+        std::cout << "Generated " << result.tokens.size() << " tokens, time to first token "
+                  << result.time_to_first_token << "s, " << result.tokens_per_second
+                  << " tokens/s\n";
+
+        if (result.tokens.size() > max_tokens) {
+            std::cout << "Generated more than " << max_tokens << " tokens\n";
+
+            return 1;
+        }
+
+        // Every token is streamed, in order
+        bool is_streamed = result.streamed_tokens.size() == result.tokens.size();
+
+        for (std::size_t index {0}; is_streamed && index < result.tokens.size(); ++index) {
+            is_streamed = result.streamed_tokens [index].value == result.tokens [index].value;
+        }
+
+        if (!is_streamed) {
+            std::cout << "Streamed tokens differ from the generated ones\n";
+
+            return 1;
+        }
+
+        // Sessions over the same model start alike, so decoding is reproducible
+        const GenerationResult repeated_result = generate(model, prompt, max_tokens, options);
+
+        bool is_repeated = repeated_result.tokens.size() == result.tokens.size();
+
+        for (std::size_t index {0}; is_repeated && index < result.tokens.size(); ++index) {
+            is_repeated = repeated_result.tokens [index].value == result.tokens [index].value;
+        }
+
+        if (!is_repeated) {
+            std::cout << "Generating again gave another text\n";
+
+            return 1;
+        }
+    }
+    // ------------------------- Type-constrained search -------------------------
+
+    // An untrained model is rarely confident about the type, trust its likeliest one
+    const lc::TypedSearchOptions typed_search {.min_confidence = 0.0F, .merge_ratio = 0.8F};
+
+    lc::CompletionSession session {model};
+    std::size_t searched_word_count {0};
+    std::size_t decoded_count {0};
+    bool is_of_searched_type {true};
+
+    // The callback sees the prediction a token was decoded from, it is fed back afterwards
+    static_cast<void>(session.generate(
+        prompt, max_tokens,
+        [&](const lc::grammar::Token& token) {
+            const std::vector<lc::TextCompleter::DatabaseTypePairElement_t> subdatabases =
+                model->typed_search_subdatabases(session.state.last_prediction, typed_search);
+
+            ++decoded_count;
+
+            if (subdatabases.empty()) {
+                searched_word_count += model->vector_database->words.size();
+
+                return true;
+            }
+
+            bool is_found {false};
+
+            for (const auto& [subdatabase, type]: subdatabases) {
+                searched_word_count += subdatabase->size();
+                is_found = is_found || subdatabase->search_from_map(token.value).has_value();
+            }
+
+            is_of_searched_type = is_of_searched_type && is_found;
+
+            return true;
+        },
+        {.end_threshold = 1.0F, .is_type_constrained = true, .typed_search = typed_search}));
+
+    if (decoded_count > 0) {
+        std::cout << "\nSearched " << searched_word_count / decoded_count << " of "
+                  << model->vector_database->words.size() << " words per token\n";
+    }
+
+    if (!is_of_searched_type) {
+        std::cout << "Decoded a word outside of the searched subdatabases\n";
+
+        return 1;
+    }
+
+    // ------------------------- Stopped and empty beams -------------------------
+
+    // As when sampling, a stopped beam search returns the streamed tokens and continues from them
+    lc::CompletionSession stopped_session {model};
+    std::vector<lc::grammar::Token> stopped_streamed_tokens;
+
+    const std::vector<lc::grammar::Token> stopped_tokens = stopped_session.generate(
+        prompt, max_tokens,
+        [&](const lc::grammar::Token& token) {
+            stopped_streamed_tokens.push_back(token);
+
+            return false;
+        },
+        {.beam_width = 3, .end_threshold = 1.0F});
+
+    lc::CompletionSession expected_session {model};
+
+    for (const lc::grammar::Token& token: lc::grammar::tokenize(prompt, *model->vector_database)) {
+        static_cast<void>(expected_session.predict_next_token_value(token));
+    }
+
+    for (const lc::grammar::Token& token: stopped_tokens) {
+        static_cast<void>(expected_session.predict_next_token_value(token));
+    }
+
+    if (stopped_tokens.size() > 1 || stopped_tokens.size() != stopped_streamed_tokens.size() ||
+        stopped_session.state.history_hash != expected_session.state.history_hash) {
+        std::cout << "Stopped beam search went past the streamed tokens\n";
+
+        return 1;
+    }
+
+    // Without words to decode, no beam grows
+    const std::shared_ptr<const lc::TextCompleter> empty_model = random_model({});
+
+    for (const std::size_t beam_width: {1, 3}) {
+        const GenerationResult empty_result =
+            generate(empty_model, prompt, max_tokens, {.beam_width = beam_width});
+
+        if (!empty_result.tokens.empty() || !empty_result.streamed_tokens.empty()) {
+            std::cout << "Generated words without a vocabulary\n";
+
+            return 1;
+        }
+    }
+}
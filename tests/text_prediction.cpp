@@ -37,8 +37,8 @@ int main(int argc, char** argv) {
 
     completer.create_vector_subdatabases();
 
-    IC(completer.vector_database->word_map.at("test").word);
-    IC(completer.lowercase_homogeneous_vector_subdatabase->word_map.contains("test"));
+    IC(completer.vector_database->search_from_map("test")->word);
+    IC(completer.lowercase_homogeneous_vector_subdatabase->search_from_map("test").has_value());
 
     const std::size_t improviser_input_size = completer.word_vector_improviser_fields_sizes.total();
     const std::size_t improviser_output_size =
@@ -54,7 +54,7 @@ int main(int argc, char** argv) {
         {predictor_input_size, 200, 200, predictor_output_size}, true);
 
     IC();
-    IC(completer.homogeneous_vector_subdatabase->word_map.size());
+    IC(completer.homogeneous_vector_subdatabase->size());
 
     // ------------------------- Text -------------------------
 
@@ -90,8 +90,8 @@ int main(int argc, char** argv) {
             token, sentence_length_mean_, sentence_length_stddev_, flesch_kincaid_grade_,
             sentence_count_)};
 
-        std::cout << "Ephemeral memory: " << lc::fancy_eigen_vector_str(output.ephemeral_memory)
-                  << "\n";
+        std::cout << "Ephemeral memory: "
+                  << lc::fancy_eigen_vector_str(completer.session.ephemeral_memory) << "\n";
         std::cout << "Predicted word vector value: "
                   << lc::fancy_eigen_vector_str(output.word_vector_value) << "\n";
 
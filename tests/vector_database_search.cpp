@@ -1,11 +1,71 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <ios>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <rapidfuzz/fuzz.hpp>
+
+#include <lexocraft/llm/phonetic_index.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
+namespace {
+    // Similarities of phonetic_search_closest_n, computed for every word
+    std::vector<float> phonetic_similarities(const lc::VectorDatabase& database,
+                                             const std::string& searched_word, int top_n,
+                                             float threshold, float soundex_weight,
+                                             float levenshtein_weight) {
+        const std::optional<lc::PhoneticIndex::Code_t> searched_code =
+            lc::PhoneticIndex::soundex(searched_word);
+        std::vector<float> similarities;
+
+        for (std::size_t index {0}; index < database.words.size(); ++index) {
+            const std::optional<lc::PhoneticIndex::Code_t> code =
+                lc::PhoneticIndex::soundex(database.words.word(index));
+            std::size_t prefix_length {0};
+
+            // Codes are packed big-endian, one character per byte
+            while (searched_code.has_value() && code.has_value() &&
+                   prefix_length < lc::PhoneticIndex::CODE_LENGTH &&
+                   (searched_code.value() >> (24U - 8U * prefix_length) & 0xFFU) ==
+                       (code.value() >> (24U - 8U * prefix_length) & 0xFFU)) {
+                ++prefix_length;
+            }
+
+            const float soundex_similarity =
+                static_cast<float>(prefix_length) / lc::PhoneticIndex::CODE_LENGTH;
+            const auto levenshtein_similarity = static_cast<float>(
+                rapidfuzz::fuzz::ratio(searched_word, database.words.word(index)) / 100.0);
+            const float similarity = (soundex_weight * soundex_similarity +
+                                      levenshtein_weight * levenshtein_similarity) /
+                                     (soundex_weight + levenshtein_weight);
+
+            if (similarity >= threshold) {
+                similarities.push_back(similarity);
+            }
+        }
+
+        std::sort(similarities.begin(), similarities.end(), std::greater {});
+        similarities.resize(std::min(similarities.size(), static_cast<std::size_t>(top_n)));
+
+        return similarities;
+    }
+
+    bool have_similarities(const std::vector<lc::VectorDatabase::SearchResult>& results,
+                           const std::vector<float>& similarities) {
+        return std::equal(results.begin(), results.end(), similarities.begin(),
+                          similarities.end(),
+                          [](const lc::VectorDatabase::SearchResult& result, float similarity) {
+                              return std::abs(result.similarity - similarity) < 1e-5F;
+                          });
+    }
+} // namespace
+
 int main(int argc, char** argv) {
     std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
 
@@ -16,7 +76,8 @@ int main(int argc, char** argv) {
 
     if (args.size() < 2) {
         std::cout
-            << "Usage: <database> <searched_word> [rapidfuzz/default/hash] <iterations> OPTIONAL: "
+            << "Usage: <database> <searched_word> [rapidfuzz/default/hash/soundex] <iterations> "
+               "OPTIONAL: "
                "<top_n> <threshold> <soundex_weight> <levenshtein_weight> "
                "<stop_when_top_n_are_found>";
 
@@ -27,6 +88,7 @@ int main(int argc, char** argv) {
     const std::string searched_word = args.at(1);
     const bool use_rapidfuzz = args.at(2) == "rapidfuzz";
     const bool use_hash = args.at(2) == "hash";
+    const bool use_soundex = args.at(2) == "soundex";
     const std::size_t iterations = std::stoi(args.at(3));
 
     const bool optional_args_provided = args.size() > 3;
@@ -43,7 +105,8 @@ int main(int argc, char** argv) {
     if (!use_hash) {
         std::cout << "database_path: " << database_path << "\n"
                   << "searched_word: " << searched_word << "\n"
-                  << "method: " << (use_rapidfuzz ? "rapidfuzz" : "default") << "\n"
+                  << "method: "
+                  << (use_soundex ? "soundex" : (use_rapidfuzz ? "rapidfuzz" : "default")) << "\n"
                   << "iterations: " << iterations << "\n"
                   << "top_n: " << top_n << "\n"
                   << "threshold: " << threshold << "\n"
@@ -60,6 +123,63 @@ int main(int argc, char** argv) {
 
     std::cout << "Database loaded.\n";
 
+    if (use_soundex) {
+        std::cout << "Building phonetic index...\n";
+        database.build_phonetic_index();
+
+        // Words sharing no code prefix, or without a code, still rank by their spelling
+        lc::VectorDatabase misspelled_database;
+
+        for (const std::string word: {"cat", "phone", "123", "dog"}) {
+            misspelled_database.add_word(word, true);
+        }
+
+        misspelled_database.build_phonetic_index();
+
+        for (const auto& [misspelled_word, word]:
+             {std::pair {"kat", "cat"}, std::pair {"fone", "phone"}, std::pair {"12", "123"}}) {
+            const std::vector<lc::VectorDatabase::SearchResult> misspelled_results =
+                misspelled_database.phonetic_search_closest_n(misspelled_word, 1, 0.3F);
+
+            if (misspelled_results.empty() || misspelled_results.front().word.word != word) {
+                std::cout << "Phonetic search for " << misspelled_word << " missed " << word
+                          << "\n";
+                return 1;
+            }
+        }
+
+        for (const auto& [tested_soundex_weight, tested_levenshtein_weight]:
+             {std::pair {soundex_weight, levenshtein_weight}, std::pair {0.0F, 1.0F}}) {
+            const std::vector<lc::VectorDatabase::SearchResult> phonetic_results =
+                database.phonetic_search_closest_n(searched_word, top_n, threshold,
+                                                   tested_soundex_weight,
+                                                   tested_levenshtein_weight);
+
+            if (!have_similarities(phonetic_results,
+                                   phonetic_similarities(database, searched_word, top_n,
+                                                         threshold, tested_soundex_weight,
+                                                         tested_levenshtein_weight))) {
+                std::cout << "Phonetic search differs from scoring every word\n";
+                return 1;
+            }
+        }
+
+        // Without the Soundex weight, the score is the rapidfuzz ratio
+        std::vector<float> rapidfuzz_similarities;
+
+        for (const lc::VectorDatabase::SearchResult& result:
+             database.rapidfuzz_search_closest_n(searched_word, top_n, threshold, false)) {
+            rapidfuzz_similarities.push_back(result.similarity);
+        }
+
+        if (!have_similarities(
+                database.phonetic_search_closest_n(searched_word, top_n, threshold, 0.0F, 1.0F),
+                rapidfuzz_similarities)) {
+            std::cout << "Phonetic search without Soundex differs from rapidfuzz\n";
+            return 1;
+        }
+    }
+
     std::cout << "Searching for " << searched_word << "...\n";
 
     if (use_hash) {
@@ -95,13 +215,21 @@ int main(int argc, char** argv) {
 
     std::size_t average_duration_ns = 0;
 
-    const auto results = database.rapidfuzz_search_closest_n(searched_word, top_n, threshold,
-                                                             stop_when_top_n_are_found);
+    const auto search = [&] {
+        if (use_soundex) {
+            return database.phonetic_search_closest_n(searched_word, top_n, threshold,
+                                                      soundex_weight, levenshtein_weight);
+        }
+
+        return database.rapidfuzz_search_closest_n(searched_word, top_n, threshold,
+                                                   stop_when_top_n_are_found);
+    };
+
+    const auto results = search();
 
     for (std::size_t iteration {0}; iteration < iterations; ++iteration) {
         const auto start = std::chrono::high_resolution_clock::now();
-        const auto results = database.rapidfuzz_search_closest_n(searched_word, top_n, threshold,
-                                                                 stop_when_top_n_are_found);
+        const auto results = search();
         const auto end = std::chrono::high_resolution_clock::now();
         const auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
         average_duration_ns += duration_ns.count();
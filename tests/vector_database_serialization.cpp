@@ -1,12 +1,18 @@
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 
 #include <cereal/archives/binary.hpp>
 #include <cereal/cereal.hpp>
 
 #include <lexocraft/llm/vector_database.hpp>
+#include <lexocraft/llm/vector_database_file.hpp>
 
 int main(int argc, char** argv) {
     std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
@@ -28,6 +34,21 @@ int main(int argc, char** argv) {
     vector_database.add_word("foo", true);
     vector_database.add_word("bar", true);
 
+    // Word lengths are stored in 16 bits, longer words are rejected before anything changes
+    try {
+        vector_database.add_word(std::string(std::size_t {1} << 17U, 'a'), true);
+
+        std::cout << "A word too long for its 16 bit length was added\n";
+
+        return 1;
+    } catch (const std::length_error&) {
+        if (vector_database.words.size() != 6) {
+            std::cout << "A rejected word was partly added\n";
+
+            return 1;
+        }
+    }
+
     vector_database.annoy_index->build(10);
     vector_database.annoy_index->unbuild();
     vector_database.annoy_index->build(10000);
@@ -72,4 +93,302 @@ int main(int argc, char** argv) {
 
     std::cout << "vector_database_file.words [2].word: " << vector_database_file.words [2].word
               << "\n";
+
+    std::filesystem::path mapped_path {tmp_path};
+    mapped_path += ".mapped";
+
+    vector_database.save_mapped_file(mapped_path);
+
+    lc::VectorDatabase vector_database_mapped;
+
+    vector_database_mapped.load_mapped_file(mapped_path);
+
+    std::cout << "vector_database_mapped.words.at(2).word: "
+              << vector_database_mapped.words.at(2).word << "\n";
+
+    for (std::size_t index {0}; index < vector_database.words.size(); ++index) {
+        const lc::WordVector& word = vector_database.words [index];
+        const std::optional<lc::WordVector> mapped_word =
+            vector_database_mapped.search_from_map(word.word);
+
+        if (!mapped_word.has_value() || mapped_word->vector != word.vector ||
+            vector_database_mapped.words.at(index).word != word.word) {
+            std::cerr << "Mapped word " << word.word << " does not match\n";
+            return 1;
+        }
+    }
+
+    if (vector_database_mapped.search_from_map("missing").has_value() ||
+        vector_database_mapped.search_closest_vector_value_n(vector_database.words [0], 1)
+                .front()
+                .word.word != vector_database.words [0].word) {
+        std::cerr << "Mapped search failed\n";
+        return 1;
+    }
+
+    // Modifying a mapped database copies it into owned storage
+    vector_database_mapped.add_word("extra", true);
+
+    if (vector_database_mapped.words.is_borrowed() ||
+        vector_database_mapped.words.size() != vector_database.words.size() + 1 ||
+        !vector_database_mapped.search_from_map("hello").has_value() ||
+        !vector_database_mapped.search_from_map("extra").has_value()) {
+        std::cerr << "Materialized database does not match\n";
+        return 1;
+    }
+
+    for (const lc::VectorPrecision precision: {lc::VectorPrecision::Float16,
+                                               lc::VectorPrecision::BFloat16}) {
+        std::filesystem::path half_path {tmp_path};
+        half_path += ".half";
+
+        vector_database.save_mapped_file(half_path, precision);
+
+        lc::VectorDatabase vector_database_half;
+        vector_database_half.load_mapped_file(half_path);
+
+        lc::VectorDatabase vector_database_compact {vector_database};
+        vector_database_compact.compact(precision);
+        vector_database_compact.index_backend = lc::VectorDatabase::IndexBackend::BruteForce;
+
+        for (std::size_t index {0}; index < vector_database.words.size(); ++index) {
+            const lc::WordVector& word = vector_database.words [index];
+            const lc::WordVector half_word = vector_database_half.words.at(index);
+            const float error = (half_word.vector - word.vector).cwiseAbs().maxCoeff();
+
+            if (error > 1e-2F ||
+                vector_database_compact.words.at(index).vector != half_word.vector) {
+                std::cerr << "16-bit word " << word.word << " does not match\n";
+                return 1;
+            }
+        }
+
+        if (vector_database_compact.search_closest_vector_value_n(vector_database.words [1], 1)
+                .front()
+                .word.word != vector_database.words [1].word) {
+            std::cerr << "16-bit search failed\n";
+            return 1;
+        }
+    }
+
+    std::filesystem::path plaintext_path {tmp_path};
+    plaintext_path += ".txt";
+
+    {
+        std::ofstream plaintext_file {plaintext_path};
+        plaintext_file << "  hello\nworld\r\n\n\tfoo bar \nbaz";
+    }
+
+    const lc::VectorDatabase plaintext_database =
+        lc::VectorDatabase::from_plaintext(plaintext_path, 2);
+    const lc::VectorDatabase plaintext_database_serial =
+        lc::VectorDatabase::from_plaintext(plaintext_path, 1);
+    const std::vector<std::string> plaintext_words {"hello", "world", "foo bar", "baz"};
+
+    if (plaintext_database.words.size() != plaintext_words.size()) {
+        std::cerr << "Plaintext database has " << plaintext_database.words.size() << " words\n";
+        return 1;
+    }
+
+    for (std::size_t index {0}; index < plaintext_words.size(); ++index) {
+        const lc::WordVector word = plaintext_database.words.at(index);
+
+        if (word.word != plaintext_words [index] ||
+            word.vector != plaintext_database_serial.words.at(index).vector ||
+            word.vector.cwiseAbs().maxCoeff() > 1.0F ||
+            !plaintext_database.search_from_map(plaintext_words [index]).has_value()) {
+            std::cerr << "Plaintext word " << word.word << " does not match\n";
+            return 1;
+        }
+    }
+
+    // The vectors come from the words of the file, not only from their position in it
+    {
+        std::ofstream plaintext_file {plaintext_path};
+        plaintext_file << "goodbye\nworld";
+    }
+
+    if (lc::VectorDatabase::from_plaintext(plaintext_path).words.at(0).vector ==
+        plaintext_database.words.at(0).vector) {
+        std::cerr << "Plaintext files with other words got the same vectors\n";
+        return 1;
+    }
+
+    lc::VectorDatabase vector_database_frozen {vector_database};
+    vector_database_frozen.freeze();
+
+    std::filesystem::path frozen_path {tmp_path};
+    frozen_path += ".frozen";
+
+    vector_database_frozen.save_mapped_file(frozen_path);
+
+    lc::VectorDatabase vector_database_frozen_mapped;
+    vector_database_frozen_mapped.load_mapped_file(frozen_path);
+
+    for (const lc::VectorDatabase* frozen:
+         {&vector_database_frozen, &vector_database_frozen_mapped}) {
+        if (!frozen->words.is_frozen() || frozen->search_from_map("missing").has_value()) {
+            std::cerr << "Frozen database lookup failed\n";
+            return 1;
+        }
+
+        for (std::size_t index {0}; index < vector_database.words.size(); ++index) {
+            if (frozen->words.find(vector_database.words.word(index)) != index) {
+                std::cerr << "Frozen word " << vector_database.words.word(index) << " not found\n";
+                return 1;
+            }
+        }
+    }
+
+    // Adding a word thaws the vocabulary
+    vector_database_frozen_mapped.add_word("extra", true);
+
+    if (vector_database_frozen_mapped.words.is_frozen() ||
+        !vector_database_frozen_mapped.search_from_map("extra").has_value() ||
+        !vector_database_frozen_mapped.search_from_map("hello").has_value()) {
+        std::cerr << "Thawed database lookup failed\n";
+        return 1;
+    }
+
+    // Corrupt indices are rejected when loading instead of being read out of bounds
+    using SectionId = lc::VectorDatabaseFile::SectionId;
+
+    const auto read_image = [](const std::filesystem::path& path) {
+        std::ifstream file {path, std::ios::binary};
+        const std::string bytes {std::istreambuf_iterator<char> {file}, {}};
+        std::vector<std::byte> image(bytes.size());
+        std::memcpy(image.data(), bytes.data(), bytes.size());
+
+        return image;
+    };
+
+    const auto section_of = [](std::vector<std::byte>& image, SectionId id) {
+        lc::VectorDatabaseFile::Header header {};
+        std::memcpy(&header, image.data(), sizeof(header));
+
+        for (std::size_t index {0}; index < header.section_count; ++index) {
+            lc::VectorDatabaseFile::SectionEntry entry {};
+            std::memcpy(&entry, std::next(image.data(), sizeof(header) + index * sizeof(entry)),
+                        sizeof(entry));
+
+            if (entry.id == id) {
+                return std::span<std::byte> {image}.subspan(entry.offset, entry.size);
+            }
+        }
+
+        return std::span<std::byte> {};
+    };
+
+    const auto is_rejected = [](std::vector<std::byte> image) {
+        try {
+            const lc::VectorDatabaseFile file {std::move(image)};
+        } catch (const std::runtime_error& error) {
+            std::cout << "Rejected: " << error.what() << "\n";
+            return true;
+        }
+
+        return false;
+    };
+
+    const std::uint32_t unknown_index {0xFFFF0000};
+
+    std::vector<std::byte> bad_offset_image = read_image(mapped_path);
+    std::memcpy(section_of(bad_offset_image, SectionId::StringOffsets).data(), &unknown_index,
+                sizeof(unknown_index));
+
+    std::vector<std::byte> bad_slot_image = read_image(mapped_path);
+    const std::span<std::byte> slots = section_of(bad_slot_image, SectionId::HashIndex);
+
+    for (std::size_t offset {0}; offset < slots.size();
+         offset += sizeof(lc::VectorDatabaseFile::HashSlot)) {
+        std::uint32_t slot_word {};
+        std::memcpy(&slot_word, std::next(slots.data(), offset), sizeof(slot_word));
+
+        if (slot_word != lc::VectorDatabaseFile::EMPTY_SLOT) {
+            std::memcpy(std::next(slots.data(), offset), &unknown_index, sizeof(unknown_index));
+            break;
+        }
+    }
+
+    // The entries end the perfect hash section, each starting with its word index
+    std::vector<std::byte> bad_entry_image = read_image(frozen_path);
+    const std::span<std::byte> perfect_hash = section_of(bad_entry_image, SectionId::PerfectHash);
+    std::memcpy(std::next(perfect_hash.data(),
+                          static_cast<std::ptrdiff_t>(perfect_hash.size() -
+                                                      sizeof(lc::PerfectHash::Entry))),
+                &unknown_index, sizeof(unknown_index));
+
+    if (is_rejected(read_image(mapped_path)) || is_rejected(read_image(frozen_path)) ||
+        !is_rejected(std::move(bad_offset_image)) || !is_rejected(std::move(bad_slot_image)) ||
+        !is_rejected(std::move(bad_entry_image))) {
+        std::cerr << "Corrupt mapped files were not rejected\n";
+        return 1;
+    }
+
+    // Index backends and IVF-PQ indices are checked when a database loads the file
+    const auto is_load_rejected = [&tmp_path](const std::vector<std::byte>& image) {
+        std::filesystem::path corrupt_path {tmp_path};
+        corrupt_path += ".corrupt";
+
+        {
+            std::ofstream file {corrupt_path, std::ios::binary};
+            file.write(reinterpret_cast<const char*>(image.data()),
+                       static_cast<std::streamsize>(image.size()));
+        }
+
+        try {
+            lc::VectorDatabase database;
+            database.load_mapped_file(corrupt_path);
+        } catch (const std::runtime_error& error) {
+            std::cout << "Rejected: " << error.what() << "\n";
+            return true;
+        }
+
+        return false;
+    };
+
+    const auto with_index_backend = [](std::vector<std::byte> image, std::uint32_t backend) {
+        lc::VectorDatabaseFile::Header header {};
+        std::memcpy(&header, image.data(), sizeof(header));
+        header.index_backend = backend;
+        std::memcpy(image.data(), &header, sizeof(header));
+
+        return image;
+    };
+
+    lc::VectorDatabase ivfpq_database {vector_database};
+    ivfpq_database.build_ivfpq_index({.coarse_cells = 2, .subquantizers = 8});
+
+    std::filesystem::path ivfpq_path {tmp_path};
+    ivfpq_path += ".ivfpq";
+    ivfpq_database.save_mapped_file(ivfpq_path);
+
+    std::vector<std::vector<int>>& cell_items = ivfpq_database.ivfpq_index->cell_items;
+    const auto filled_cell = static_cast<std::size_t>(std::distance(
+        cell_items.begin(), std::find_if(cell_items.begin(), cell_items.end(),
+                                         [](const std::vector<int>& items) {
+                                             return !items.empty();
+                                         })));
+
+    std::filesystem::path bad_item_path {tmp_path};
+    bad_item_path += ".ivfpq_item";
+    cell_items [filled_cell].front() = static_cast<int>(ivfpq_database.words.size());
+    ivfpq_database.save_mapped_file(bad_item_path);
+
+    std::filesystem::path bad_codes_path {tmp_path};
+    bad_codes_path += ".ivfpq_codes";
+    cell_items [filled_cell].front() = 0;
+    ivfpq_database.ivfpq_index->cell_codes [filled_cell].pop_back();
+    ivfpq_database.save_mapped_file(bad_codes_path);
+
+    const auto ivfpq_backend = static_cast<std::uint32_t>(lc::VectorDatabase::IndexBackend::IVFPQ);
+
+    if (is_load_rejected(read_image(ivfpq_path)) ||
+        !is_load_rejected(with_index_backend(read_image(mapped_path), 99)) ||
+        !is_load_rejected(with_index_backend(read_image(mapped_path), ivfpq_backend)) ||
+        !is_load_rejected(read_image(bad_item_path)) ||
+        !is_load_rejected(read_image(bad_codes_path))) {
+        std::cerr << "Corrupt index backends or IVF-PQ indices were not rejected\n";
+        return 1;
+    }
 }
@@ -12,13 +12,6 @@
 #include <lexocraft/fancy_eigen_print.hpp>
 #include <lexocraft/llm/vector_database.hpp>
 
-std::string remove_whitespace(std::string str) {
-    str.erase(str.begin(), std::find_if_not(str.begin(), str.end(), ::isspace));
-    str.erase(std::find_if_not(str.rbegin(), str.rend(), ::isspace).base(), str.end());
-
-    return str;
-}
-
 int main(int argc, char** argv) {
     std::vector<std::string> args {std::next(argv, 1), std::next(argv, argc)};
 
@@ -45,25 +38,9 @@ int main(int argc, char** argv) {
     if (database_type == "plaintext") {
         std::cout << "loading database from " << database_path << "\n";
 
-        std::cout << "database loaded\n";
-
-        std::ifstream file {database_path};
-        std::vector<lc::WordVector> words;
-        std::string line;
-
-        std::cout << "Reading from file: " << database_path << "\n";
-
-        constexpr auto MAX_WORDS_COUNT = 10000000;
-
-        int word_count = 0;
-        while (std::getline(file, line) && word_count++ < MAX_WORDS_COUNT) {
-            words.emplace_back(remove_whitespace(line));
-        }
-
-
-        std::cout << "Read " << words.size() << " words from file\n";
+        database = lc::VectorDatabase::from_plaintext(database_path);
 
-        database = lc::VectorDatabase {words};
+        std::cout << "Read " << database.words.size() << " words from file\n";
 
         std::cout << "Building Annoy index\n";
         ankerl::nanobench::Bench().run("build_annoy_index", [&] {
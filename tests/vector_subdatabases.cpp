@@ -30,9 +30,14 @@ int main(int argc, char** argv) {
         completer.create_vector_subdatabases();
         std::cout << "Subvector databases created\n";
 
-        std::cout << "First word: " << completer.symbol_vector_subdatabase->words.at(0).word
+        std::cout << "First word: " << completer.symbol_vector_subdatabase->at(0).word
                   << "\n";
 
+        // Saved with an index that has to be rebuilt after loading
+        lc::VectorSubdatabase& symbol = *completer.symbol_vector_subdatabase;
+        symbol.build_annoy_index(10);
+        symbol.add_master_word(symbol.master_indices.front());
+
         std::cout << "Saving to path: " << stored_path << "\n";
         completer.save_file(stored_path);
         std::cout << "Subvector databases saved\n";
@@ -68,8 +73,36 @@ int main(int argc, char** argv) {
         }
         */
 
-        for (const auto& word: completer.homogeneous_vector_subdatabase->words) {
-            std::cout << word.word << "\n";
+        const lc::VectorSubdatabase& symbol = *completer.symbol_vector_subdatabase;
+
+        if (!symbol.annoy_index_is_dirty || symbol.annoy_index_trees != 10) {
+            std::cout << "The symbol subdatabase lost its dirty Annoy index\n";
+            return 1;
+        }
+
+        completer.rebuild_dirty_vector_subdatabase_indexes();
+
+        if (!symbol.annoy_index_is_built ||
+            symbol.search_closest_vector_value_n(symbol.at(0).vector, 1).front().word.word !=
+                symbol.word(0)) {
+            std::cout << "The symbol subdatabase index was not rebuilt\n";
+            return 1;
+        }
+
+        // Results point at their word in the master database
+        for (const lc::VectorSubdatabase::SearchResult& result:
+             symbol.search_closest_vector_value_n(symbol.at(0).vector, 10)) {
+            if (symbol.master->words.word(result.word_index) != result.word.word) {
+                std::cout << "The symbol subdatabase returned " << result.word.word
+                          << " for master word " << result.word_index << "\n";
+                return 1;
+            }
+        }
+
+        const lc::VectorSubdatabase& homogeneous = *completer.homogeneous_vector_subdatabase;
+
+        for (std::size_t index {0}; index < homogeneous.size(); ++index) {
+            std::cout << homogeneous.word(index) << "\n";
         }
     }
 }